@@ -0,0 +1,57 @@
+#pragma once
+
+// Standard Includes
+#include <exception>
+#include <string>
+
+namespace Common
+{
+
+//------------------------------------------------------------------------------
+/// <summary>
+/// Stand in for the Common library's Exception, so that the CMake build has no external dependencies
+///
+/// Carries the file and line it was thrown from along with the message, what() returns all three.
+/// </summary>
+class Exception : public std::exception
+{
+protected:
+
+    std::string m_file;
+    unsigned    m_line;
+    std::string m_message;
+    std::string m_what;
+
+public:
+
+    Exception(const std::string & file, unsigned line, const std::string & message)
+        :
+        m_file(file)
+      , m_line(line)
+      , m_message(message)
+      , m_what(file + "(" + std::to_string(line) + "): " + message)
+    {
+    }
+
+    const std::string & getFile() const
+    {
+        return m_file;
+    }
+
+    unsigned getLine() const
+    {
+        return m_line;
+    }
+
+    const std::string & getMessage() const
+    {
+        return m_message;
+    }
+
+    const char * what() const noexcept
+    {
+        return m_what.c_str();
+    }
+};
+
+} // namespace Common
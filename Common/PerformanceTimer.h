@@ -0,0 +1,40 @@
+#pragma once
+
+// Standard Includes
+#include <chrono>
+
+namespace Common
+{
+
+//------------------------------------------------------------------------------
+/// <summary>
+/// Stand in for the Common library's PerformanceTimer, so that the CMake build has no external dependencies
+///
+/// Measures wall clock time on the monotonic clock, Stop() returns the seconds elapsed since Start().
+/// </summary>
+class PerformanceTimer
+{
+protected:
+
+    std::chrono::steady_clock::time_point m_start;
+
+public:
+
+    PerformanceTimer()
+        :
+        m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    void Start()
+    {
+        m_start = std::chrono::steady_clock::now();
+    }
+
+    double Stop() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    }
+};
+
+} // namespace Common
@@ -0,0 +1,540 @@
+
+// Project Includes
+#include "AllocationTrace.h"
+
+// Common Libary
+#include "Exception.h"
+
+// Standard Includes
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <sstream>
+
+//------------------------------------------------------------------------------
+const char AllocationTrace::MAGIC[8] = { 'M', 'M', 'T', 'R', 'A', 'C', 'E', '\0' };
+
+//------------------------------------------------------------------------------
+namespace
+{
+    // Where a replayed object lives now, indexed by object id
+    struct ReplayObject
+    {
+        void *  m_address;
+        size_t  m_size;
+        uint8_t m_alignment;
+    };
+
+    //------------------------------------------------------------------------------
+    // Adapts a memory manager to the calls made by replay()
+    class MemoryManagerTarget
+    {
+        IMemoryManager & m_memoryManager;
+
+    public:
+
+        MemoryManagerTarget(IMemoryManager & memoryManager)
+            :
+            m_memoryManager(memoryManager)
+        {
+        }
+
+        void * allocate(size_t size, uint8_t alignment)
+        {
+            return m_memoryManager.allocate(size, alignment);
+        }
+
+        void free(void * p, size_t size, uint8_t alignment)
+        {
+            m_memoryManager.free(p, size, alignment);
+        }
+
+        void * reallocate(void * p, size_t, size_t newSize, uint8_t alignment)
+        {
+            return m_memoryManager.reallocate(p, newSize, alignment);
+        }
+
+        size_t getPeakFootprint() const
+        {
+            return m_memoryManager.getStatistics().m_peakUsedMemory;
+        }
+
+        double getFragmentation() const
+        {
+            return m_memoryManager.getStatistics().m_fragmentation;
+        }
+    };
+
+    //------------------------------------------------------------------------------
+    class StackTarget
+    {
+        StackMemoryManager & m_memoryManager;
+
+    public:
+
+        StackTarget(StackMemoryManager & memoryManager)
+            :
+            m_memoryManager(memoryManager)
+        {
+        }
+
+        void * allocate(size_t size, uint8_t alignment)
+        {
+            return m_memoryManager.allocate(size, alignment);
+        }
+
+        void free(void * p, size_t size, uint8_t alignment)
+        {
+            m_memoryManager.free(p, size, alignment);
+        }
+
+        // The object is on top of the stack, so giving it back and allocating again leaves it where it was
+        void * reallocate(void * p, size_t oldSize, size_t newSize, uint8_t alignment)
+        {
+            m_memoryManager.free(p, oldSize, alignment);
+
+            try
+            {
+                return m_memoryManager.allocate(newSize, alignment);
+            }
+            catch( const Common::Exception & )
+            {
+                // Put the object back as it was, so that it is still live when the replay gives up
+                m_memoryManager.allocate(oldSize, alignment);
+                throw;
+            }
+        }
+
+        size_t getPeakFootprint() const
+        {
+            return m_memoryManager.getStatistics().m_peakUsedMemory;
+        }
+
+        double getFragmentation() const
+        {
+            return m_memoryManager.getStatistics().m_fragmentation;
+        }
+    };
+
+    //------------------------------------------------------------------------------
+    class SystemTarget
+    {
+        size_t m_requestedBytes;
+        size_t m_peakRequestedBytes;
+
+    public:
+
+        SystemTarget()
+            :
+            m_requestedBytes(0)
+          , m_peakRequestedBytes(0)
+        {
+        }
+
+        void * allocate(size_t size, uint8_t alignment)
+        {
+            m_requestedBytes += size;
+            m_peakRequestedBytes = std::max(m_peakRequestedBytes, m_requestedBytes);
+            return ::operator new(size, std::align_val_t(alignment));
+        }
+
+        void free(void * p, size_t size, uint8_t alignment)
+        {
+            m_requestedBytes -= size;
+            ::operator delete(p, size, std::align_val_t(alignment));
+        }
+
+        void * reallocate(void * p, size_t oldSize, size_t newSize, uint8_t alignment)
+        {
+            void * newAddress = allocate(newSize, alignment);
+            memcpy(newAddress, p, std::min(oldSize, newSize));
+            free(p, oldSize, alignment);
+            return newAddress;
+        }
+
+        size_t getPeakFootprint() const
+        {
+            return m_peakRequestedBytes;
+        }
+
+        // The system allocator does not say how its free memory is laid out
+        double getFragmentation() const
+        {
+            return -1.0;
+        }
+    };
+
+    //------------------------------------------------------------------------------
+    template <class Target>
+    AllocationTrace::ReplayResult replayTrace(const std::vector<AllocationTrace::Event> & events, size_t numObjects,
+                                              Target & target, const std::string & name)
+    {
+        typedef std::chrono::steady_clock Clock;
+
+        AllocationTrace::ReplayResult result;
+        result.m_name = name;
+
+        std::vector<ReplayObject> objects(numObjects, ReplayObject{ nullptr, 0, 1 });
+        std::vector<uint64_t>     latencies;
+        latencies.reserve(events.size());
+
+        const Clock::time_point start = Clock::now();
+
+        try
+        {
+            for( const AllocationTrace::Event & event : events )
+            {
+                ReplayObject & object = objects[event.m_objectId];
+
+                // Zero sized requests are replayed as one byte, as validate() counts them
+                const size_t size = std::max<uint64_t>(event.m_size, 1);
+                const Clock::time_point eventStart = Clock::now();
+
+                switch( event.m_type )
+                {
+                case AllocationTrace::EventType::Allocate:
+                    object.m_address = target.allocate(size, event.m_alignment);
+                    break;
+
+                case AllocationTrace::EventType::Free:
+                    target.free(object.m_address, object.m_size, object.m_alignment);
+                    object.m_address = nullptr;
+                    break;
+
+                case AllocationTrace::EventType::Reallocate:
+                    object.m_address = target.reallocate(object.m_address, object.m_size, size, event.m_alignment);
+                    break;
+                }
+
+                const Clock::time_point eventEnd = Clock::now();
+                latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(eventEnd - eventStart).count());
+
+                object.m_size      = size;
+                object.m_alignment = event.m_alignment;
+            }
+        }
+        catch( const Common::Exception & e )
+        {
+            // The message ends in a full stop, toString() adds its own
+            std::string message(e.what());
+
+            if( !message.empty() && message.back() == '.' )
+            {
+                message.pop_back();
+            }
+
+            result.m_skipped = true;
+            result.m_reason  = "failed after " + std::to_string(latencies.size()) + " events, " + message;
+        }
+
+        result.m_secondsElapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        result.m_peakFootprint  = target.getPeakFootprint();
+        result.m_fragmentation  = target.getFragmentation();
+
+        // Give back whatever is left, most recent first, so that stacks can be reused too
+        for( auto object = objects.rbegin(); object != objects.rend(); ++object )
+        {
+            if( object->m_address )
+            {
+                target.free(object->m_address, object->m_size, object->m_alignment);
+            }
+        }
+
+        result.m_numEvents       = latencies.size();
+        result.m_eventsPerSecond = result.m_secondsElapsed > 0.0 ? latencies.size() / result.m_secondsElapsed : 0.0;
+
+        if( !latencies.empty() )
+        {
+            std::sort(latencies.begin(), latencies.end());
+
+            auto percentile = [&latencies](double fraction)
+            {
+                return latencies[std::min(latencies.size() - 1, static_cast<size_t>(latencies.size() * fraction))];
+            };
+
+            result.m_p50  = percentile(0.5);
+            result.m_p99  = percentile(0.99);
+            result.m_p999 = percentile(0.999);
+            result.m_max  = latencies.back();
+        }
+
+        return result;
+    }
+}
+
+//------------------------------------------------------------------------------
+AllocationTrace::ReplayResult::ReplayResult()
+    :
+    m_skipped(false)
+  , m_numEvents(0)
+  , m_secondsElapsed(0.0)
+  , m_eventsPerSecond(0.0)
+  , m_p50(0)
+  , m_p99(0)
+  , m_p999(0)
+  , m_max(0)
+  , m_peakFootprint(0)
+  , m_fragmentation(-1.0)
+{
+}
+
+//------------------------------------------------------------------------------
+std::string AllocationTrace::ReplayResult::toString() const
+{
+    std::ostringstream text;
+    text << "Replay against " << m_name;
+
+    if( m_skipped )
+    {
+        text << " skipped, " << m_reason << ".";
+
+        if( !m_numEvents )
+        {
+            return text.str();
+        }
+
+        text << " Up to then:";
+    }
+
+    text << " " << m_numEvents << " events took " << m_secondsElapsed << " seconds, "
+         << static_cast<uint64_t>(m_eventsPerSecond) << " events per second, latency p50 " << m_p50
+         << " ns, p99 " << m_p99 << " ns, p99.9 " << m_p999 << " ns, max " << m_max
+         << " ns, peak footprint " << m_peakFootprint << " bytes";
+
+    if( m_fragmentation >= 0.0 )
+    {
+        text << ", fragmentation at the end " << m_fragmentation;
+    }
+
+    text << ".";
+
+    return text.str();
+}
+
+//------------------------------------------------------------------------------
+AllocationTrace::AllocationTrace()
+    :
+    m_numObjects(0)
+  , m_peakLiveObjects(0)
+  , m_peakRequestedBytes(0)
+{
+}
+
+//------------------------------------------------------------------------------
+void AllocationTrace::writeHeader(std::ostream & stream)
+{
+    FileHeader header;
+    memcpy(header.m_magic, MAGIC, sizeof(MAGIC));
+    header.m_version   = VERSION;
+    header.m_eventSize = sizeof(Event);
+
+    stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+//------------------------------------------------------------------------------
+void AllocationTrace::writeEvents(std::ostream & stream, const Event * events, size_t numEvents)
+{
+    stream.write(reinterpret_cast<const char *>(events), numEvents * sizeof(Event));
+}
+
+//------------------------------------------------------------------------------
+AllocationTrace AllocationTrace::load(std::istream & stream)
+{
+    FileHeader header;
+
+    if( !stream.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        memcmp(header.m_magic, MAGIC, sizeof(MAGIC)) != 0 )
+    {
+        // Error - Not a trace
+        const std::string msg("Stream does not hold an allocation trace.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( header.m_version != VERSION || header.m_eventSize != sizeof(Event) )
+    {
+        // Error - Written by a different version
+        const std::string msg("Allocation trace version " + std::to_string(header.m_version) + " is not supported.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    AllocationTrace trace;
+    Event event;
+
+    while( stream.read(reinterpret_cast<char *>(&event), sizeof(event)) )
+    {
+        trace.m_events.push_back(event);
+    }
+
+    if( stream.gcount() != 0 )
+    {
+        // Error - Partial event at the end
+        const std::string msg("Allocation trace is truncated.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    trace.validate();
+    return trace;
+}
+
+//------------------------------------------------------------------------------
+AllocationTrace AllocationTrace::load(const std::string & path)
+{
+    std::ifstream file(path, std::ios::binary);
+
+    if( !file )
+    {
+        // Error - Could not open
+        const std::string msg("Could not open allocation trace " + path + ".");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    return load(file);
+}
+
+//------------------------------------------------------------------------------
+void AllocationTrace::validate()
+{
+    // Size of every live object, zero for objects that are not live
+    std::vector<size_t> liveSizes;
+    size_t              numLiveObjects = 0;
+    size_t              requestedBytes = 0;
+
+    for( size_t index = 0; index < m_events.size(); ++index )
+    {
+        const Event & event = m_events[index];
+
+        if( !event.m_alignment || (event.m_alignment & (event.m_alignment - 1)) )
+        {
+            // Error - Bad alignment
+            const std::string msg("Event " + std::to_string(index) + " has an alignment that is not a power of two.");
+            throw Common::Exception(__FILE__, __LINE__, msg);
+        }
+
+        const bool isAllocate = event.m_type == EventType::Allocate;
+
+        if( isAllocate ? event.m_objectId != liveSizes.size()
+                       : event.m_objectId >= liveSizes.size() || !liveSizes[event.m_objectId] )
+        {
+            // Error - Objects must be allocated in id order, and only live objects freed or reallocated
+            const std::string msg("Event " + std::to_string(index) + " refers to object " +
+                                  std::to_string(event.m_objectId) + " out of order.");
+            throw Common::Exception(__FILE__, __LINE__, msg);
+        }
+
+        // Zero sized requests are recorded as one byte, so that a live object always has a size
+        const size_t size = std::max<uint64_t>(event.m_size, 1);
+
+        switch( event.m_type )
+        {
+        case EventType::Allocate:
+            liveSizes.push_back(size);
+            requestedBytes += size;
+            ++numLiveObjects;
+            break;
+
+        case EventType::Free:
+            requestedBytes -= liveSizes[event.m_objectId];
+            liveSizes[event.m_objectId] = 0;
+            --numLiveObjects;
+            break;
+
+        case EventType::Reallocate:
+            requestedBytes += size - liveSizes[event.m_objectId];
+            liveSizes[event.m_objectId] = size;
+            break;
+
+        default:
+            // Error - Unknown event
+            const std::string msg("Event " + std::to_string(index) + " has an unknown type.");
+            throw Common::Exception(__FILE__, __LINE__, msg);
+        }
+
+        m_peakLiveObjects    = std::max(m_peakLiveObjects, numLiveObjects);
+        m_peakRequestedBytes = std::max(m_peakRequestedBytes, requestedBytes);
+    }
+
+    m_numObjects = liveSizes.size();
+}
+
+//------------------------------------------------------------------------------
+const std::vector<AllocationTrace::Event> & AllocationTrace::getEvents() const
+{
+    return m_events;
+}
+
+//------------------------------------------------------------------------------
+size_t AllocationTrace::getNumObjects() const
+{
+    return m_numObjects;
+}
+
+//------------------------------------------------------------------------------
+size_t AllocationTrace::getPeakLiveObjects() const
+{
+    return m_peakLiveObjects;
+}
+
+//------------------------------------------------------------------------------
+size_t AllocationTrace::getPeakRequestedBytes() const
+{
+    return m_peakRequestedBytes;
+}
+
+//------------------------------------------------------------------------------
+bool AllocationTrace::isLifo() const
+{
+    std::vector<uint64_t> liveObjects;
+
+    for( const Event & event : m_events )
+    {
+        if( event.m_type == EventType::Allocate )
+        {
+            liveObjects.push_back(event.m_objectId);
+            continue;
+        }
+
+        if( liveObjects.empty() || liveObjects.back() != event.m_objectId )
+        {
+            return false;
+        }
+
+        if( event.m_type == EventType::Free )
+        {
+            liveObjects.pop_back();
+        }
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+AllocationTrace::ReplayResult AllocationTrace::replay(IMemoryManager & memoryManager, const std::string & name) const
+{
+    MemoryManagerTarget target(memoryManager);
+    return replayTrace(m_events, m_numObjects, target, name);
+}
+
+//------------------------------------------------------------------------------
+AllocationTrace::ReplayResult AllocationTrace::replay(StackMemoryManager & memoryManager, const std::string & name) const
+{
+    if( !isLifo() )
+    {
+        ReplayResult result;
+        result.m_name    = name;
+        result.m_skipped = true;
+        result.m_reason  = "objects are not freed in reverse order of allocation";
+        return result;
+    }
+
+    StackTarget target(memoryManager);
+    return replayTrace(m_events, m_numObjects, target, name);
+}
+
+//------------------------------------------------------------------------------
+AllocationTrace::ReplayResult AllocationTrace::replaySystemAllocator() const
+{
+    SystemTarget target;
+    return replayTrace(m_events, m_numObjects, target, "system allocator");
+}
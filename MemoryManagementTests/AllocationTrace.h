@@ -0,0 +1,115 @@
+#pragma once
+
+// Project Includes
+#include "IMemoryManager.h"
+#include "StackMemoryManager.h"
+
+// Standard Includes
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// A recorded sequence of allocate, free and reallocate events, and the means to replay it against a memory manager
+//
+// A trace is a small header followed by fixed size binary events, in the order they happened.
+// Objects are numbered from zero in the order they were first allocated, so a replay can keep them in a vector.
+// Events from every thread are replayed one after another on the calling thread, in recorded order.
+// Objects still live at the end of the trace are freed after the timed replay, so a memory manager can be reused.
+class AllocationTrace
+{
+public:
+
+    enum class EventType : uint8_t
+    {
+        Allocate,
+        Free,
+        Reallocate
+    };
+
+    struct Event
+    {
+        uint64_t m_timestamp;   // Nanoseconds since recording started
+        uint64_t m_objectId;
+        uint64_t m_size;        // Requested size, for a free the size the object was allocated with
+        uint32_t m_thread;      // Index of the recording thread, in the order threads first made a call
+        EventType m_type;
+        uint8_t  m_alignment;
+        uint16_t m_reserved;
+    };
+
+    static_assert(sizeof(Event) == 32, "Trace events must have no padding, so that they are written as is.");
+
+    // Measurements taken by one replay
+    struct ReplayResult
+    {
+        std::string m_name;
+        bool        m_skipped;          // Set when the memory manager cannot run this trace, see m_reason
+        std::string m_reason;
+        size_t      m_numEvents;
+        double      m_secondsElapsed;
+        double      m_eventsPerSecond;
+        uint64_t    m_p50;              // Latency percentiles of a single event, in nanoseconds
+        uint64_t    m_p99;
+        uint64_t    m_p999;
+        uint64_t    m_max;
+        size_t      m_peakFootprint;    // Most bytes in use at once, as reported by the memory manager
+        double      m_fragmentation;    // Of the free memory when the trace ended, before leftovers are freed, negative where unknown
+
+        ReplayResult();
+        std::string toString() const;
+    };
+
+protected:
+
+    static const char     MAGIC[8];
+    static const uint32_t VERSION = 1;
+
+    struct FileHeader
+    {
+        char     m_magic[8];
+        uint32_t m_version;
+        uint32_t m_eventSize;
+    };
+
+    std::vector<Event> m_events;
+    size_t             m_numObjects;
+    size_t             m_peakLiveObjects;
+    size_t             m_peakRequestedBytes;
+
+    void validate();
+
+public:
+
+    AllocationTrace();
+
+    static void writeHeader(std::ostream & stream);
+    static void writeEvents(std::ostream & stream, const Event * events, size_t numEvents);
+
+    // Reads a trace written by writeHeader() and writeEvents(), throws if it is not well formed
+    static AllocationTrace load(std::istream & stream);
+    static AllocationTrace load(const std::string & path);
+
+    const std::vector<Event> & getEvents() const;
+    size_t getNumObjects() const;
+    size_t getPeakLiveObjects() const;
+
+    // Most requested bytes live at once, the least memory any memory manager could run the trace in
+    size_t getPeakRequestedBytes() const;
+
+    // True when every object is freed or reallocated while it is the most recent live allocation
+    bool isLifo() const;
+
+    ReplayResult replay(IMemoryManager & memoryManager, const std::string & name) const;
+
+    // The bottom stack is used, with sized frees, so headerless stacks work too. Skipped unless isLifo().
+    ReplayResult replay(StackMemoryManager & memoryManager, const std::string & name) const;
+
+    // Replays against global operator new and delete, the footprint is the peak of requested bytes
+    ReplayResult replaySystemAllocator() const;
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,417 @@
+
+// Project Includes
+#include "BackingStore.h"
+
+// Standard Includes
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Rounds size up to a multiple of granularity, which must be a power of two
+static size_t roundUp(size_t size, size_t granularity)
+{
+    return (size + granularity - 1) & ~(granularity - 1);
+}
+
+//------------------------------------------------------------------------------
+size_t BackingStore::getPageSize()
+{
+#ifdef _WIN32
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    return systemInfo.dwPageSize;
+#else
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+//------------------------------------------------------------------------------
+size_t BackingStore::getHugePageSize()
+{
+#ifdef _WIN32
+    const size_t largePageSize = GetLargePageMinimum();
+    return largePageSize ? largePageSize : 2 * 1024 * 1024;
+#else
+    return 2 * 1024 * 1024;
+#endif
+}
+
+//------------------------------------------------------------------------------
+size_t BackingStore::getPageSize(Policy policy)
+{
+    return policy == Policy::HugePages ? getHugePageSize() : getPageSize();
+}
+
+//------------------------------------------------------------------------------
+void * BackingStore::allocate(size_t size, Policy & policy)
+{
+    if( policy == Policy::HugePages )
+    {
+        const size_t hugePageSize = getHugePageSize();
+        const size_t mappedSize   = roundUp(size, hugePageSize);
+
+#ifdef _WIN32
+        // Requires the lock pages in memory privilege, large pages are always resident once allocated
+        void * p = VirtualAlloc(nullptr, mappedSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+
+        if( p )
+        {
+            return p;
+        }
+#else
+        // Explicit huge pages, which only succeeds if the administrator has reserved some
+        void * p = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+
+        if( p != MAP_FAILED )
+        {
+            return p;
+        }
+
+        // Transparent huge pages, which need a huge page aligned region,
+        // so over map by one huge page and trim the ends
+        p = mmap(nullptr, mappedSize + hugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if( p != MAP_FAILED )
+        {
+            uint8_t * mapped  = static_cast<uint8_t *>(p);
+            uint8_t * aligned = reinterpret_cast<uint8_t *>(roundUp(reinterpret_cast<uintptr_t>(mapped), hugePageSize));
+
+            if( aligned != mapped )
+            {
+                munmap(mapped, aligned - mapped);
+            }
+
+            munmap(aligned + mappedSize, mapped + hugePageSize - aligned);
+
+#ifdef MADV_HUGEPAGE
+            madvise(aligned, mappedSize, MADV_HUGEPAGE);
+#endif
+#ifdef MADV_POPULATE_WRITE
+            if( madvise(aligned, mappedSize, MADV_POPULATE_WRITE) == 0 )
+            {
+                return aligned;
+            }
+#endif
+            // Touch every page so that it is faulted in now rather than on first use
+            for( size_t offset = 0; offset < mappedSize; offset += getPageSize() )
+            {
+                aligned[offset] = 0;
+            }
+
+            return aligned;
+        }
+#endif
+
+        policy = Policy::Prefaulted;
+    }
+
+    if( policy == Policy::Prefaulted )
+    {
+        const size_t mappedSize = roundUp(size, getPageSize());
+
+#ifdef _WIN32
+        uint8_t * p = static_cast<uint8_t *>(VirtualAlloc(nullptr, mappedSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+
+        if( p )
+        {
+            // Touch every page so that it is faulted in now rather than on first use
+            for( size_t offset = 0; offset < mappedSize; offset += getPageSize() )
+            {
+                p[offset] = 0;
+            }
+
+            return p;
+        }
+#else
+        void * p = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+
+        if( p != MAP_FAILED )
+        {
+            return p;
+        }
+#endif
+
+        policy = Policy::Malloc;
+    }
+
+    if( policy == Policy::Mapped )
+    {
+        const size_t mappedSize = roundUp(size, getPageSize());
+
+#ifdef _WIN32
+        void * p = VirtualAlloc(nullptr, mappedSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+
+        if( p )
+        {
+            return p;
+        }
+#else
+        void * p = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if( p != MAP_FAILED )
+        {
+            return p;
+        }
+#endif
+
+        policy = Policy::Malloc;
+    }
+
+    return ::malloc(size);
+}
+
+//------------------------------------------------------------------------------
+void BackingStore::release(void * p, size_t size, Policy policy)
+{
+    if( !p )
+    {
+        return;
+    }
+
+    switch( policy )
+    {
+    case Policy::HugePages:
+#ifdef _WIN32
+        VirtualFree(p, 0, MEM_RELEASE);
+#else
+        munmap(p, roundUp(size, getHugePageSize()));
+#endif
+        break;
+
+    case Policy::Prefaulted:
+    case Policy::Mapped:
+#ifdef _WIN32
+        VirtualFree(p, 0, MEM_RELEASE);
+#else
+        munmap(p, roundUp(size, getPageSize()));
+#endif
+        break;
+
+    default:
+        ::free(p);
+        break;
+    }
+}
+
+//------------------------------------------------------------------------------
+size_t BackingStore::purge(void * p, size_t size, Policy policy, PurgeMode mode)
+{
+    const size_t pageSize = getPageSize(policy);
+    const uintptr_t first = roundUp(reinterpret_cast<uintptr_t>(p), pageSize);
+    const uintptr_t last  = (reinterpret_cast<uintptr_t>(p) + size) & ~static_cast<uintptr_t>(pageSize - 1);
+
+    if( last <= first )
+    {
+        return 0;
+    }
+
+    void * const pages  = reinterpret_cast<void *>(first);
+    const size_t length = last - first;
+
+#ifdef _WIN32
+    // Large pages are locked in memory and cannot be given back piecemeal
+    if( policy == Policy::HugePages )
+    {
+        return 0;
+    }
+
+    if( mode == PurgeMode::Lazy )
+    {
+        return VirtualAlloc(pages, length, MEM_RESET, PAGE_READWRITE) ? length : 0;
+    }
+
+    // Decommitting drops the pages, committing again leaves the range usable, with zeroed pages faulted in on first touch
+    if( !VirtualFree(pages, length, MEM_DECOMMIT) )
+    {
+        return 0;
+    }
+
+    return VirtualAlloc(pages, length, MEM_COMMIT, PAGE_READWRITE) ? length : 0;
+#else
+#ifdef MADV_FREE
+    // Explicit huge pages do not support MADV_FREE, so fall back to dropping them
+    if( mode == PurgeMode::Lazy && madvise(pages, length, MADV_FREE) == 0 )
+    {
+        return length;
+    }
+#endif
+    return madvise(pages, length, MADV_DONTNEED) == 0 ? length : 0;
+#endif
+}
+
+//------------------------------------------------------------------------------
+size_t BackingStore::getResidentBytes(const void * p, size_t size)
+{
+#ifdef _WIN32
+    return size;
+#else
+    if( !size )
+    {
+        return 0;
+    }
+
+    // mincore() wants a page aligned start, and reports one byte per page
+    const size_t    pageSize = getPageSize();
+    const uintptr_t first    = reinterpret_cast<uintptr_t>(p) & ~static_cast<uintptr_t>(pageSize - 1);
+    const uintptr_t last     = roundUp(reinterpret_cast<uintptr_t>(p) + size, pageSize);
+
+    // Ask for a bounded number of pages at a time
+    const size_t maxPages = 4096;
+    std::vector<unsigned char> pageStates(maxPages);
+    size_t numResidentPages = 0;
+
+    for( uintptr_t start = first; start < last; start += maxPages * pageSize )
+    {
+        const size_t numPages = std::min<size_t>(maxPages, (last - start) / pageSize);
+
+#ifdef __APPLE__
+        if( mincore(reinterpret_cast<void *>(start), numPages * pageSize, reinterpret_cast<char *>(pageStates.data())) != 0 )
+#else
+        if( mincore(reinterpret_cast<void *>(start), numPages * pageSize, pageStates.data()) != 0 )
+#endif
+        {
+            return size;
+        }
+
+        for( size_t page = 0; page < numPages; ++page )
+        {
+            numResidentPages += pageStates[page] & 1;
+        }
+    }
+
+    return std::min(size, numResidentPages * pageSize);
+#endif
+}
+
+//------------------------------------------------------------------------------
+void * BackingStore::mapFile(const std::string & path, size_t & size, bool truncate)
+{
+#ifdef _WIN32
+    const DWORD disposition = truncate ? CREATE_ALWAYS : (size ? OPEN_ALWAYS : OPEN_EXISTING);
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, disposition, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if( file == INVALID_HANDLE_VALUE )
+    {
+        return nullptr;
+    }
+
+    LARGE_INTEGER fileSize;
+
+    if( !GetFileSizeEx(file, &fileSize) )
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    if( static_cast<uint64_t>(fileSize.QuadPart) < size )
+    {
+        fileSize.QuadPart = static_cast<LONGLONG>(size);
+
+        if( !SetFilePointerEx(file, fileSize, nullptr, FILE_BEGIN) || !SetEndOfFile(file) )
+        {
+            CloseHandle(file);
+            return nullptr;
+        }
+    }
+
+    size = static_cast<size_t>(fileSize.QuadPart);
+
+    if( !size )
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    // The view keeps the mapping, and the mapping the file, open once their handles are closed
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+    CloseHandle(file);
+
+    if( !mapping )
+    {
+        return nullptr;
+    }
+
+    void * p = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    CloseHandle(mapping);
+
+    return p;
+#else
+    const int flags = O_RDWR | (truncate || size ? O_CREAT : 0) | (truncate ? O_TRUNC : 0);
+    const int file  = open(path.c_str(), flags, 0644);
+
+    if( file < 0 )
+    {
+        return nullptr;
+    }
+
+    struct stat fileStatus;
+
+    if( fstat(file, &fileStatus) != 0 )
+    {
+        close(file);
+        return nullptr;
+    }
+
+    if( static_cast<size_t>(fileStatus.st_size) < size )
+    {
+        if( ftruncate(file, static_cast<off_t>(size)) != 0 )
+        {
+            close(file);
+            return nullptr;
+        }
+    }
+    else
+    {
+        size = static_cast<size_t>(fileStatus.st_size);
+    }
+
+    if( !size )
+    {
+        close(file);
+        return nullptr;
+    }
+
+    // The mapping keeps the file open once its descriptor is closed
+    void * p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    close(file);
+
+    return p != MAP_FAILED ? p : nullptr;
+#endif
+}
+
+//------------------------------------------------------------------------------
+void BackingStore::unmapFile(void * p, size_t size)
+{
+    if( !p )
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(p);
+#else
+    munmap(p, size);
+#endif
+}
+
+//------------------------------------------------------------------------------
+bool BackingStore::flushFile(void * p, size_t size)
+{
+#ifdef _WIN32
+    // Only starts the writes, there is no file handle left to wait on them with
+    return FlushViewOfFile(p, size) != 0;
+#else
+    return msync(p, size, MS_SYNC) == 0;
+#endif
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+// Standard Includes
+#include <cstddef>
+#include <string>
+
+//------------------------------------------------------------------------------
+// Where memory managers get the memory they manage from
+//
+// Every memory manager takes a policy at construction. If the requested policy is not available on this system,
+// allocate() falls back to the next best one and updates the policy, so that release() is given the one actually used.
+class BackingStore
+{
+public:
+
+    enum class Policy
+    {
+        Malloc,      // ::malloc, pages are faulted in on first touch
+        Prefaulted,  // Page aligned memory from the OS, with every page faulted in up front
+        HugePages,   // Prefaulted huge pages, falls back to transparent huge pages and then to Prefaulted
+        Mapped       // Page aligned memory from the OS, faulted in on first touch. Never calls ::malloc, so it is safe to use
+                     // from inside a replacement malloc. Falls back to Malloc.
+    };
+
+    // How purged pages are handed back to the OS
+    enum class PurgeMode
+    {
+        Eager,       // The pages are dropped at once, and read as zero when next touched
+        Lazy         // The OS takes the pages only when it runs short of memory, they stay resident until then
+    };
+
+    // Returns nullptr if the system failed to allocate the requested size
+    static void * allocate(size_t size, Policy & policy);
+    static void release(void * p, size_t size, Policy policy);
+
+    // Hands the pages that lie wholly inside [p, p + size) back to the OS, keeping the address range.
+    // Their contents are lost. Returns the bytes handed back, 0 if there are none or the OS refused.
+    static size_t purge(void * p, size_t size, Policy policy, PurgeMode mode);
+
+    // Bytes of the pages overlapping [p, p + size) that are resident now, or size where that cannot be found
+    static size_t getResidentBytes(const void * p, size_t size);
+
+    static size_t getPageSize();
+    static size_t getHugePageSize();
+
+    // Size of the pages memory from the policy is mapped in, which is also the granularity of purge()
+    static size_t getPageSize(Policy policy);
+
+    // Maps the file at path, creating it if there is none, shared and writable, so that writes to the memory reach the file.
+    // A file smaller than size is grown to size with zeros, truncate empties it first. A size of 0 maps an existing file
+    // as it is, without creating one. On return size holds the size of the file.
+    // Returns nullptr if the file could not be opened, sized or mapped, or is empty.
+    static void * mapFile(const std::string & path, size_t & size, bool truncate);
+    static void unmapFile(void * p, size_t size);
+
+    // Writes the modified pages of a mapped file in [p, p + size) back to the file, waiting for the writes everywhere but Windows,
+    // where they are only started. Returns false if the OS reported an error.
+    static bool flushFile(void * p, size_t size);
+};
@@ -0,0 +1,241 @@
+
+// Project Includes
+#include "BenchmarkHarness.h"
+
+// Common Libary
+#include "Exception.h"
+
+// Standard Includes
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <sstream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+//------------------------------------------------------------------------------
+static const char * g_freeOrderNames[] = { "fifo", "lifo", "random" };
+
+//------------------------------------------------------------------------------
+BenchmarkParameters::BenchmarkParameters()
+    :
+    m_numElements(1000)
+  , m_objectSize(24)
+  , m_iterations(1000)
+  , m_numThreads(1)
+  , m_freeOrder(FreeOrder::Fifo)
+  , m_warmupRuns(1)
+  , m_repeats(5)
+{
+}
+
+//------------------------------------------------------------------------------
+BenchmarkParameters BenchmarkParameters::parse(int argc, char * argv[], const BenchmarkParameters & defaults)
+{
+    BenchmarkParameters parameters(defaults);
+
+    for( int index = 1; index < argc; index += 2 )
+    {
+        const std::string option(argv[index]);
+
+        if( index + 1 == argc )
+        {
+            // Error - Every option takes a value
+            const std::string msg("Option " + option + " needs a value.");
+            throw Common::Exception(__FILE__, __LINE__, msg);
+        }
+
+        const std::string value(argv[index + 1]);
+
+        if( option == "--free-order" )
+        {
+            const char ** name = std::find(std::begin(g_freeOrderNames), std::end(g_freeOrderNames), value);
+
+            if( name == std::end(g_freeOrderNames) )
+            {
+                // Error - Unknown free order
+                const std::string msg("Free order must be fifo, lifo or random, not " + value + ".");
+                throw Common::Exception(__FILE__, __LINE__, msg);
+            }
+
+            parameters.m_freeOrder = static_cast<FreeOrder>(name - std::begin(g_freeOrderNames));
+            continue;
+        }
+
+        size_t * field = nullptr;
+        size_t   minimum = 1;
+
+        if( option == "--elements" )
+        {
+            field = &parameters.m_numElements;
+        }
+        else if( option == "--size" )
+        {
+            field = &parameters.m_objectSize;
+        }
+        else if( option == "--iterations" )
+        {
+            field = &parameters.m_iterations;
+        }
+        else if( option == "--threads" )
+        {
+            field = &parameters.m_numThreads;
+        }
+        else if( option == "--warmup" )
+        {
+            field   = &parameters.m_warmupRuns;
+            minimum = 0;
+        }
+        else if( option == "--repeats" )
+        {
+            field = &parameters.m_repeats;
+        }
+        else
+        {
+            // Error - Unknown option
+            const std::string msg("Unknown option " + option + ".");
+            throw Common::Exception(__FILE__, __LINE__, msg);
+        }
+
+        char * end = nullptr;
+        const unsigned long long number = std::strtoull(value.c_str(), &end, 10);
+
+        if( value.empty() || *end != '\0' || value[0] == '-' || number < minimum )
+        {
+            // Error - Not a count
+            const std::string msg("Option " + option + " needs a whole number of at least " + std::to_string(minimum) + ", not " + value + ".");
+            throw Common::Exception(__FILE__, __LINE__, msg);
+        }
+
+        *field = static_cast<size_t>(number);
+    }
+
+    return parameters;
+}
+
+//------------------------------------------------------------------------------
+uint8_t BenchmarkParameters::getAlignment() const
+{
+    const size_t maxAlignment = 16;
+    const size_t alignment    = m_objectSize & (~m_objectSize + 1);
+
+    return static_cast<uint8_t>(std::min(alignment, maxAlignment));
+}
+
+//------------------------------------------------------------------------------
+size_t BenchmarkParameters::getNumOperations() const
+{
+    return 2 * m_numElements * m_iterations * m_numThreads;
+}
+
+//------------------------------------------------------------------------------
+std::string BenchmarkParameters::toString() const
+{
+    std::ostringstream text;
+    text << m_numElements << " elements of " << m_objectSize << " bytes, " << m_iterations << " iterations, "
+         << m_numThreads << (m_numThreads == 1 ? " thread, " : " threads, ") << g_freeOrderNames[static_cast<int>(m_freeOrder)]
+         << " free order, " << m_warmupRuns << " warm up and " << m_repeats << " timed runs";
+
+    return text.str();
+}
+
+//------------------------------------------------------------------------------
+BenchmarkResult::BenchmarkResult()
+    :
+    m_nsPerOperation(0.0)
+  , m_minNsPerOperation(0.0)
+  , m_p50(0)
+  , m_p99(0)
+  , m_residentBytes(0)
+{
+}
+
+//------------------------------------------------------------------------------
+std::string BenchmarkResult::toString() const
+{
+    std::ostringstream text;
+    text.precision(3);
+    text << std::fixed << "Test with " << m_name << " took " << m_nsPerOperation << " ns per operation (fastest "
+         << m_minNsPerOperation << "), latency p50 " << m_p50 << " ns, p99 " << m_p99 << " ns, RSS "
+         << m_residentBytes / 1024 << " KiB.";
+
+    return text.str();
+}
+
+//------------------------------------------------------------------------------
+BenchmarkTiming::BenchmarkTiming()
+    :
+    m_seconds(0.0)
+  , m_minSeconds(0.0)
+{
+}
+
+//------------------------------------------------------------------------------
+std::string BenchmarkTiming::toString() const
+{
+    std::ostringstream text;
+    text << m_seconds << " seconds (fastest " << m_minSeconds << ")";
+
+    return text.str();
+}
+
+//------------------------------------------------------------------------------
+BenchmarkHarness::BenchmarkHarness(const BenchmarkParameters & parameters)
+    :
+    m_parameters(parameters)
+  , m_freeOrder(parameters.m_numElements)
+{
+    std::iota(m_freeOrder.begin(), m_freeOrder.end(), 0);
+
+    if( m_parameters.m_freeOrder == FreeOrder::Lifo )
+    {
+        std::reverse(m_freeOrder.begin(), m_freeOrder.end());
+    }
+    else if( m_parameters.m_freeOrder == FreeOrder::Random )
+    {
+        std::shuffle(m_freeOrder.begin(), m_freeOrder.end(), std::mt19937(12345));
+    }
+}
+
+//------------------------------------------------------------------------------
+const BenchmarkParameters & BenchmarkHarness::getParameters() const
+{
+    return m_parameters;
+}
+
+//------------------------------------------------------------------------------
+size_t BenchmarkHarness::getResidentSetSize()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if( !GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) )
+    {
+        return 0;
+    }
+
+    return counters.WorkingSetSize;
+#else
+    // The second field is the number of resident pages
+    FILE * file = fopen("/proc/self/statm", "r");
+
+    if( !file )
+    {
+        return 0;
+    }
+
+    unsigned long long totalPages    = 0;
+    unsigned long long residentPages = 0;
+    const int          numFields     = fscanf(file, "%llu %llu", &totalPages, &residentPages);
+    fclose(file);
+
+    return numFields == 2 ? static_cast<size_t>(residentPages * sysconf(_SC_PAGESIZE)) : 0;
+#endif
+}
@@ -0,0 +1,400 @@
+#pragma once
+
+// Standard Includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+//------------------------------------------------------------------------------
+enum class FreeOrder
+{
+    Fifo,     // Free in the order allocated
+    Lifo,     // Free in the reverse of the order allocated
+    Random    // Free in a shuffled order
+};
+
+//------------------------------------------------------------------------------
+// What a benchmark run does: every thread allocates m_numElements objects of m_objectSize bytes, writes to them,
+// then frees them all in m_freeOrder, m_iterations times over
+struct BenchmarkParameters
+{
+    size_t    m_numElements;   // Objects allocated, then freed, by each thread in every iteration
+    size_t    m_objectSize;    // Size of each object, in bytes
+    size_t    m_iterations;    // Iterations in each run
+    size_t    m_numThreads;    // Threads sharing the memory manager
+    FreeOrder m_freeOrder;
+    size_t    m_warmupRuns;    // Untimed runs before the timed ones
+    size_t    m_repeats;       // Timed runs, the median is reported
+
+    BenchmarkParameters();
+
+    // Reads --elements, --size, --iterations, --threads, --free-order fifo|lifo|random, --warmup and --repeats,
+    // starting from the given defaults. Throws if an option is unknown or its value is missing or out of range.
+    static BenchmarkParameters parse(int argc, char * argv[], const BenchmarkParameters & defaults);
+
+    // Largest power of two that divides the object size, at most 16
+    uint8_t getAlignment() const;
+
+    // Allocations and frees in one run, over every thread
+    size_t getNumOperations() const;
+
+    std::string toString() const;
+};
+
+//------------------------------------------------------------------------------
+struct BenchmarkResult
+{
+    std::string m_name;
+    double      m_nsPerOperation;      // Median of the timed runs
+    double      m_minNsPerOperation;   // Fastest of the timed runs
+    uint64_t    m_p50;                 // Latency of a single allocate or free, in nanoseconds
+    uint64_t    m_p99;
+    size_t      m_residentBytes;       // Resident set size of the whole process after the runs, with the memory manager alive
+
+    BenchmarkResult();
+    std::string toString() const;
+};
+
+//------------------------------------------------------------------------------
+// Time taken by a workload that does not fit BenchmarkParameters, or by one phase of it
+struct BenchmarkTiming
+{
+    double m_seconds;      // Median of the timed runs
+    double m_minSeconds;   // Fastest of the timed runs
+
+    BenchmarkTiming();
+    std::string toString() const;
+};
+
+//------------------------------------------------------------------------------
+// Runs BenchmarkParameters against a target, which adapts a memory manager to three calls:
+//
+//     void * allocate(size_t size, uint8_t alignment);
+//     void free(void * p, size_t size, uint8_t alignment);
+//     void release();    // Called by each thread once it has freed every object of an iteration
+//
+// Calls are bound at compile time, so the target adds nothing to the cost of the memory manager.
+// With more than one thread, every thread calls the same target at once, so it must be thread safe.
+//
+// runBatch() instead allocates and frees each iteration's objects with one call each, so the target must also provide:
+//
+//     void allocateBatch(size_t count, size_t size, uint8_t alignment, void ** out);
+//     void freeBatch(void ** ptrs, size_t count, size_t size, uint8_t alignment);
+//
+// Throughput is taken from whole runs, the median and fastest of the repeats are reported.
+// Latency is taken from one more run that times every call, so that reading the clock does not skew the throughput.
+// In a batch run every call handles a whole batch, so the latency is that of a batch rather than of one object.
+//
+// time() and timePhases() run any other workload with the same warm up and timed runs, see below.
+class BenchmarkHarness
+{
+protected:
+
+    static const size_t MAX_LATENCY_SAMPLES = 1000000;  // Per thread, bounds the iterations of the latency run
+
+    BenchmarkParameters m_parameters;
+    std::vector<size_t> m_freeOrder;                     // Index of the object freed at each step of an iteration
+
+    template <bool RecordLatency, bool Batch, class Target>
+    void work(Target & target, size_t iterations, std::vector<uint64_t> & latencies) const;
+
+    // Returns the seconds taken by every thread to finish
+    template <bool RecordLatency, bool Batch, class Target>
+    double runOnce(Target & target, size_t iterations, std::vector<std::vector<uint64_t>> & latencies) const;
+
+    template <bool Batch, class Target>
+    BenchmarkResult runWorkload(const std::string & name, Target & target) const;
+
+public:
+
+    explicit BenchmarkHarness(const BenchmarkParameters & parameters);
+
+    const BenchmarkParameters & getParameters() const;
+
+    template <class Target>
+    BenchmarkResult run(const std::string & name, Target & target) const;
+
+    template <class Target>
+    BenchmarkResult runBatch(const std::string & name, Target & target) const;
+
+    // Times a workload that does not fit the allocate and free pattern, given as a call that does a whole run:
+    //
+    //     void operator () ();
+    //
+    // It is called m_warmupRuns times untimed, then m_repeats times timed. The other parameters are up to the workload.
+    template <class Workload>
+    BenchmarkTiming time(Workload && workload) const;
+
+    // As time(), for a workload that times its own phases, and returns the seconds each took:
+    //
+    //     std::vector<double> operator () ();
+    //
+    // Every run must return the same number of phases. Returns the median and fastest of each phase.
+    template <class Workload>
+    std::vector<BenchmarkTiming> timePhases(Workload && workload) const;
+
+    // Bytes of the process that are resident in physical memory now, or 0 where that cannot be found
+    static size_t getResidentSetSize();
+};
+
+//------------------------------------------------------------------------------
+template <bool RecordLatency, bool Batch, class Target>
+void BenchmarkHarness::work(Target & target, size_t iterations, std::vector<uint64_t> & latencies) const
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const size_t  size      = m_parameters.m_objectSize;
+    const uint8_t alignment = m_parameters.getAlignment();
+
+    std::vector<void *> objects(m_parameters.m_numElements);
+    std::vector<void *> freedObjects(Batch ? m_parameters.m_numElements : 0);
+
+    for( size_t i = 0; i < iterations; ++i )
+    {
+        if constexpr( Batch )
+        {
+            const Clock::time_point allocateStart = Clock::now();
+            target.allocateBatch(objects.size(), size, alignment, objects.data());
+
+            if( RecordLatency )
+            {
+                latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - allocateStart).count());
+            }
+
+            // Write to every byte, and hand the objects back in the free order
+            for( size_t j = 0; j < objects.size(); ++j )
+            {
+                memset(objects[j], static_cast<int>(i), size);
+                freedObjects[j] = objects[m_freeOrder[j]];
+            }
+
+            const Clock::time_point freeStart = Clock::now();
+            target.freeBatch(freedObjects.data(), freedObjects.size(), size, alignment);
+
+            if( RecordLatency )
+            {
+                latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - freeStart).count());
+            }
+
+            target.release();
+            continue;
+        }
+
+        // Allocate, and write to every byte, as a constructor would
+        for( size_t j = 0; j < objects.size(); ++j )
+        {
+            if( RecordLatency )
+            {
+                const Clock::time_point start = Clock::now();
+                objects[j] = target.allocate(size, alignment);
+                latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+            }
+            else
+            {
+                objects[j] = target.allocate(size, alignment);
+            }
+
+            memset(objects[j], static_cast<int>(i), size);
+        }
+
+        // Free
+        for( size_t j = 0; j < objects.size(); ++j )
+        {
+            void * p = objects[m_freeOrder[j]];
+
+            if( RecordLatency )
+            {
+                const Clock::time_point start = Clock::now();
+                target.free(p, size, alignment);
+                latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+            }
+            else
+            {
+                target.free(p, size, alignment);
+            }
+        }
+
+        target.release();
+    }
+}
+
+//------------------------------------------------------------------------------
+template <bool RecordLatency, bool Batch, class Target>
+double BenchmarkHarness::runOnce(Target & target, size_t iterations, std::vector<std::vector<uint64_t>> & latencies) const
+{
+    typedef std::chrono::steady_clock Clock;
+
+    latencies.resize(m_parameters.m_numThreads);
+
+    if( m_parameters.m_numThreads == 1 )
+    {
+        const Clock::time_point start = Clock::now();
+        work<RecordLatency, Batch>(target, iterations, latencies[0]);
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // Hold every thread at the start line, so that thread creation is not timed
+    std::atomic<size_t> numReady(0);
+    std::atomic<bool>   go(false);
+    std::vector<std::thread> threads;
+
+    for( size_t t = 0; t < m_parameters.m_numThreads; ++t )
+    {
+        threads.emplace_back([&, t]()
+        {
+            ++numReady;
+
+            while( !go.load(std::memory_order_acquire) )
+            {
+                std::this_thread::yield();
+            }
+
+            work<RecordLatency, Batch>(target, iterations, latencies[t]);
+        });
+    }
+
+    while( numReady.load() != m_parameters.m_numThreads )
+    {
+        std::this_thread::yield();
+    }
+
+    const Clock::time_point start = Clock::now();
+    go.store(true, std::memory_order_release);
+
+    for( std::thread & thread : threads )
+    {
+        thread.join();
+    }
+
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//------------------------------------------------------------------------------
+template <class Target>
+BenchmarkResult BenchmarkHarness::run(const std::string & name, Target & target) const
+{
+    return runWorkload<false>(name, target);
+}
+
+//------------------------------------------------------------------------------
+template <class Target>
+BenchmarkResult BenchmarkHarness::runBatch(const std::string & name, Target & target) const
+{
+    return runWorkload<true>(name, target);
+}
+
+//------------------------------------------------------------------------------
+template <bool Batch, class Target>
+BenchmarkResult BenchmarkHarness::runWorkload(const std::string & name, Target & target) const
+{
+    std::vector<std::vector<uint64_t>> latencies;
+
+    for( size_t run = 0; run < m_parameters.m_warmupRuns; ++run )
+    {
+        runOnce<false, Batch>(target, m_parameters.m_iterations, latencies);
+    }
+
+    std::vector<double> secondsElapsed;
+
+    for( size_t run = 0; run < m_parameters.m_repeats; ++run )
+    {
+        secondsElapsed.push_back(runOnce<false, Batch>(target, m_parameters.m_iterations, latencies));
+    }
+
+    std::sort(secondsElapsed.begin(), secondsElapsed.end());
+
+    const double nsPerSecond   = 1e9;
+    const double numOperations = static_cast<double>(m_parameters.getNumOperations());
+
+    BenchmarkResult result;
+    result.m_name              = name;
+    result.m_nsPerOperation    = secondsElapsed[secondsElapsed.size() / 2] * nsPerSecond / numOperations;
+    result.m_minNsPerOperation = secondsElapsed.front() * nsPerSecond / numOperations;
+
+    // Every iteration records two samples per object, keep the samples held at once bounded
+    const size_t samplesPerIteration = 2 * m_parameters.m_numElements;
+    const size_t latencyIterations   = std::max<size_t>(1, std::min(m_parameters.m_iterations, MAX_LATENCY_SAMPLES / samplesPerIteration));
+
+    for( std::vector<uint64_t> & threadLatencies : latencies )
+    {
+        threadLatencies.reserve(samplesPerIteration * latencyIterations);
+    }
+
+    runOnce<true, Batch>(target, latencyIterations, latencies);
+
+    std::vector<uint64_t> samples;
+
+    for( const std::vector<uint64_t> & threadLatencies : latencies )
+    {
+        samples.insert(samples.end(), threadLatencies.begin(), threadLatencies.end());
+    }
+
+    if( !samples.empty() )
+    {
+        std::sort(samples.begin(), samples.end());
+        result.m_p50 = samples[samples.size() / 2];
+        result.m_p99 = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+    }
+
+    result.m_residentBytes = getResidentSetSize();
+    return result;
+}
+
+//------------------------------------------------------------------------------
+template <class Workload>
+BenchmarkTiming BenchmarkHarness::time(Workload && workload) const
+{
+    typedef std::chrono::steady_clock Clock;
+
+    return timePhases([&workload]()
+    {
+        const Clock::time_point start = Clock::now();
+        workload();
+        return std::vector<double>(1, std::chrono::duration<double>(Clock::now() - start).count());
+    }).front();
+}
+
+//------------------------------------------------------------------------------
+template <class Workload>
+std::vector<BenchmarkTiming> BenchmarkHarness::timePhases(Workload && workload) const
+{
+    for( size_t run = 0; run < m_parameters.m_warmupRuns; ++run )
+    {
+        workload();
+    }
+
+    // Seconds taken by each phase, in every timed run
+    std::vector<std::vector<double>> phaseSeconds;
+
+    for( size_t run = 0; run < m_parameters.m_repeats; ++run )
+    {
+        const std::vector<double> secondsElapsed = workload();
+        phaseSeconds.resize(secondsElapsed.size());
+
+        for( size_t phase = 0; phase < secondsElapsed.size(); ++phase )
+        {
+            phaseSeconds[phase].push_back(secondsElapsed[phase]);
+        }
+    }
+
+    std::vector<BenchmarkTiming> timings(phaseSeconds.size());
+
+    for( size_t phase = 0; phase < phaseSeconds.size(); ++phase )
+    {
+        std::vector<double> & seconds = phaseSeconds[phase];
+        std::sort(seconds.begin(), seconds.end());
+
+        timings[phase].m_seconds    = seconds[seconds.size() / 2];
+        timings[phase].m_minSeconds = seconds.front();
+    }
+
+    return timings;
+}
+
+//------------------------------------------------------------------------------
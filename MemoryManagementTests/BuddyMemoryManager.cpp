@@ -0,0 +1,435 @@
+
+// Project Includes
+#include "BuddyMemoryManager.h"
+
+// Common Libary
+#include "Exception.h"
+
+// Standard Includes
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Index of the lowest set bit. value must be non-zero.
+static size_t findFirstSet(uint64_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return index;
+#else
+    return static_cast<size_t>(__builtin_ctzll(value));
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Index of the highest set bit. value must be non-zero.
+static size_t findLastSet(uint64_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return index;
+#else
+    return static_cast<size_t>(63 - __builtin_clzll(value));
+#endif
+}
+
+//------------------------------------------------------------------------------
+BuddyMemoryManager::BuddyMemoryManager(size_t size, size_t minBlockSize, BackingStore::Policy backingStorePolicy)
+    :
+    m_size(0)
+  , m_memory(nullptr)
+  , m_start(nullptr)
+  , m_capacity(0)
+  , m_minBlockSize(minBlockSize)
+  , m_minBlockSizeLog2(0)
+  , m_maxOrder(0)
+  , m_usedMemory(0)
+  , m_numAllocations(0)
+  , m_freeLists()
+  , m_nonEmptyOrders(0)
+  , m_pairBitBase()
+  , m_backingStorePolicy(backingStorePolicy)
+  , m_statistics()
+{
+    if( minBlockSize < sizeof(FreeBlock) || (minBlockSize & (minBlockSize - 1)) )
+    {
+        // Error - Invalid block size
+        const std::string msg("Invalid minimum block size. It must be a power of two large enough to hold a free block.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( size < minBlockSize )
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid size requested. Size must be large enough to hold at least one block.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    m_minBlockSizeLog2 = findLastSet(minBlockSize);
+    m_capacity         = size & ~(minBlockSize - 1);
+    m_maxOrder         = findLastSet(m_capacity) - m_minBlockSizeLog2;
+
+    // Leave room to align the first block, so that every block is aligned to its size, up to MAX_ALIGNMENT
+    m_size   = m_capacity + MAX_ALIGNMENT;
+    m_memory = BackingStore::allocate(m_size, m_backingStorePolicy);
+
+    if( !m_memory )
+    {
+        // Error - System failed to allocate requested size
+        const std::string msg("System failed to allocate requested size");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    m_start = reinterpret_cast<uint8_t *>((reinterpret_cast<uintptr_t>(m_memory) + MAX_ALIGNMENT - 1) & ~static_cast<uintptr_t>(MAX_ALIGNMENT - 1));
+
+    // One pair bit for every pair of buddies below the largest order, counting pairs that run off the end of memory
+    const size_t numMinBlocks = m_capacity >> m_minBlockSizeLog2;
+    size_t numPairBits = 0;
+
+    for( size_t order = 0; order < m_maxOrder; ++order )
+    {
+        m_pairBitBase[order] = numPairBits;
+        numPairBits += (numMinBlocks + (static_cast<size_t>(2) << order) - 1) >> (order + 1);
+    }
+
+    try
+    {
+        m_pairBits.resize((numPairBits + 63) / 64);
+        m_blockOrders.resize(numMinBlocks);
+    }
+    catch( ... )
+    {
+        BackingStore::release(m_memory, m_size, m_backingStorePolicy);
+        throw;
+    }
+
+    // Cut the memory into blocks of decreasing order, each starts at a multiple of its size because the ones before are larger
+    size_t offset = 0;
+
+    for( size_t order = m_maxOrder + 1; order-- > 0; )
+    {
+        const size_t blockSize = m_minBlockSize << order;
+
+        if( m_capacity - offset >= blockSize )
+        {
+            pushFreeBlock(offset, order);
+            offset += blockSize;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+BuddyMemoryManager::~BuddyMemoryManager()
+{
+    BackingStore::release(m_memory, m_size, m_backingStorePolicy);
+}
+
+//------------------------------------------------------------------------------
+size_t BuddyMemoryManager::getOrder(size_t size) const
+{
+    if( size <= m_minBlockSize )
+    {
+        return 0;
+    }
+
+    return findLastSet(size - 1) + 1 - m_minBlockSizeLog2;
+}
+
+//------------------------------------------------------------------------------
+size_t BuddyMemoryManager::getBlockIndex(const void * p) const
+{
+    const uint8_t * address = static_cast<const uint8_t *>(p);
+    const size_t    offset  = static_cast<size_t>(address - m_start);
+
+    if( address < m_start || offset >= m_capacity || (offset & (m_minBlockSize - 1)) || !m_blockOrders[offset >> m_minBlockSizeLog2] )
+    {
+        // Error - Not one of our blocks
+        const std::string msg("p was not allocated by this memory manager, or was already freed.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    return offset >> m_minBlockSizeLog2;
+}
+
+//------------------------------------------------------------------------------
+bool BuddyMemoryManager::togglePairBit(size_t offset, size_t order)
+{
+    if( order == m_maxOrder )
+    {
+        return false;
+    }
+
+    const size_t index = m_pairBitBase[order] + (offset >> (m_minBlockSizeLog2 + order + 1));
+    m_pairBits[index / 64] ^= 1ull << (index % 64);
+
+    return (m_pairBits[index / 64] >> (index % 64)) & 1;
+}
+
+//------------------------------------------------------------------------------
+bool BuddyMemoryManager::getPairBit(size_t offset, size_t order) const
+{
+    if( order == m_maxOrder )
+    {
+        return false;
+    }
+
+    const size_t index = m_pairBitBase[order] + (offset >> (m_minBlockSizeLog2 + order + 1));
+    return (m_pairBits[index / 64] >> (index % 64)) & 1;
+}
+
+//------------------------------------------------------------------------------
+void BuddyMemoryManager::pushFreeBlock(size_t offset, size_t order)
+{
+    FreeBlock * freeBlock = reinterpret_cast<FreeBlock *>(m_start + offset);
+    freeBlock->m_next     = m_freeLists[order];
+    freeBlock->m_previous = nullptr;
+
+    if( freeBlock->m_next != nullptr )
+    {
+        freeBlock->m_next->m_previous = freeBlock;
+    }
+
+    m_freeLists[order] = freeBlock;
+    m_nonEmptyOrders |= 1ull << order;
+
+    togglePairBit(offset, order);
+}
+
+//------------------------------------------------------------------------------
+void BuddyMemoryManager::removeFreeBlock(size_t offset, size_t order)
+{
+    FreeBlock * freeBlock = reinterpret_cast<FreeBlock *>(m_start + offset);
+
+    if( freeBlock->m_next != nullptr )
+    {
+        freeBlock->m_next->m_previous = freeBlock->m_previous;
+    }
+
+    if( freeBlock->m_previous != nullptr )
+    {
+        freeBlock->m_previous->m_next = freeBlock->m_next;
+    }
+    else
+    {
+        m_freeLists[order] = freeBlock->m_next;
+
+        if( !freeBlock->m_next )
+        {
+            m_nonEmptyOrders &= ~(1ull << order);
+        }
+    }
+
+    togglePairBit(offset, order);
+}
+
+//------------------------------------------------------------------------------
+void * BuddyMemoryManager::allocate(size_t size, uint8_t alignment)
+{
+    if( size <= 0 )
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid size requested. Size must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( !alignment || (alignment & (alignment - 1)) )
+    {
+        // Error - Invalid alignment
+        const std::string msg("Invalid alignment. Alignment must be a power of two.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    // Every block is aligned to its size, so a block at least as large as the alignment is aligned
+    const size_t order     = getOrder(std::max<size_t>(size, alignment));
+    const uint64_t orders  = order <= m_maxOrder ? m_nonEmptyOrders & (~0ull << order) : 0;
+
+    if( !orders )
+    {
+        m_statistics.recordFailure();
+
+        const std::string msg("No free space large enough to accomodate requested size was found.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    // Take the smallest free block that fits, and split it down, freeing the upper half each time
+    size_t blockOrder = findFirstSet(orders);
+    const size_t offset = static_cast<size_t>(reinterpret_cast<uint8_t *>(m_freeLists[blockOrder]) - m_start);
+    removeFreeBlock(offset, blockOrder);
+
+    while( blockOrder > order )
+    {
+        --blockOrder;
+        pushFreeBlock(offset + (m_minBlockSize << blockOrder), blockOrder);
+    }
+
+    m_blockOrders[offset >> m_minBlockSizeLog2] = static_cast<uint8_t>(order + 1);
+
+    const size_t blockSize = m_minBlockSize << order;
+    m_usedMemory += blockSize;
+    ++m_numAllocations;
+    m_statistics.recordAllocation(size, blockSize - size, 0, m_usedMemory);
+
+    return m_start + offset;
+}
+
+//------------------------------------------------------------------------------
+void BuddyMemoryManager::free(void * p)
+{
+    if( !p )
+    {
+        // Error - p is nullptr
+        const std::string msg("p is nullptr");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    const size_t blockIndex = getBlockIndex(p);
+    size_t       order      = m_blockOrders[blockIndex] - 1;
+    size_t       offset     = blockIndex << m_minBlockSizeLog2;
+
+    m_blockOrders[blockIndex] = 0;
+    m_usedMemory -= m_minBlockSize << order;
+    --m_numAllocations;
+    m_statistics.recordFree();
+
+    // While the buddy is free, the pair bit is set, take the buddy out of its list and carry on with the merged block
+    while( getPairBit(offset, order) )
+    {
+        const size_t buddyOffset = offset ^ (m_minBlockSize << order);
+        removeFreeBlock(buddyOffset, order);
+
+        offset = std::min(offset, buddyOffset);
+        ++order;
+    }
+
+    pushFreeBlock(offset, order);
+}
+
+//------------------------------------------------------------------------------
+void BuddyMemoryManager::free(void * p, size_t, uint8_t)
+{
+    // The order table already knows the size of every block
+    free(p);
+}
+
+//------------------------------------------------------------------------------
+void * BuddyMemoryManager::reallocate(void * p, size_t newSize, uint8_t alignment)
+{
+    if( !p )
+    {
+        return allocate(newSize, alignment);
+    }
+
+    if( newSize <= 0 )
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid size requested. Size must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( reinterpret_cast<uintptr_t>(p) % alignment == 0 && tryExpandInPlace(p, newSize) )
+    {
+        return p;
+    }
+
+    const size_t oldSize = getAllocationSize(p);
+    void * newAddress = allocate(newSize, alignment);
+
+    memcpy(newAddress, p, std::min(oldSize, newSize));
+    free(p);
+
+    return newAddress;
+}
+
+//------------------------------------------------------------------------------
+bool BuddyMemoryManager::tryExpandInPlace(void * p, size_t newSize)
+{
+    if( newSize <= 0 )
+    {
+        return false;
+    }
+
+    const size_t blockIndex = getBlockIndex(p);
+    const size_t order      = m_blockOrders[blockIndex] - 1;
+    const size_t offset     = blockIndex << m_minBlockSizeLog2;
+    const size_t newOrder   = getOrder(newSize);
+
+    if( newOrder > m_maxOrder )
+    {
+        return false;
+    }
+
+    if( newOrder < order )
+    {
+        // Free the upper half until the block is small enough, none of them can merge, their buddies are still ours
+        for( size_t halfOrder = order; halfOrder-- > newOrder; )
+        {
+            pushFreeBlock(offset + (m_minBlockSize << halfOrder), halfOrder);
+        }
+    }
+    else if( newOrder > order )
+    {
+        // The block must be the lower buddy at every order on the way up, and every upper buddy must be free
+        for( size_t halfOrder = order; halfOrder < newOrder; ++halfOrder )
+        {
+            if( (offset & (m_minBlockSize << halfOrder)) || !getPairBit(offset, halfOrder) )
+            {
+                return false;
+            }
+        }
+
+        for( size_t halfOrder = order; halfOrder < newOrder; ++halfOrder )
+        {
+            removeFreeBlock(offset + (m_minBlockSize << halfOrder), halfOrder);
+        }
+    }
+
+    m_blockOrders[blockIndex] = static_cast<uint8_t>(newOrder + 1);
+    m_usedMemory = m_usedMemory - (m_minBlockSize << order) + (m_minBlockSize << newOrder);
+    m_statistics.recordUsedMemory(m_usedMemory);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+size_t BuddyMemoryManager::getAllocationSize(const void * p) const
+{
+    return m_minBlockSize << (m_blockOrders[getBlockIndex(p)] - 1);
+}
+
+//------------------------------------------------------------------------------
+bool BuddyMemoryManager::owns(const void * p) const
+{
+    const uint8_t * address = static_cast<const uint8_t *>(p);
+    return address >= m_start && address < m_start + m_capacity;
+}
+
+//------------------------------------------------------------------------------
+MemoryStatistics BuddyMemoryManager::getStatistics() const
+{
+    MemoryStatistics statistics = m_statistics;
+    statistics.m_capacity       = m_capacity;
+    statistics.m_usedMemory     = m_usedMemory;
+    statistics.m_numAllocations = m_numAllocations;
+
+    size_t numFreeBlocks = 0;
+
+    for( uint64_t orders = m_nonEmptyOrders; orders; orders &= orders - 1 )
+    {
+        for( const FreeBlock * freeBlock = m_freeLists[findFirstSet(orders)]; freeBlock != nullptr; freeBlock = freeBlock->m_next )
+        {
+            ++numFreeBlocks;
+        }
+    }
+
+    const size_t largestFreeBlock = m_nonEmptyOrders ? m_minBlockSize << findLastSet(m_nonEmptyOrders) : 0;
+    statistics.setFreeBlocks(numFreeBlocks, m_capacity - m_usedMemory, largestFreeBlock);
+
+    return statistics;
+}
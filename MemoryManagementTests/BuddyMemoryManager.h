@@ -0,0 +1,92 @@
+#pragma once
+
+// Project Includes
+#include "BackingStore.h"
+#include "IMemoryManager.h"
+
+// Standard Includes
+#include <cstdint>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// A binary buddy allocator
+//
+// Every block is the minimum block size times a power of two, its order, and starts at an offset from the start
+// of the managed memory that is a multiple of its own size. Its buddy, the other half of the block it was split from,
+// is then found by flipping the bit of its offset that equals its size. Free blocks are kept in one list per order,
+// and one bit per pair of buddies records whether exactly one of the pair is free, so that a free can tell at once
+// whether to merge. Allocate and free split and merge at most once per order, so both are O(log n).
+//
+// Sizes are rounded up to a whole block, so the waste is bounded but can approach half of each block.
+// No header is kept, the order of each allocated block is kept in a table on the side.
+class BuddyMemoryManager : public IMemoryManager
+{
+protected:
+
+    struct FreeBlock
+    {
+        FreeBlock * m_next;
+        FreeBlock * m_previous;
+    };
+
+    static const size_t  MAX_ORDERS    = sizeof(size_t) * 8;
+    static const uint8_t MAX_ALIGNMENT = 128;   // Largest power of two alignment that can be requested
+
+    size_t    m_size;               // Size of the memory requested from the backing store, in bytes
+    void *    m_memory;             // Memory requested from the backing store
+    uint8_t * m_start;              // First address of the first block, aligned to MAX_ALIGNMENT
+    size_t    m_capacity;           // Bytes of memory in blocks, a multiple of the minimum block size
+    size_t    m_minBlockSize;       // Size of an order 0 block
+    size_t    m_minBlockSizeLog2;
+    size_t    m_maxOrder;           // Order of the largest block that fits
+    size_t    m_usedMemory;         // Number of bytes used, in whole blocks
+    size_t    m_numAllocations;     // Number of caller allocations that have occured
+
+    FreeBlock *           m_freeLists[MAX_ORDERS];
+    uint64_t              m_nonEmptyOrders;      // A set bit means the free list of that order is non-empty
+    std::vector<uint64_t> m_pairBits;            // Per pair of buddies, set when exactly one of them is free
+    size_t                m_pairBitBase[MAX_ORDERS];
+    std::vector<uint8_t>  m_blockOrders;         // Per minimum block, order + 1 of the allocated block starting there, or 0
+
+    BackingStore::Policy m_backingStorePolicy;
+    MemoryStatistics     m_statistics;
+
+    size_t getOrder(size_t size) const;
+    size_t getBlockIndex(const void * p) const;
+
+    // Flips the pair bit of the block at offset, returns the new value. Blocks of the largest order have no buddy.
+    bool togglePairBit(size_t offset, size_t order);
+    bool getPairBit(size_t offset, size_t order) const;
+
+    void pushFreeBlock(size_t offset, size_t order);
+    void removeFreeBlock(size_t offset, size_t order);
+
+public:
+
+    // Size is rounded down to a whole number of minimum blocks, which must be a power of two of at least 16 bytes.
+    // Memory that is not a power of two is split into blocks of decreasing order, which are never merged with each other.
+    BuddyMemoryManager(size_t size, size_t minBlockSize = 64, BackingStore::Policy backingStorePolicy = BackingStore::Policy::Malloc);
+    BuddyMemoryManager(const BuddyMemoryManager &) = delete;
+    BuddyMemoryManager & operator = (const BuddyMemoryManager &) = delete;
+    ~BuddyMemoryManager();
+
+    // Alignment must be a power of two, of at most MAX_ALIGNMENT
+    void * allocate(size_t size, uint8_t alignment);
+    void free(void * p);
+    void free(void * p, size_t size, uint8_t alignment);
+
+    void * reallocate(void * p, size_t newSize, uint8_t alignment);
+
+    // Shrinks by splitting off the upper halves, grows by merging with free buddies above
+    bool tryExpandInPlace(void * p, size_t newSize);
+
+    // Number of bytes the caller may use at p, the size of its block
+    size_t getAllocationSize(const void * p) const;
+
+    // Whether p lies inside the memory this manager hands out, which says nothing about whether it is allocated
+    bool owns(const void * p) const;
+
+    MemoryStatistics getStatistics() const;
+};
+
+//------------------------------------------------------------------------------
@@ -10,9 +10,43 @@ public:
     ComplexNumber(const ComplexNumber & rhs);
     virtual ~ComplexNumber();
 
+    double getRealPart() const;
+    double getComplexPart() const;
+    void set(double realPart, double complexPart);
+
+    // Replaces this number z with multiplier * z + addend
+    void multiplyAdd(const ComplexNumber & multiplier, const ComplexNumber & addend);
+
 protected:
 
     double m_realPart;
     double m_complexPart;
 };
 
+//------------------------------------------------------------------------------
+inline double ComplexNumber::getRealPart() const
+{
+    return m_realPart;
+}
+
+//------------------------------------------------------------------------------
+inline double ComplexNumber::getComplexPart() const
+{
+    return m_complexPart;
+}
+
+//------------------------------------------------------------------------------
+inline void ComplexNumber::set(double realPart, double complexPart)
+{
+    m_realPart    = realPart;
+    m_complexPart = complexPart;
+}
+
+//------------------------------------------------------------------------------
+inline void ComplexNumber::multiplyAdd(const ComplexNumber & multiplier, const ComplexNumber & addend)
+{
+    const double realPart = multiplier.m_realPart * m_realPart - multiplier.m_complexPart * m_complexPart + addend.m_realPart;
+    m_complexPart = multiplier.m_realPart * m_complexPart + multiplier.m_complexPart * m_realPart + addend.m_complexPart;
+    m_realPart    = realPart;
+}
+
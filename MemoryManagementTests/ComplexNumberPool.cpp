@@ -0,0 +1,529 @@
+
+// Project Includes
+#include "ComplexNumberPool.h"
+
+// Common Libary
+#include "Exception.h"
+
+// Standard Includes
+#include <algorithm>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define COMPLEX_NUMBER_POOL_X86_64
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+//------------------------------------------------------------------------------
+static void copyScalar(double * destination, const double * source, size_t count)
+{
+    for( size_t i = 0; i < count; ++i )
+    {
+        destination[i] = source[i];
+    }
+}
+
+//------------------------------------------------------------------------------
+static void fillScalar(double * destination, double value, size_t count)
+{
+    for( size_t i = 0; i < count; ++i )
+    {
+        destination[i] = value;
+    }
+}
+
+//------------------------------------------------------------------------------
+static void multiplyAddScalar(double * realParts, double * complexParts, size_t count,
+                              double multiplierReal, double multiplierComplex, double addendReal, double addendComplex)
+{
+    for( size_t i = 0; i < count; ++i )
+    {
+        const double realPart    = realParts[i];
+        const double complexPart = complexParts[i];
+
+        realParts[i]    = multiplierReal * realPart - multiplierComplex * complexPart + addendReal;
+        complexParts[i] = multiplierReal * complexPart + multiplierComplex * realPart + addendComplex;
+    }
+}
+
+#ifdef COMPLEX_NUMBER_POOL_X86_64
+
+// Chunks only promise the alignment of the backing store, so the kernels use unaligned loads and stores.
+// Tails shorter than a vector are left to the scalar kernels, which give the same results bit for bit.
+
+//------------------------------------------------------------------------------
+static void copySse2(double * destination, const double * source, size_t count)
+{
+    size_t i = 0;
+
+    for( ; i + 2 <= count; i += 2 )
+    {
+        _mm_storeu_pd(destination + i, _mm_loadu_pd(source + i));
+    }
+
+    copyScalar(destination + i, source + i, count - i);
+}
+
+//------------------------------------------------------------------------------
+static void fillSse2(double * destination, double value, size_t count)
+{
+    const __m128d values = _mm_set1_pd(value);
+    size_t i = 0;
+
+    for( ; i + 2 <= count; i += 2 )
+    {
+        _mm_storeu_pd(destination + i, values);
+    }
+
+    fillScalar(destination + i, value, count - i);
+}
+
+//------------------------------------------------------------------------------
+static void multiplyAddSse2(double * realParts, double * complexParts, size_t count,
+                            double multiplierReal, double multiplierComplex, double addendReal, double addendComplex)
+{
+    const __m128d multiplierReals     = _mm_set1_pd(multiplierReal);
+    const __m128d multiplierComplexes = _mm_set1_pd(multiplierComplex);
+    const __m128d addendReals         = _mm_set1_pd(addendReal);
+    const __m128d addendComplexes     = _mm_set1_pd(addendComplex);
+    size_t i = 0;
+
+    for( ; i + 2 <= count; i += 2 )
+    {
+        const __m128d realPart    = _mm_loadu_pd(realParts + i);
+        const __m128d complexPart = _mm_loadu_pd(complexParts + i);
+
+        _mm_storeu_pd(realParts + i, _mm_add_pd(_mm_sub_pd(_mm_mul_pd(multiplierReals, realPart),
+                                                           _mm_mul_pd(multiplierComplexes, complexPart)), addendReals));
+        _mm_storeu_pd(complexParts + i, _mm_add_pd(_mm_add_pd(_mm_mul_pd(multiplierReals, complexPart),
+                                                              _mm_mul_pd(multiplierComplexes, realPart)), addendComplexes));
+    }
+
+    multiplyAddScalar(realParts + i, complexParts + i, count - i, multiplierReal, multiplierComplex, addendReal, addendComplex);
+}
+
+//------------------------------------------------------------------------------
+TARGET_AVX2 static void copyAvx2(double * destination, const double * source, size_t count)
+{
+    size_t i = 0;
+
+    for( ; i + 4 <= count; i += 4 )
+    {
+        _mm256_storeu_pd(destination + i, _mm256_loadu_pd(source + i));
+    }
+
+    copyScalar(destination + i, source + i, count - i);
+}
+
+//------------------------------------------------------------------------------
+TARGET_AVX2 static void fillAvx2(double * destination, double value, size_t count)
+{
+    const __m256d values = _mm256_set1_pd(value);
+    size_t i = 0;
+
+    for( ; i + 4 <= count; i += 4 )
+    {
+        _mm256_storeu_pd(destination + i, values);
+    }
+
+    fillScalar(destination + i, value, count - i);
+}
+
+//------------------------------------------------------------------------------
+TARGET_AVX2 static void multiplyAddAvx2(double * realParts, double * complexParts, size_t count,
+                                        double multiplierReal, double multiplierComplex, double addendReal, double addendComplex)
+{
+    // No fused multiply add, so that every kernel rounds the same way
+    const __m256d multiplierReals     = _mm256_set1_pd(multiplierReal);
+    const __m256d multiplierComplexes = _mm256_set1_pd(multiplierComplex);
+    const __m256d addendReals         = _mm256_set1_pd(addendReal);
+    const __m256d addendComplexes     = _mm256_set1_pd(addendComplex);
+    size_t i = 0;
+
+    for( ; i + 4 <= count; i += 4 )
+    {
+        const __m256d realPart    = _mm256_loadu_pd(realParts + i);
+        const __m256d complexPart = _mm256_loadu_pd(complexParts + i);
+
+        _mm256_storeu_pd(realParts + i, _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(multiplierReals, realPart),
+                                                                    _mm256_mul_pd(multiplierComplexes, complexPart)), addendReals));
+        _mm256_storeu_pd(complexParts + i, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(multiplierReals, complexPart),
+                                                                       _mm256_mul_pd(multiplierComplexes, realPart)), addendComplexes));
+    }
+
+    multiplyAddScalar(realParts + i, complexParts + i, count - i, multiplierReal, multiplierComplex, addendReal, addendComplex);
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+const size_t ComplexNumberPool::CHUNK_SIZE;
+
+//------------------------------------------------------------------------------
+ComplexNumberPool::Kernel ComplexNumberPool::getBestKernel()
+{
+    if( isSupported(Kernel::Avx2) )
+    {
+        return Kernel::Avx2;
+    }
+
+    return isSupported(Kernel::Sse2) ? Kernel::Sse2 : Kernel::Scalar;
+}
+
+//------------------------------------------------------------------------------
+bool ComplexNumberPool::isSupported(Kernel kernel)
+{
+    switch( kernel )
+    {
+    case Kernel::Scalar:
+        return true;
+
+#ifdef COMPLEX_NUMBER_POOL_X86_64
+    case Kernel::Sse2:
+        return true;
+
+    case Kernel::Avx2:
+    {
+#ifdef _MSC_VER
+        // The processor must have AVX2, and the OS must save the upper halves of the registers on a context switch
+        int info[4];
+        __cpuid(info, 1);
+
+        const bool osSavesAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+
+        __cpuidex(info, 7, 0);
+        return osSavesAvx && (info[1] & (1 << 5));
+#else
+        return __builtin_cpu_supports("avx2") != 0;
+#endif
+    }
+#endif
+
+    default:
+        return false;
+    }
+}
+
+//------------------------------------------------------------------------------
+const char * ComplexNumberPool::getKernelName(Kernel kernel)
+{
+    switch( kernel )
+    {
+    case Kernel::Sse2:
+        return "SSE2";
+
+    case Kernel::Avx2:
+        return "AVX2";
+
+    default:
+        return "scalar";
+    }
+}
+
+//------------------------------------------------------------------------------
+ComplexNumberPool::ComplexNumberPool(Kernel kernel, BackingStore::Policy backingStorePolicy)
+    :
+    m_kernel(kernel)
+  , m_kernels({ copyScalar, fillScalar, multiplyAddScalar })
+  , m_size(0)
+  , m_freeSlot(NO_SLOT)
+  , m_backingStorePolicy(backingStorePolicy)
+{
+    if( !isSupported(kernel) )
+    {
+        // Error - Kernel not supported
+        const std::string msg(std::string("The ") + getKernelName(kernel) + " kernel is not supported by this processor.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+#ifdef COMPLEX_NUMBER_POOL_X86_64
+    if( kernel == Kernel::Sse2 )
+    {
+        m_kernels = { copySse2, fillSse2, multiplyAddSse2 };
+    }
+    else if( kernel == Kernel::Avx2 )
+    {
+        m_kernels = { copyAvx2, fillAvx2, multiplyAddAvx2 };
+    }
+#endif
+}
+
+//------------------------------------------------------------------------------
+ComplexNumberPool::~ComplexNumberPool()
+{
+    for( const Chunk & chunk : m_chunks )
+    {
+        BackingStore::release(chunk.m_memory, 2 * CHUNK_SIZE * sizeof(double), chunk.m_policy);
+    }
+}
+
+//------------------------------------------------------------------------------
+void ComplexNumberPool::addChunk()
+{
+    Chunk chunk;
+    chunk.m_policy = m_backingStorePolicy;
+    chunk.m_memory = static_cast<double *>(BackingStore::allocate(2 * CHUNK_SIZE * sizeof(double), chunk.m_policy));
+
+    if( !chunk.m_memory )
+    {
+        // Error - Out of memory
+        const std::string msg("Out of memory. The system failed to allocate another chunk for the complex number pool.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    try
+    {
+        m_chunks.push_back(chunk);
+    }
+    catch( ... )
+    {
+        BackingStore::release(chunk.m_memory, 2 * CHUNK_SIZE * sizeof(double), chunk.m_policy);
+        throw;
+    }
+}
+
+//------------------------------------------------------------------------------
+uint32_t ComplexNumberPool::acquireSlot(uint32_t index)
+{
+    uint32_t slot = m_freeSlot;
+
+    if( slot != NO_SLOT )
+    {
+        m_freeSlot = m_slots[slot].m_index;
+    }
+    else
+    {
+        slot = static_cast<uint32_t>(m_slots.size());
+        m_slots.push_back(Slot{ 0, 0 });
+    }
+
+    m_slots[slot].m_index = index;
+    ++m_slots[slot].m_generation;
+
+    return slot;
+}
+
+//------------------------------------------------------------------------------
+size_t ComplexNumberPool::getPosition(Handle handle) const
+{
+    if( !isValid(handle) )
+    {
+        // Error - Stale or foreign handle
+        const std::string msg("Invalid handle. The number was destroyed, or the handle did not come from this pool.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    return m_slots[handle.m_slot].m_index;
+}
+
+//------------------------------------------------------------------------------
+double * ComplexNumberPool::getRealParts(size_t position)
+{
+    return m_chunks[position / CHUNK_SIZE].m_memory + position % CHUNK_SIZE;
+}
+
+//------------------------------------------------------------------------------
+double * ComplexNumberPool::getComplexParts(size_t position)
+{
+    return m_chunks[position / CHUNK_SIZE].m_memory + CHUNK_SIZE + position % CHUNK_SIZE;
+}
+
+//------------------------------------------------------------------------------
+const double * ComplexNumberPool::getRealParts(size_t position) const
+{
+    return m_chunks[position / CHUNK_SIZE].m_memory + position % CHUNK_SIZE;
+}
+
+//------------------------------------------------------------------------------
+const double * ComplexNumberPool::getComplexParts(size_t position) const
+{
+    return m_chunks[position / CHUNK_SIZE].m_memory + CHUNK_SIZE + position % CHUNK_SIZE;
+}
+
+//------------------------------------------------------------------------------
+ComplexNumberPool::Kernel ComplexNumberPool::getKernel() const
+{
+    return m_kernel;
+}
+
+//------------------------------------------------------------------------------
+size_t ComplexNumberPool::getSize() const
+{
+    return m_size;
+}
+
+//------------------------------------------------------------------------------
+size_t ComplexNumberPool::getCapacity() const
+{
+    return m_chunks.size() * CHUNK_SIZE;
+}
+
+//------------------------------------------------------------------------------
+void ComplexNumberPool::reserve(size_t count)
+{
+    while( getCapacity() < count )
+    {
+        addChunk();
+    }
+}
+
+//------------------------------------------------------------------------------
+ComplexNumberPool::Handle ComplexNumberPool::construct(double realPart, double complexPart)
+{
+    constructBatch(1, &realPart, &complexPart, nullptr);
+
+    const uint32_t slot = m_slotOfNumber.back();
+    return Handle{ slot, m_slots[slot].m_generation };
+}
+
+//------------------------------------------------------------------------------
+ComplexNumberPool::Handle ComplexNumberPool::construct(const ComplexNumber & number)
+{
+    return construct(number.getRealPart(), number.getComplexPart());
+}
+
+//------------------------------------------------------------------------------
+void ComplexNumberPool::constructBatch(size_t count, const double * realParts, const double * complexParts, Handle * out)
+{
+    if( count > NO_SLOT - m_size )
+    {
+        // Error - Too many numbers
+        const std::string msg("Too many numbers. A complex number pool holds fewer than 2^32 numbers.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    // Grow everything first, so that nothing can fail once numbers are being created
+    reserve(m_size + count);
+    m_slotOfNumber.reserve(m_size + count);
+    m_slots.reserve(std::max(m_slots.size(), m_size + count));
+
+    // Copy the parts a chunk at a time
+    for( size_t copied = 0; copied < count; )
+    {
+        const size_t position  = m_size + copied;
+        const size_t runLength = std::min(count - copied, CHUNK_SIZE - position % CHUNK_SIZE);
+
+        m_kernels.m_copy(getRealParts(position), realParts + copied, runLength);
+        m_kernels.m_copy(getComplexParts(position), complexParts + copied, runLength);
+        copied += runLength;
+    }
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        const uint32_t slot = acquireSlot(static_cast<uint32_t>(m_size + i));
+        m_slotOfNumber.push_back(slot);
+
+        if( out )
+        {
+            out[i] = Handle{ slot, m_slots[slot].m_generation };
+        }
+    }
+
+    m_size += count;
+}
+
+//------------------------------------------------------------------------------
+void ComplexNumberPool::destroy(Handle handle)
+{
+    const size_t position = getPosition(handle);
+    const size_t last     = m_size - 1;
+
+    // Keep the numbers packed, by moving the last one into the hole
+    if( position != last )
+    {
+        *getRealParts(position)    = *getRealParts(last);
+        *getComplexParts(position) = *getComplexParts(last);
+
+        const uint32_t movedSlot = m_slotOfNumber[last];
+        m_slotOfNumber[position] = movedSlot;
+        m_slots[movedSlot].m_index = static_cast<uint32_t>(position);
+    }
+
+    m_slotOfNumber.pop_back();
+    --m_size;
+
+    Slot & slot = m_slots[handle.m_slot];
+    ++slot.m_generation;
+    slot.m_index = m_freeSlot;
+    m_freeSlot = handle.m_slot;
+}
+
+//------------------------------------------------------------------------------
+bool ComplexNumberPool::isValid(Handle handle) const
+{
+    return handle.m_slot < m_slots.size() && (handle.m_generation & 1) && m_slots[handle.m_slot].m_generation == handle.m_generation;
+}
+
+//------------------------------------------------------------------------------
+void ComplexNumberPool::clear()
+{
+    for( uint32_t slotIndex : m_slotOfNumber )
+    {
+        Slot & slot = m_slots[slotIndex];
+        ++slot.m_generation;
+        slot.m_index = m_freeSlot;
+        m_freeSlot = slotIndex;
+    }
+
+    m_slotOfNumber.clear();
+    m_size = 0;
+}
+
+//------------------------------------------------------------------------------
+ComplexNumber ComplexNumberPool::get(Handle handle) const
+{
+    const size_t position = getPosition(handle);
+    return ComplexNumber(*getRealParts(position), *getComplexParts(position));
+}
+
+//------------------------------------------------------------------------------
+double ComplexNumberPool::getRealPart(Handle handle) const
+{
+    return *getRealParts(getPosition(handle));
+}
+
+//------------------------------------------------------------------------------
+double ComplexNumberPool::getComplexPart(Handle handle) const
+{
+    return *getComplexParts(getPosition(handle));
+}
+
+//------------------------------------------------------------------------------
+void ComplexNumberPool::set(Handle handle, double realPart, double complexPart)
+{
+    const size_t position = getPosition(handle);
+
+    *getRealParts(position)    = realPart;
+    *getComplexParts(position) = complexPart;
+}
+
+//------------------------------------------------------------------------------
+void ComplexNumberPool::fill(double realPart, double complexPart)
+{
+    for( size_t position = 0; position < m_size; position += CHUNK_SIZE )
+    {
+        const size_t runLength = std::min(m_size - position, CHUNK_SIZE);
+
+        m_kernels.m_fill(getRealParts(position), realPart, runLength);
+        m_kernels.m_fill(getComplexParts(position), complexPart, runLength);
+    }
+}
+
+//------------------------------------------------------------------------------
+void ComplexNumberPool::multiplyAdd(const ComplexNumber & multiplier, const ComplexNumber & addend)
+{
+    for( size_t position = 0; position < m_size; position += CHUNK_SIZE )
+    {
+        const size_t runLength = std::min(m_size - position, CHUNK_SIZE);
+
+        m_kernels.m_multiplyAdd(getRealParts(position), getComplexParts(position), runLength,
+                                multiplier.getRealPart(), multiplier.getComplexPart(), addend.getRealPart(), addend.getComplexPart());
+    }
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+// Project Includes
+#include "BackingStore.h"
+#include "ComplexNumber.h"
+
+// Standard Includes
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// Complex numbers kept as a structure of arrays, for bulk numeric passes
+//
+// Each chunk holds CHUNK_SIZE real parts back to back, followed by CHUNK_SIZE complex parts, without the vtable
+// pointer a ComplexNumber carries. Live numbers are packed at the front, so fill() and multiplyAdd() sweep
+// contiguous arrays with SIMD kernels, chosen at construction from those the processor supports.
+//
+// Numbers are reached through handles, which stay valid while numbers around them are created and destroyed.
+// Destroying a number moves the last one into its place, so the order of the numbers is not kept.
+// Chunks are never moved or released until the pool is destroyed, growing the pool copies nothing.
+class ComplexNumberPool
+{
+public:
+
+    enum class Kernel
+    {
+        Scalar,   // Plain loops, on every processor
+        Sse2,     // Two doubles at a time, on every x86-64 processor
+        Avx2      // Four doubles at a time, where the processor and the OS support it
+    };
+
+    struct Handle
+    {
+        uint32_t m_slot;
+        uint32_t m_generation;   // Changed every time the slot is reused, so stale handles are caught
+    };
+
+    static const size_t CHUNK_SIZE = 1024;   // Numbers per chunk
+
+    // The best kernel this processor supports
+    static Kernel getBestKernel();
+    static bool isSupported(Kernel kernel);
+    static const char * getKernelName(Kernel kernel);
+
+protected:
+
+    static const uint32_t NO_SLOT = UINT32_MAX;
+
+    struct Slot
+    {
+        uint32_t m_index;        // Position of the number when in use, next free slot when not
+        uint32_t m_generation;   // Odd while in use
+    };
+
+    struct Chunk
+    {
+        double *             m_memory;   // CHUNK_SIZE real parts followed by CHUNK_SIZE complex parts
+        BackingStore::Policy m_policy;   // Backing store policy actually used for this chunk
+    };
+
+    // Kernels over one run of contiguous doubles
+    struct Kernels
+    {
+        void (*m_copy)(double * destination, const double * source, size_t count);
+        void (*m_fill)(double * destination, double value, size_t count);
+        void (*m_multiplyAdd)(double * realParts, double * complexParts, size_t count,
+                              double multiplierReal, double multiplierComplex, double addendReal, double addendComplex);
+    };
+
+    Kernel                m_kernel;
+    Kernels               m_kernels;
+    size_t                m_size;           // Numbers in use, packed at positions [0, m_size)
+    std::vector<Chunk>    m_chunks;
+    std::vector<Slot>     m_slots;
+    std::vector<uint32_t> m_slotOfNumber;   // Slot of the number at each position
+    uint32_t              m_freeSlot;       // Head of the free slot list
+
+    BackingStore::Policy m_backingStorePolicy;
+
+    void addChunk();
+    uint32_t acquireSlot(uint32_t index);
+    size_t getPosition(Handle handle) const;
+
+    double * getRealParts(size_t position);
+    double * getComplexParts(size_t position);
+    const double * getRealParts(size_t position) const;
+    const double * getComplexParts(size_t position) const;
+
+public:
+
+    explicit ComplexNumberPool(Kernel kernel = getBestKernel(), BackingStore::Policy backingStorePolicy = BackingStore::Policy::Malloc);
+    ComplexNumberPool(const ComplexNumberPool &) = delete;
+    ComplexNumberPool & operator = (const ComplexNumberPool &) = delete;
+    ~ComplexNumberPool();
+
+    Kernel getKernel() const;
+    size_t getSize() const;
+    size_t getCapacity() const;
+
+    // Adds chunks until count numbers fit, without creating any
+    void reserve(size_t count);
+
+    Handle construct(double realPart, double complexPart);
+    Handle construct(const ComplexNumber & number);
+
+    // Creates count numbers from the given parts, writing their handles to out
+    void constructBatch(size_t count, const double * realParts, const double * complexParts, Handle * out);
+
+    // Throws if the handle is stale, or did not come from this pool
+    void destroy(Handle handle);
+    bool isValid(Handle handle) const;
+
+    // Destroys every number, every handle becomes stale, the chunks are kept
+    void clear();
+
+    ComplexNumber get(Handle handle) const;
+    double getRealPart(Handle handle) const;
+    double getComplexPart(Handle handle) const;
+    void set(Handle handle, double realPart, double complexPart);
+
+    // Sets every number to the same value
+    void fill(double realPart, double complexPart);
+
+    // Replaces every number z with multiplier * z + addend
+    void multiplyAdd(const ComplexNumber & multiplier, const ComplexNumber & addend);
+};
+
+//------------------------------------------------------------------------------
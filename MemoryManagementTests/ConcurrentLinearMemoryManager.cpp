@@ -0,0 +1,162 @@
+
+// Project Includes
+#include "ConcurrentLinearMemoryManager.h"
+#include "ThreadIndex.h"
+
+// Common Library Includes
+#include "Exception.h"
+
+//  Standard Includes
+#include <string>
+
+//------------------------------------------------------------------------------
+ConcurrentLinearMemoryManager::ConcurrentLinearMemoryManager(size_t size, BackingStore::Policy backingStorePolicy)
+    :
+    m_size(size)
+  , m_start(nullptr)
+  , m_usedMemory(0)
+  , m_backingStorePolicy(backingStorePolicy)
+  , m_shards()
+  , m_failedAllocations(0)
+  , m_statistics()
+{
+    if (size <= 0)
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid size requested. Size must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    m_start = BackingStore::allocate(size, m_backingStorePolicy);
+
+    if (!m_start)
+    {
+        // Error - System failed to allocate requested size
+        const std::string msg("System failed to allocate requested size");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+}
+
+//------------------------------------------------------------------------------
+ConcurrentLinearMemoryManager::~ConcurrentLinearMemoryManager()
+{
+    BackingStore::release(m_start, m_size, m_backingStorePolicy);
+}
+
+//------------------------------------------------------------------------------
+void * ConcurrentLinearMemoryManager::allocate(size_t size, uint8_t alignment)
+{
+    if (size <= 0)
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid size requested. Size must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if (!alignment)
+    {
+        // Error - Invalid alignment
+        const std::string msg("Invalid alignment. Alignment must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    const uintptr_t start = reinterpret_cast<uintptr_t>(m_start);
+    size_t offset = m_usedMemory.load(std::memory_order_relaxed);
+    size_t alignedOffset;
+
+    do
+    {
+        // Calculate the adjustment needed from wherever the first free byte is now
+        const uintptr_t misalignment = (start + offset) % alignment;
+        alignedOffset = offset + (misalignment ? alignment - misalignment : 0);
+
+        if( alignedOffset > m_size || size > m_size - alignedOffset )
+        {
+            m_failedAllocations.fetch_add(1, std::memory_order_relaxed);
+
+            // Error - Could not fit the desired number of bytes aligned by the specified alignment into the available memory space
+            const std::string msg(" Could not fit the desired number of bytes aligned by the specified alignment into the available memory space.");
+            throw Common::Exception(__FILE__, __LINE__, msg);
+        }
+    }
+    while( !m_usedMemory.compare_exchange_weak(offset, alignedOffset + size, std::memory_order_relaxed) );
+
+    CounterShard & shard = getShard();
+    shard.m_numAllocations.fetch_add(1, std::memory_order_relaxed);
+    shard.m_requestedBytes.fetch_add(size, std::memory_order_relaxed);
+    shard.m_paddingBytes.fetch_add(alignedOffset - offset, std::memory_order_relaxed);
+    shard.m_sizeClassHistogram[MemoryStatistics::getSizeClass(size)].fetch_add(1, std::memory_order_relaxed);
+
+    return static_cast<uint8_t *>(m_start) + alignedOffset;
+}
+
+//------------------------------------------------------------------------------
+ConcurrentLinearMemoryManager::CounterShard & ConcurrentLinearMemoryManager::getShard()
+{
+    return m_shards[getThreadIndex() % NUM_SHARDS];
+}
+
+//------------------------------------------------------------------------------
+size_t ConcurrentLinearMemoryManager::getNumAllocations() const
+{
+    size_t numAllocations = 0;
+
+    for( const CounterShard & shard : m_shards )
+    {
+        numAllocations += shard.m_numAllocations.load(std::memory_order_relaxed);
+    }
+
+    return numAllocations;
+}
+
+//------------------------------------------------------------------------------
+void ConcurrentLinearMemoryManager::clear()
+{
+    const size_t numAllocations = getNumAllocations();
+
+    m_statistics.m_totalAllocations += numAllocations;
+    m_statistics.recordFree(numAllocations);
+    m_statistics.recordUsedMemory(m_usedMemory.load(std::memory_order_relaxed));
+
+    for( CounterShard & shard : m_shards )
+    {
+        shard.m_numAllocations.store(0, std::memory_order_relaxed);
+    }
+
+    m_usedMemory.store(0, std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+MemoryStatistics ConcurrentLinearMemoryManager::getStatistics() const
+{
+    MemoryStatistics statistics = m_statistics;
+
+    const size_t numAllocations = getNumAllocations();
+
+    statistics.m_capacity          = m_size;
+    statistics.m_usedMemory        = m_usedMemory.load(std::memory_order_relaxed);
+    statistics.m_numAllocations    = numAllocations;
+    statistics.m_totalAllocations += numAllocations;
+    statistics.m_failedAllocations = m_failedAllocations.load(std::memory_order_relaxed);
+    statistics.m_requestedBytes    = 0;
+    statistics.m_paddingBytes      = 0;
+    statistics.recordUsedMemory(statistics.m_usedMemory);
+
+    for( size_t sizeClass = 0; sizeClass < MemoryStatistics::NUM_SIZE_CLASSES; ++sizeClass )
+    {
+        statistics.m_sizeClassHistogram[sizeClass] = 0;
+    }
+
+    for( const CounterShard & shard : m_shards )
+    {
+        statistics.m_requestedBytes += shard.m_requestedBytes.load(std::memory_order_relaxed);
+        statistics.m_paddingBytes   += shard.m_paddingBytes.load(std::memory_order_relaxed);
+
+        for( size_t sizeClass = 0; sizeClass < MemoryStatistics::NUM_SIZE_CLASSES; ++sizeClass )
+        {
+            statistics.m_sizeClassHistogram[sizeClass] += shard.m_sizeClassHistogram[sizeClass].load(std::memory_order_relaxed);
+        }
+    }
+
+    return statistics;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+// Project Includes
+#include "BackingStore.h"
+#include "MemoryStatistics.h"
+
+// Standard Includes
+#include <atomic>
+#include <cstdint>
+
+//------------------------------------------------------------------------------
+// A LinearMemoryManager that many threads may allocate from at the same time
+//
+// allocate() bumps the offset of the first free byte with a compare and swap, so no lock is ever taken.
+// An allocation that does not fit throws and leaves the offset untouched, so later smaller allocations can still succeed.
+// clear() is not thread safe, it must only be called when no other thread is using the memory manager.
+// Statistics are kept with relaxed atomic counters, so a snapshot taken while other threads allocate may be slightly stale.
+// The counters that change on every allocation are split into shards on their own cache lines, and each thread counts
+// in the shard its thread index picks, so threads allocating at once do not fight over the lines holding them.
+class ConcurrentLinearMemoryManager
+{
+protected:
+
+    static const size_t CACHE_LINE_SIZE = 64;
+    static const size_t NUM_SHARDS      = 16;   // Threads beyond this many share shards
+
+    // Counters that change on every allocation, summed over the shards when they are read
+    struct CounterShard
+    {
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_numAllocations;   // Number of caller allocations since the last clear()
+        std::atomic<size_t> m_requestedBytes;
+        std::atomic<size_t> m_paddingBytes;
+        std::atomic<size_t> m_sizeClassHistogram[MemoryStatistics::NUM_SIZE_CLASSES];
+    };
+
+    size_t              m_size;            // Total size of allocated memory, in bytes
+    void *              m_start;           // First address in allocated memory
+    std::atomic<size_t> m_usedMemory;      // Number of bytes used, which is also the offset of the first available free byte
+
+    BackingStore::Policy m_backingStorePolicy;
+
+    CounterShard        m_shards[NUM_SHARDS];
+    std::atomic<size_t> m_failedAllocations;
+    MemoryStatistics    m_statistics;      // The statistics that only change in clear()
+
+    CounterShard & getShard();
+    size_t getNumAllocations() const;
+
+public:
+
+    ConcurrentLinearMemoryManager(size_t size, BackingStore::Policy backingStorePolicy = BackingStore::Policy::Malloc);
+    ConcurrentLinearMemoryManager(const ConcurrentLinearMemoryManager &) = delete;
+    ConcurrentLinearMemoryManager & operator = (const ConcurrentLinearMemoryManager &) = delete;
+    ~ConcurrentLinearMemoryManager();
+
+    void * allocate(size_t size, uint8_t alignment);
+    void clear();
+
+    MemoryStatistics getStatistics() const;
+};
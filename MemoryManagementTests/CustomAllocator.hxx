@@ -3,8 +3,13 @@
 // Project Includes
 #include "IMemoryManager.h"
 
+// Common Library
+#include "Exception.h"
+
 // Standard Includes
+#include <cstddef>
 #include <iostream>
+#include <new>
 #include <type_traits>
 #include <memory>
 
@@ -15,6 +20,9 @@
 /// Based on Dr Dobbs article
 /// http://www.drdobbs.com/the-standard-librarian-what-are-allocato/184403759
 /// I attempted to make it C++11 compliant.
+///
+/// Allocators compare equal when they share a memory manager, and the memory manager travels with the
+/// container on copy, move and swap, so memory is always given back to the memory manager it came from.
 /// </summary>
 template <class T>
 class CustomAllocator
@@ -28,13 +36,18 @@ public:
     template <typename U> friend class CustomAllocator;
     typedef T value_type;
 
-    /*
-    using propagate_on_container_copy_assignment = std::false_type;
-    using propagate_on_container_move_assignment = std::false_type;
-    using propagate_on_container_swap            = std::false_type;
-    */
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap            = std::true_type;
+    using is_always_equal                        = std::false_type;
+
+    template <class U>
+    struct rebind
+    {
+        typedef CustomAllocator<U> other;
+    };
 
-    /// Allocator takes ownership of memory manager
+    /// Allocator does not take ownership of memory manager, which must outlive every container using it
     explicit CustomAllocator(IMemoryManager * memoryManager)
         :
         m_memoryManager(memoryManager)
@@ -52,20 +65,41 @@ public:
     {
     }
 
-    bool operator == (const CustomAllocator<T> & rhs)
+    template <class U>
+    bool operator == (const CustomAllocator<U> & rhs) const
     {
         return m_memoryManager == rhs.m_memoryManager;
     }
 
-    bool operator != (const CustomAllocator<T> & rhs)
+    template <class U>
+    bool operator != (const CustomAllocator<U> & rhs) const
     {
         return m_memoryManager != rhs.m_memoryManager;
     }
 
+    IMemoryManager * getMemoryManager() const
+    {
+        return m_memoryManager;
+    }
+
     T * allocate(size_t n)
     {
+        if (n > static_cast<size_t>(-1) / sizeof(T))
+        {
+            throw std::bad_array_new_length();
+        }
+
         const size_t numBytes = n * sizeof(T);
-        void * p = m_memoryManager->allocate(numBytes);
+        void * p;
+
+        try
+        {
+            p = m_memoryManager->allocate(numBytes ? numBytes : 1, alignof(T));
+        }
+        catch (const Common::Exception &)
+        {
+            throw std::bad_alloc();
+        }
 
         if (!p)
         {
@@ -78,9 +112,10 @@ public:
 
     void deallocate(T * p, size_t numObjects)
     {
-        const size_t numBytes = sizeof(*p);
-        m_memoryManager->free(p);
+        // Hand back the same size and alignment that allocate asked for, so headerless memory managers can find the block
+        const size_t numBytes = numObjects * sizeof(T);
+        m_memoryManager->free(p, numBytes ? numBytes : 1, alignof(T));
 
-        // std::cout << "Deallocated " << numBytes << " bytes for a " << typeid(T).name() << std::endl;
+        // std::cout << "Deallocated " << numObjects * sizeof(T) << " bytes for a " << typeid(T).name() << std::endl;
     }
 };
@@ -6,25 +6,86 @@
 #include "Exception.h"
 
 // Standard Includes
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <numeric>
 #include <string>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Index of the lowest set bit. value must be non-zero.
+static size_t findFirstSet(uint64_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return index;
+#else
+    return static_cast<size_t>(__builtin_ctzll(value));
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Index of the highest set bit. value must be non-zero.
+static size_t findLastSet(uint64_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return index;
+#else
+    return static_cast<size_t>(63 - __builtin_clzll(value));
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Widens [start, end) to take in [otherStart, otherEnd), unless that is empty
+static void extendRange(uint8_t *& start, uint8_t *& end, uint8_t * otherStart, uint8_t * otherEnd)
+{
+    if( otherStart < otherEnd )
+    {
+        start = std::min(start, otherStart);
+        end   = std::max(end, otherEnd);
+    }
+}
+
 //------------------------------------------------------------------------------
-FreeListMemoryManager::FreeListMemoryManager(size_t size)
+FreeListMemoryManager::FreeListMemoryManager(size_t size, AllocationPolicy policy, BackingStore::Policy backingStorePolicy,
+                                             HeaderPolicy headerPolicy)
     :
     m_size(size)
   , m_start(nullptr)
+  , m_end(nullptr)
   , m_usedMemory(0)
   , m_numAllocations(0)
   , m_freeBlocks(nullptr)
+  , m_policy(policy)
+  , m_headerPolicy(headerPolicy)
+  , m_statistics()
+  , m_backingStorePolicy(backingStorePolicy)
+  , m_freeRelocatableSlot(NO_SLOT)
+  , m_numRelocatable(0)
+  , m_minPurgeSize(0)
+  , m_decayTime(std::chrono::seconds(10))
+  , m_purgeMode(BackingStore::PurgeMode::Eager)
+  , m_decayEpoch(0)
+  , m_decayEpochStart(Clock::now())
+  , m_firstLevelBitmap(0)
+  , m_secondLevelBitmaps()
+  , m_sizeClasses()
 {
-    if (size <= 0)
+    if (size < MIN_BLOCK_SIZE)
     {
         // Error - Invalid size
-        const std::string msg("Invalid size requested. Size must be greater than zero.");
+        const std::string msg("Invalid size requested. Size must be large enough to hold at least one free block.");
         throw Common::Exception(__FILE__, __LINE__, msg);
     }
 
-    m_start = ::malloc(size);
+    m_start = BackingStore::allocate(size, m_backingStorePolicy);
 
     if( !m_start )
     {
@@ -33,20 +94,247 @@ FreeListMemoryManager::FreeListMemoryManager(size_t size)
         throw Common::Exception(__FILE__, __LINE__, msg);
     }
 
+    // Smaller blocks would rarely hold a whole page once their header and footer are left out
+    m_minPurgeSize = 2 * BackingStore::getPageSize(m_backingStorePolicy);
+
+    // Blocks are kept aligned for their boundary tags, so any trailing bytes that cannot form a whole block go unused
+    const size_t blockSize = size & ~(alignof(FreeBlock) - 1);
+    m_end = static_cast<uint8_t *>(m_start) + blockSize;
+
     // To start with, all the memory is in one free block
-    m_freeBlocks = static_cast<FreeBlock *>(m_start);
-    m_freeBlocks->m_size = size;
-    m_freeBlocks->m_next = nullptr;
+    FreeBlock * freeBlock = static_cast<FreeBlock *>(m_start);
+    freeBlock->m_size = blockSize;
+    setFooter(freeBlock, blockSize, false, true);
+
+    insertFreeBlock(freeBlock);
 }
 
 //------------------------------------------------------------------------------
 FreeListMemoryManager::~FreeListMemoryManager()
 {
-    ::free(m_start);
+    BackingStore::release(m_start, m_size, m_backingStorePolicy);
 }
 
 //------------------------------------------------------------------------------
-void * FreeListMemoryManager::allocate(size_t size, uint8_t alignment)
+uint8_t FreeListMemoryManager::getAdjustment(const void * address, uint8_t alignment)
+{
+    // Calculate adjustment needed to keep object correctly aligned
+    const uintptr_t misalignment = reinterpret_cast<uintptr_t>(address) % alignment;
+    uint8_t adjustment = misalignment ? static_cast<uint8_t>(alignment - misalignment) : 0;
+
+    // Check if the space given by the alignment was enough to contain the header
+    uint8_t neededSpace = sizeof(AllocationHeader);
+
+    if( adjustment < neededSpace )
+    {
+        neededSpace -= adjustment;
+
+        // Increase adjustment to fit header
+        adjustment += alignment * (neededSpace / alignment);
+
+        if (neededSpace % alignment > 0)
+        {
+            adjustment += alignment;
+        }
+    }
+
+    return adjustment;
+}
+
+//------------------------------------------------------------------------------
+size_t FreeListMemoryManager::getHeaderlessAdjustment(const void * address, uint8_t alignment)
+{
+    // Blocks always start 8 byte aligned, so only larger alignments need a gap
+    const uintptr_t misalignment = reinterpret_cast<uintptr_t>(address) % alignment;
+    size_t adjustment = misalignment ? alignment - misalignment : 0;
+
+    // There is no header to find the gap from, so it must be large enough to become a free block of its own
+    if( adjustment > 0 && adjustment < MIN_BLOCK_SIZE )
+    {
+        adjustment += (MIN_BLOCK_SIZE - adjustment + alignment - 1) / alignment * alignment;
+    }
+
+    return adjustment;
+}
+
+//------------------------------------------------------------------------------
+size_t FreeListMemoryManager::getBlockSize(size_t adjustment, size_t size)
+{
+    // Make room for the footer and keep the next block aligned for its boundary tags
+    size_t blockSize = adjustment + size + sizeof(BlockFooter);
+    blockSize = (blockSize + alignof(FreeBlock) - 1) & ~(alignof(FreeBlock) - 1);
+
+    return blockSize < MIN_BLOCK_SIZE ? MIN_BLOCK_SIZE : blockSize;
+}
+
+//------------------------------------------------------------------------------
+FreeListMemoryManager::BlockFooter * FreeListMemoryManager::getFooter(void * blockStart, size_t blockSize)
+{
+    return reinterpret_cast<BlockFooter *>(static_cast<uint8_t *>(blockStart) + blockSize - sizeof(BlockFooter));
+}
+
+//------------------------------------------------------------------------------
+void FreeListMemoryManager::setFooter(void * blockStart, size_t blockSize, bool used, bool nextUsed)
+{
+    BlockFooter * footer = getFooter(blockStart, blockSize);
+    footer->m_size     = blockSize;
+    footer->m_used     = used;
+    footer->m_nextUsed = nextUsed;
+}
+
+//------------------------------------------------------------------------------
+void FreeListMemoryManager::setPreviousNextUsed(void * blockStart, bool nextUsed)
+{
+    if( blockStart != m_start )
+    {
+        BlockFooter * previousFooter = reinterpret_cast<BlockFooter *>(static_cast<uint8_t *>(blockStart) - sizeof(BlockFooter));
+        previousFooter->m_nextUsed = nextUsed;
+    }
+}
+
+//------------------------------------------------------------------------------
+void FreeListMemoryManager::mapSize(size_t size, size_t & firstLevelIndex, size_t & secondLevelIndex)
+{
+    if( size < SECOND_LEVEL_INDEX_COUNT )
+    {
+        // Small sizes all share the first level and are split linearly
+        firstLevelIndex  = 0;
+        secondLevelIndex = size;
+        return;
+    }
+
+    const size_t highestBit = findLastSet(size);
+
+    firstLevelIndex  = highestBit - SECOND_LEVEL_INDEX_LOG2 + 1;
+    secondLevelIndex = (size >> (highestBit - SECOND_LEVEL_INDEX_LOG2)) - SECOND_LEVEL_INDEX_COUNT;
+}
+
+//------------------------------------------------------------------------------
+FreeListMemoryManager::FreeBlock * FreeListMemoryManager::findSizeClassBlock(size_t size) const
+{
+    // Round the size up to the next size class boundary, so that every block in the class we land in is large enough
+    if( size >= SECOND_LEVEL_INDEX_COUNT )
+    {
+        size += (static_cast<size_t>(1) << (findLastSet(size) - SECOND_LEVEL_INDEX_LOG2)) - 1;
+    }
+
+    size_t firstLevelIndex;
+    size_t secondLevelIndex;
+    mapSize(size, firstLevelIndex, secondLevelIndex);
+
+    if( firstLevelIndex >= FIRST_LEVEL_INDEX_COUNT )
+    {
+        return nullptr;
+    }
+
+    // Look for a non-empty class at or above the second level index in the same first level range
+    uint32_t secondLevelMap = m_secondLevelBitmaps[firstLevelIndex] & (~0u << secondLevelIndex);
+
+    if( !secondLevelMap )
+    {
+        // Otherwise use the smallest class in the next non-empty first level range
+        const uint64_t firstLevelMap = (firstLevelIndex + 1 < 64) ? m_firstLevelBitmap & (~0ull << (firstLevelIndex + 1)) : 0;
+
+        if( !firstLevelMap )
+        {
+            return nullptr;
+        }
+
+        firstLevelIndex = findFirstSet(firstLevelMap);
+        secondLevelMap  = m_secondLevelBitmaps[firstLevelIndex];
+    }
+
+    secondLevelIndex = findFirstSet(secondLevelMap);
+    return m_sizeClasses[firstLevelIndex][secondLevelIndex];
+}
+
+//------------------------------------------------------------------------------
+void FreeListMemoryManager::insertFreeBlock(FreeBlock * freeBlock)
+{
+    uint8_t * blockStart = reinterpret_cast<uint8_t *>(freeBlock);
+    insertFreeBlock(freeBlock, blockStart, blockStart + freeBlock->m_size);
+}
+
+//------------------------------------------------------------------------------
+void FreeListMemoryManager::insertFreeBlock(FreeBlock * freeBlock, uint8_t * residentStart, uint8_t * residentEnd)
+{
+    FreeBlock ** head = &m_freeBlocks;
+
+    size_t firstLevelIndex;
+    size_t secondLevelIndex;
+
+    if( m_policy == AllocationPolicy::SegregatedFit )
+    {
+        mapSize(freeBlock->m_size, firstLevelIndex, secondLevelIndex);
+        head = &m_sizeClasses[firstLevelIndex][secondLevelIndex];
+
+        m_firstLevelBitmap                    |= 1ull << firstLevelIndex;
+        m_secondLevelBitmaps[firstLevelIndex] |= 1u << secondLevelIndex;
+    }
+
+    freeBlock->m_next     = *head;
+    freeBlock->m_previous = nullptr;
+
+    // Start the decay of large blocks over, whether they were just freed, merged or split, and keep the part that may be
+    // resident to what lies inside the block
+    if( freeBlock->m_size >= m_minPurgeSize )
+    {
+        uint8_t * blockStart = reinterpret_cast<uint8_t *>(freeBlock);
+
+        PurgeInfo * purgeInfo = getPurgeInfo(freeBlock);
+        purgeInfo->m_epoch         = m_decayEpoch;
+        purgeInfo->m_residentStart = std::max(residentStart, blockStart);
+        purgeInfo->m_residentEnd   = std::min(residentEnd, blockStart + freeBlock->m_size);
+    }
+
+    if( *head != nullptr )
+    {
+        (*head)->m_previous = freeBlock;
+    }
+
+    *head = freeBlock;
+}
+
+//------------------------------------------------------------------------------
+void FreeListMemoryManager::removeFreeBlock(FreeBlock * freeBlock)
+{
+    if( freeBlock->m_next != nullptr )
+    {
+        freeBlock->m_next->m_previous = freeBlock->m_previous;
+    }
+
+    if( freeBlock->m_previous != nullptr )
+    {
+        freeBlock->m_previous->m_next = freeBlock->m_next;
+        return;
+    }
+
+    // The block was the head of its list
+    if( m_policy != AllocationPolicy::SegregatedFit )
+    {
+        m_freeBlocks = freeBlock->m_next;
+        return;
+    }
+
+    size_t firstLevelIndex;
+    size_t secondLevelIndex;
+    mapSize(freeBlock->m_size, firstLevelIndex, secondLevelIndex);
+
+    m_sizeClasses[firstLevelIndex][secondLevelIndex] = freeBlock->m_next;
+
+    if( !freeBlock->m_next )
+    {
+        m_secondLevelBitmaps[firstLevelIndex] &= ~(1u << secondLevelIndex);
+
+        if( !m_secondLevelBitmaps[firstLevelIndex] )
+        {
+            m_firstLevelBitmap &= ~(1ull << firstLevelIndex);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void FreeListMemoryManager::validateAllocation(size_t size, uint8_t alignment) const
 {
     if( size <= 0 )
     {
@@ -62,102 +350,177 @@ void * FreeListMemoryManager::allocate(size_t size, uint8_t alignment)
         throw Common::Exception(__FILE__, __LINE__, msg);
     }
 
-    // Iterate over the free blocks and look for the first that has enough space to fit the request
-    FreeBlock * previousFreeBlock = nullptr;
-    FreeBlock * freeBlock         = m_freeBlocks;
-
-    while( freeBlock != nullptr )
+    if( m_headerPolicy == HeaderPolicy::Headerless && (alignment & (alignment - 1)) )
     {
-        // Calculate adjustment needed to keep object correctly aligned
-        size_t availableSpace = freeBlock->m_size;
-        void * address = reinterpret_cast<void *>(freeBlock);
+        // Error - Invalid alignment
+        const std::string msg("Invalid alignment. Headerless allocations must be aligned to a power of two.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+}
 
-        void * alignedAddress = std::align(alignment, size, address, availableSpace);
+//------------------------------------------------------------------------------
+void * FreeListMemoryManager::allocate(size_t size, uint8_t alignment)
+{
+    validateAllocation(size, alignment);
+    return allocateUnchecked(size, alignment);
+}
 
-        if( !alignedAddress )
-        {
-            // Does not fit
-            freeBlock = freeBlock->m_next;
-            continue;
-        }
+//------------------------------------------------------------------------------
+void * FreeListMemoryManager::allocateUnchecked(size_t size, uint8_t alignment)
+{
+    void * p = tryAllocate(size, alignment);
 
-        // Check if the space given by the alignment was enough to contain the header
-        uint8_t adjustment = static_cast<int8_t>(static_cast<uint8_t *>(alignedAddress) - static_cast<uint8_t *>(address));
-        uint8_t neededSpace = sizeof(AllocationHeader);
+    if( !p )
+    {
+        m_statistics.recordFailure();
 
-        if( adjustment < neededSpace )
-        {
-            neededSpace -= adjustment;
+        const std::string msg("No free space large enough to accomodate requested size was found.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
 
-            // Increase adjustment to fit header
-            adjustment += alignment * (neededSpace / alignment);
+    return p;
+}
 
-            if (neededSpace % alignment > 0)
-            {
-                adjustment += alignment;
-            }
-        }
+//------------------------------------------------------------------------------
+void * FreeListMemoryManager::tryAllocate(size_t size, uint8_t alignment)
+{
+    const bool headerless = m_headerPolicy == HeaderPolicy::Headerless;
 
-        // Check that the requested size and the space we created for alignment and header will fit
-        size_t totalSize = adjustment + size;
+    if( m_policy == AllocationPolicy::SegregatedFit )
+    {
+        // Ask for the worst case adjustment, so that whichever block we are given is guaranteed to fit
+        size_t worstCaseSize;
 
-        if( totalSize > freeBlock->m_size )
+        if( !headerless )
         {
-            // Does not fit
-            freeBlock = freeBlock->m_next;
-            continue;
+            worstCaseSize = getBlockSize(sizeof(AllocationHeader) + alignment - 1, size);
         }
-
-        alignedAddress = static_cast<uint8_t *>(address) + adjustment;
-
-        // Check If allocations in the remaining memory will be impossible
-        if( freeBlock->m_size - totalSize <= sizeof(AllocationHeader) )
+        else if( alignment <= alignof(FreeBlock) )
         {
-            // Cannot fit any additional allocations in this block
-            // Take the rest of the available space in this block, so that it doesn't sit unused.
-            // When this block is freed then it might become useful again.
-            totalSize = freeBlock->m_size;
-
-            if( previousFreeBlock != nullptr )
-            {
-                previousFreeBlock->m_next = freeBlock->m_next;
-            }
-            else
-            {
-                m_freeBlocks = freeBlock->m_next;
-            }
+            worstCaseSize = getBlockSize(0, size);
         }
         else
         {
-            // We could possibly fit additional allocation into the remaining space
-            // Create a new FreeBlock containing remaining memory and insert it into the list
-            FreeBlock * nextBlock = reinterpret_cast<FreeBlock *>(reinterpret_cast<uint8_t *>(freeBlock) + totalSize);
-            
-            nextBlock->m_size = freeBlock->m_size - totalSize;
-            nextBlock->m_next = freeBlock->m_next;
+            worstCaseSize = MIN_BLOCK_SIZE + alignment + getBlockSize(0, size);
+        }
+
+        FreeBlock * freeBlock = findSizeClassBlock(worstCaseSize);
 
-            if( previousFreeBlock != nullptr )
+        if( freeBlock != nullptr )
+        {
+            const size_t adjustment = headerless ? getHeaderlessAdjustment(freeBlock, alignment) : getAdjustment(freeBlock, alignment);
+            return allocateFromBlock(freeBlock, size, adjustment);
+        }
+    }
+    else
+    {
+        // Iterate over the free blocks and look for the first that has enough space to fit the request
+        for( FreeBlock * freeBlock = m_freeBlocks; freeBlock != nullptr; freeBlock = freeBlock->m_next )
+        {
+            // Check that the requested size and the space we created for alignment, header and footer will fit
+            if( headerless )
             {
-                previousFreeBlock->m_next = nextBlock;
+                const size_t adjustment = getHeaderlessAdjustment(freeBlock, alignment);
+
+                if( adjustment + getBlockSize(0, size) <= freeBlock->m_size )
+                {
+                    return allocateFromBlock(freeBlock, size, adjustment);
+                }
             }
             else
             {
-                m_freeBlocks = nextBlock;
+                const uint8_t adjustment = getAdjustment(freeBlock, alignment);
+
+                if( getBlockSize(adjustment, size) <= freeBlock->m_size )
+                {
+                    return allocateFromBlock(freeBlock, size, adjustment);
+                }
             }
         }
+    }
 
-        AllocationHeader * header = reinterpret_cast<AllocationHeader *>(static_cast<uint8_t *>(alignedAddress) - sizeof(AllocationHeader));
-        header->m_size       = totalSize;
-        header->m_adjustment = adjustment;
+    return nullptr;
+}
+
+//------------------------------------------------------------------------------
+void * FreeListMemoryManager::allocateFromBlock(FreeBlock * freeBlock, size_t size, size_t adjustment)
+{
+    uint8_t * blockStart    = reinterpret_cast<uint8_t *>(freeBlock);
+    size_t    availableSize = freeBlock->m_size;
+    const bool nextUsed     = getFooter(blockStart, availableSize)->m_nextUsed;
+
+    // What is left over keeps whatever was purged of this block
+    uint8_t * residentStart;
+    uint8_t * residentEnd;
+    getResidentRange(freeBlock, residentStart, residentEnd);
+
+    removeFreeBlock(freeBlock);
+
+    if( m_headerPolicy == HeaderPolicy::Headerless && adjustment > 0 )
+    {
+        // There is no header to record the alignment gap in, so the gap becomes a free block of its own
+        freeBlock->m_size = adjustment;
+        setFooter(freeBlock, adjustment, false, true);
+        insertFreeBlock(freeBlock, residentStart, residentEnd);
+
+        blockStart    += adjustment;
+        availableSize -= adjustment;
+        adjustment     = 0;
+    }
+    else
+    {
+        setPreviousNextUsed(blockStart, true);
+    }
+
+    const size_t requiredSize = getBlockSize(adjustment, size);
+    size_t totalSize = requiredSize;
+
+    // Check If allocations in the remaining memory will be impossible
+    if( totalSize + MIN_BLOCK_SIZE > availableSize )
+    {
+        // Cannot fit any additional allocations in this block
+        // Take the rest of the available space in this block, so that it doesn't sit unused.
+        // When this block is freed then it might become useful again.
+        totalSize = availableSize;
+        setFooter(blockStart, totalSize, true, nextUsed);
+    }
+    else
+    {
+        // We could possibly fit additional allocation into the remaining space
+        // Create a new FreeBlock containing remaining memory and insert it into the list
+        FreeBlock * nextBlock = reinterpret_cast<FreeBlock *>(blockStart + totalSize);
+        nextBlock->m_size = availableSize - totalSize;
+        setFooter(nextBlock, nextBlock->m_size, false, nextUsed);
 
-        m_usedMemory += totalSize;
-        ++m_numAllocations;
+        insertFreeBlock(nextBlock, residentStart, residentEnd);
+        setFooter(blockStart, totalSize, true, false);
+    }
 
-        return alignedAddress;
+    if( m_headerPolicy == HeaderPolicy::Headerless )
+    {
+        // The sized free only knows where the footer of a block of the requested size would be,
+        // so if the block took more than that, leave its real size there as well
+        if( totalSize != requiredSize )
+        {
+            BlockFooter * footer = getFooter(blockStart, requiredSize);
+            footer->m_size = totalSize;
+            footer->m_used = true;
+        }
+    }
+    else
+    {
+        AllocationHeader * header = reinterpret_cast<AllocationHeader *>(blockStart + adjustment - sizeof(AllocationHeader));
+        header->m_size       = totalSize;
+        header->m_adjustment = static_cast<uint8_t>(adjustment);
     }
 
-    const std::string msg("No free space large enough to accomodate requested size was found.");
-    throw Common::Exception(__FILE__, __LINE__, msg);
+    m_usedMemory += totalSize;
+    ++m_numAllocations;
+
+    const size_t overhead = m_headerPolicy == HeaderPolicy::Headers ? sizeof(AllocationHeader) + sizeof(BlockFooter) : sizeof(BlockFooter);
+    m_statistics.recordAllocation(size, totalSize - size - overhead, overhead, m_usedMemory);
+
+    return blockStart + adjustment;
 }
 
 //------------------------------------------------------------------------------
@@ -170,55 +533,963 @@ void FreeListMemoryManager::free(void * p)
         throw Common::Exception(__FILE__, __LINE__, msg);
     }
 
-    AllocationHeader * header = reinterpret_cast<AllocationHeader *>(static_cast<uint8_t *>(p) - sizeof(AllocationHeader));
-
-    uint8_t * blockStart = static_cast<uint8_t *>(p) - header->m_adjustment;
-    size_t    blockSize  =  header->m_size;
-    uint8_t * blockEnd   =  blockStart + blockSize;
+    if( m_headerPolicy == HeaderPolicy::Headerless )
+    {
+        // Error - No header to find the block from
+        const std::string msg("Headerless allocations can only be freed with the size and alignment they were allocated with.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
 
-    FreeBlock * previousFreeBlock = nullptr;
-    FreeBlock * freeBlock = m_freeBlocks;
+    freeUnchecked(p);
+}
 
-    while( freeBlock != nullptr )
+//------------------------------------------------------------------------------
+void FreeListMemoryManager::free(void * p, size_t size, uint8_t alignment)
+{
+    if( !p )
     {
-        if( reinterpret_cast<uint8_t *>(freeBlock) >= blockEnd )
-        {
-            break;
-        }
-
-        previousFreeBlock = freeBlock;
-        freeBlock = freeBlock->m_next;
+        // Error - p is nullptr
+        const std::string msg("p is nullptr");
+        throw Common::Exception(__FILE__, __LINE__, msg);
     }
 
-    if( !previousFreeBlock )
+    if( size <= 0 )
     {
-        previousFreeBlock = reinterpret_cast<FreeBlock *>(blockStart);
-        previousFreeBlock->m_size = blockSize;
-        previousFreeBlock->m_next = m_freeBlocks;
-
-        m_freeBlocks = previousFreeBlock;
+        // Error - Invalid size
+        const std::string msg("Invalid size. Size must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
     }
-    else if( reinterpret_cast<uint8_t *>(previousFreeBlock) + previousFreeBlock->m_size == blockStart )
+
+    freeUnchecked(p, size, alignment);
+}
+
+//------------------------------------------------------------------------------
+void FreeListMemoryManager::freeUnchecked(void * p)
+{
+    AllocationHeader * header = reinterpret_cast<AllocationHeader *>(static_cast<uint8_t *>(p) - sizeof(AllocationHeader));
+    releaseBlock(static_cast<uint8_t *>(p) - header->m_adjustment, header->m_size);
+}
+
+//------------------------------------------------------------------------------
+void FreeListMemoryManager::freeUnchecked(void * p, size_t size, uint8_t)
+{
+    if( m_headerPolicy == HeaderPolicy::Headers )
     {
-        previousFreeBlock->m_size += blockSize;
+        freeUnchecked(p);
+        return;
     }
-    else
+
+    // Headerless blocks start at p, and the footer where a block of this size would end holds the real size of the block
+    releaseBlock(static_cast<uint8_t *>(p), getFooter(p, getBlockSize(0, size))->m_size);
+}
+
+//------------------------------------------------------------------------------
+void FreeListMemoryManager::releaseBlock(uint8_t * blockStart, size_t blockSize, size_t numBlocks)
+{
+    uint8_t * blockEnd = blockStart + blockSize;
+    bool      nextUsed = true;
+
+    // The freed block is resident, a neighbour it merges with keeps whatever was purged of it.
+    // The boundary tags between them, which were never purged, are now inside the merged block.
+    uint8_t * residentStart = blockStart;
+    uint8_t * residentEnd   = blockEnd;
+
+    m_numAllocations -= numBlocks;
+    m_usedMemory     -= blockSize;
+    m_statistics.recordFree(numBlocks);
+
+    // Merge with the physical block that follows this one, if it is free
+    if( blockEnd != m_end && !getFooter(blockStart, blockSize)->m_nextUsed )
     {
-        FreeBlock * temp = reinterpret_cast<FreeBlock *>(blockStart);
-        temp->m_size = blockSize;
-        temp->m_next = previousFreeBlock->m_next;
-        previousFreeBlock->m_next = temp;
-        previousFreeBlock = temp;
+        FreeBlock * nextBlock = reinterpret_cast<FreeBlock *>(blockEnd);
+        const size_t nextSize = nextBlock->m_size;
+
+        uint8_t * nextResidentStart;
+        uint8_t * nextResidentEnd;
+        getResidentRange(nextBlock, nextResidentStart, nextResidentEnd);
+
+        residentEnd = blockEnd + sizeof(FreeBlock) + sizeof(PurgeInfo);
+        extendRange(residentStart, residentEnd, nextResidentStart, nextResidentEnd);
+
+        nextUsed = getFooter(nextBlock, nextSize)->m_nextUsed;
+        removeFreeBlock(nextBlock);
+        blockSize += nextSize;
     }
 
-    if( freeBlock != nullptr && reinterpret_cast<uint8_t *>(freeBlock) == blockEnd )
+    // Merge with the physical block that precedes this one, if it is free
+    if( blockStart != m_start )
     {
-        previousFreeBlock->m_size += freeBlock->m_size;
-        previousFreeBlock->m_next = freeBlock->m_next;
+        const BlockFooter * previousFooter = reinterpret_cast<BlockFooter *>(blockStart - sizeof(BlockFooter));
+
+        if( !previousFooter->m_used )
+        {
+            residentStart = blockStart - sizeof(BlockFooter);
+
+            blockStart -= previousFooter->m_size;
+            blockSize  += previousFooter->m_size;
+
+            uint8_t * previousResidentStart;
+            uint8_t * previousResidentEnd;
+            getResidentRange(reinterpret_cast<FreeBlock *>(blockStart), previousResidentStart, previousResidentEnd);
+            extendRange(residentStart, residentEnd, previousResidentStart, previousResidentEnd);
+
+            removeFreeBlock(reinterpret_cast<FreeBlock *>(blockStart));
+        }
     }
 
-    --m_numAllocations;
-    m_usedMemory -= blockSize;
+    FreeBlock * freeBlock = reinterpret_cast<FreeBlock *>(blockStart);
+    freeBlock->m_size = blockSize;
+    setFooter(freeBlock, blockSize, false, nextUsed);
+    setPreviousNextUsed(freeBlock, false);
+
+    insertFreeBlock(freeBlock, residentStart, residentEnd);
+}
+
+//------------------------------------------------------------------------------
+void FreeListMemoryManager::allocateBatch(size_t count, size_t size, uint8_t alignment, void ** out)
+{
+    validateAllocation(size, alignment);
+
+    if( m_headerPolicy == HeaderPolicy::Headerless && alignment > alignof(FreeBlock) )
+    {
+        // Every over-aligned headerless object may need a free block in front of it, so there is no run to carve
+        IMemoryManager::allocateBatch(count, size, alignment, out);
+        return;
+    }
+
+    size_t numAllocated = 0;
+
+    while( numAllocated < count )
+    {
+        FreeBlock * freeBlock = findBatchBlock(count - numAllocated, size, alignment);
+
+        if( !freeBlock )
+        {
+            m_statistics.recordFailure();
+
+            // Give back what was carved so far, so that the batch fails as a whole
+            freeBatch(out, numAllocated, size, alignment);
+
+            const std::string msg("No free space large enough to accomodate requested size was found.");
+            throw Common::Exception(__FILE__, __LINE__, msg);
+        }
+
+        numAllocated += allocateRunFromBlock(freeBlock, count - numAllocated, size, alignment, out + numAllocated);
+    }
+}
+
+//------------------------------------------------------------------------------
+FreeListMemoryManager::FreeBlock * FreeListMemoryManager::findBatchBlock(size_t count, size_t size, uint8_t alignment) const
+{
+    // Size of one object's block wherever it lands, headerless objects are never over-aligned here
+    const size_t worstCaseSize = m_headerPolicy == HeaderPolicy::Headers ? getBlockSize(sizeof(AllocationHeader) + alignment - 1, size)
+                                                                         : getBlockSize(0, size);
+
+    // Prefer a block that takes the whole run, otherwise settle for one that takes at least one object
+    const size_t runSize = count <= static_cast<size_t>(-1) / worstCaseSize ? worstCaseSize * count : static_cast<size_t>(-1);
+
+    if( m_policy == AllocationPolicy::SegregatedFit )
+    {
+        FreeBlock * freeBlock = findSizeClassBlock(runSize);
+        return freeBlock ? freeBlock : findSizeClassBlock(worstCaseSize);
+    }
+
+    FreeBlock * firstFit = nullptr;
+
+    for( FreeBlock * freeBlock = m_freeBlocks; freeBlock != nullptr; freeBlock = freeBlock->m_next )
+    {
+        if( freeBlock->m_size >= runSize )
+        {
+            return freeBlock;
+        }
+
+        if( !firstFit )
+        {
+            const size_t adjustment = m_headerPolicy == HeaderPolicy::Headers ? getAdjustment(freeBlock, alignment) : 0;
+
+            if( getBlockSize(adjustment, size) <= freeBlock->m_size )
+            {
+                firstFit = freeBlock;
+            }
+        }
+    }
+
+    return firstFit;
+}
+
+//------------------------------------------------------------------------------
+size_t FreeListMemoryManager::allocateRunFromBlock(FreeBlock * freeBlock, size_t count, size_t size, uint8_t alignment, void ** out)
+{
+    const bool headerless = m_headerPolicy == HeaderPolicy::Headerless;
+    const size_t overhead = headerless ? sizeof(BlockFooter) : sizeof(AllocationHeader) + sizeof(BlockFooter);
+
+    uint8_t * blockStart = reinterpret_cast<uint8_t *>(freeBlock);
+    uint8_t * blockEnd   = blockStart + freeBlock->m_size;
+    const bool nextUsed  = getFooter(blockStart, freeBlock->m_size)->m_nextUsed;
+
+    // What is left over keeps whatever was purged of this block
+    uint8_t * residentStart;
+    uint8_t * residentEnd;
+    getResidentRange(freeBlock, residentStart, residentEnd);
+
+    removeFreeBlock(freeBlock);
+    setPreviousNextUsed(blockStart, true);
+
+    // Lay the objects out back to back, each in a block of its own, exactly as one allocate() after another would
+    uint8_t * position      = blockStart;
+    uint8_t * lastBlock     = nullptr;
+    size_t    lastBlockSize = 0;
+    size_t    padding       = 0;
+    size_t    numAllocated  = 0;
+
+    while( numAllocated < count )
+    {
+        const size_t adjustment = headerless ? 0 : getAdjustment(position, alignment);
+        const size_t blockSize  = getBlockSize(adjustment, size);
+
+        if( blockSize > static_cast<size_t>(blockEnd - position) )
+        {
+            break;
+        }
+
+        if( !headerless )
+        {
+            AllocationHeader * header = reinterpret_cast<AllocationHeader *>(position + adjustment - sizeof(AllocationHeader));
+            header->m_size       = blockSize;
+            header->m_adjustment = static_cast<uint8_t>(adjustment);
+        }
+
+        setFooter(position, blockSize, true, true);
+        out[numAllocated++] = position + adjustment;
+
+        padding      += blockSize - size - overhead;
+        lastBlock     = position;
+        lastBlockSize = blockSize;
+        position     += blockSize;
+    }
+
+    const size_t remainingSize = blockEnd - position;
+
+    if( remainingSize < MIN_BLOCK_SIZE )
+    {
+        // Too small to allocate from again, so the last block takes it, as allocateFromBlock() does
+        const size_t totalSize = lastBlockSize + remainingSize;
+
+        if( headerless )
+        {
+            // Leave the real size where the sized free will look for it
+            getFooter(lastBlock, lastBlockSize)->m_size = totalSize;
+        }
+        else
+        {
+            reinterpret_cast<AllocationHeader *>(static_cast<uint8_t *>(out[numAllocated - 1]) - sizeof(AllocationHeader))->m_size = totalSize;
+        }
+
+        setFooter(lastBlock, totalSize, true, nextUsed);
+
+        padding  += remainingSize;
+        position  = blockEnd;
+    }
+    else
+    {
+        // The rest goes back on the free list as one block
+        FreeBlock * nextBlock = reinterpret_cast<FreeBlock *>(position);
+        nextBlock->m_size = remainingSize;
+        setFooter(nextBlock, remainingSize, false, nextUsed);
+        insertFreeBlock(nextBlock, residentStart, residentEnd);
+
+        getFooter(lastBlock, lastBlockSize)->m_nextUsed = false;
+    }
+
+    m_usedMemory     += position - blockStart;
+    m_numAllocations += numAllocated;
+    m_statistics.recordAllocations(numAllocated, size, padding, overhead * numAllocated, m_usedMemory);
+
+    return numAllocated;
+}
+
+//------------------------------------------------------------------------------
+void FreeListMemoryManager::freeBatch(void ** ptrs, size_t count)
+{
+    if( m_headerPolicy == HeaderPolicy::Headerless )
+    {
+        // Error - No header to find the block from
+        const std::string msg("Headerless allocations can only be freed with the size and alignment they were allocated with.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    releaseSortedBatch(ptrs, count, 0);
+}
+
+//------------------------------------------------------------------------------
+void FreeListMemoryManager::freeBatch(void ** ptrs, size_t count, size_t size, uint8_t)
+{
+    if( size <= 0 )
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid size. Size must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    releaseSortedBatch(ptrs, count, m_headerPolicy == HeaderPolicy::Headerless ? size : 0);
+}
+
+//------------------------------------------------------------------------------
+void FreeListMemoryManager::releaseSortedBatch(void ** ptrs, size_t count, size_t size)
+{
+    if( !count )
+    {
+        return;
+    }
+
+    std::sort(ptrs, ptrs + count, std::less<void *>());
+
+    if( !ptrs[0] )
+    {
+        // Error - p is nullptr
+        const std::string msg("p is nullptr");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    // Blocks never overlap, so in address order each block either directly follows the one before or starts a new run
+    const size_t headerlessBlockSize = size ? getBlockSize(0, size) : 0;
+
+    auto getBlock = [this, headerlessBlockSize](void * p, uint8_t *& blockStart, size_t & blockSize)
+    {
+        if( headerlessBlockSize )
+        {
+            blockStart = static_cast<uint8_t *>(p);
+            blockSize  = getFooter(p, headerlessBlockSize)->m_size;
+        }
+        else
+        {
+            const AllocationHeader * header = reinterpret_cast<AllocationHeader *>(static_cast<uint8_t *>(p) - sizeof(AllocationHeader));
+            blockStart = static_cast<uint8_t *>(p) - header->m_adjustment;
+            blockSize  = header->m_size;
+        }
+    };
+
+    size_t index = 0;
+
+    while( index < count )
+    {
+        uint8_t * runStart;
+        size_t    runSize;
+        getBlock(ptrs[index++], runStart, runSize);
+
+        size_t numBlocks = 1;
+
+        while( index < count )
+        {
+            uint8_t * blockStart;
+            size_t    blockSize;
+            getBlock(ptrs[index], blockStart, blockSize);
+
+            if( blockStart != runStart + runSize )
+            {
+                break;
+            }
+
+            runSize += blockSize;
+            ++numBlocks;
+            ++index;
+        }
+
+        releaseBlock(runStart, runSize, numBlocks);
+    }
+}
+
+//------------------------------------------------------------------------------
+void * FreeListMemoryManager::reallocate(void * p, size_t newSize, uint8_t alignment)
+{
+    if( !p )
+    {
+        return allocate(newSize, alignment);
+    }
+
+    if( newSize <= 0 )
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid size requested. Size must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( !alignment )
+    {
+        // Error - Invalid alignment
+        const std::string msg("Invalid alignment. Alignment must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( m_headerPolicy == HeaderPolicy::Headerless )
+    {
+        // Error - No header to find the current size from
+        const std::string msg("Headerless allocations cannot be reallocated, as their current size is not known.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( reinterpret_cast<uintptr_t>(p) % alignment == 0 && tryExpandInPlace(p, newSize) )
+    {
+        return p;
+    }
+
+    // Move it
+    const size_t oldSize = getAllocationSize(p);
+    void * newP = allocate(newSize, alignment);
+
+    std::memcpy(newP, p, oldSize < newSize ? oldSize : newSize);
+    free(p);
+
+    return newP;
+}
+
+//------------------------------------------------------------------------------
+bool FreeListMemoryManager::tryExpandInPlace(void * p, size_t newSize)
+{
+    if( !p )
+    {
+        // Error - p is nullptr
+        const std::string msg("p is nullptr");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( newSize <= 0 )
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid size requested. Size must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( m_headerPolicy == HeaderPolicy::Headerless )
+    {
+        // The current size of a headerless allocation is not known, so it cannot be resized
+        return false;
+    }
+
+    AllocationHeader * header = reinterpret_cast<AllocationHeader *>(static_cast<uint8_t *>(p) - sizeof(AllocationHeader));
+
+    uint8_t * blockStart   = static_cast<uint8_t *>(p) - header->m_adjustment;
+    size_t    blockSize    = header->m_size;
+    uint8_t * blockEnd     = blockStart + blockSize;
+    size_t    newBlockSize = getBlockSize(header->m_adjustment, newSize);
+    bool      nextUsed     = getFooter(blockStart, blockSize)->m_nextUsed;
+
+    // Find out if the physical block that follows this one is free
+    FreeBlock * nextFreeBlock = (blockEnd != m_end && !nextUsed) ? reinterpret_cast<FreeBlock *>(blockEnd) : nullptr;
+
+    size_t availableSize = blockSize;
+
+    if( newBlockSize > blockSize )
+    {
+        // Grow into the following block
+        if( !nextFreeBlock || blockSize + nextFreeBlock->m_size < newBlockSize )
+        {
+            return false;
+        }
+    }
+    else if( newBlockSize == blockSize || (blockSize - newBlockSize < MIN_BLOCK_SIZE && !nextFreeBlock) )
+    {
+        // Nothing to do, or shrinking would leave a remainder too small to be a free block on its own, so just keep it
+        return true;
+    }
+
+    // Shrinking frees the resident end of this block, whatever is left of the following free block keeps what was purged of it
+    uint8_t * residentStart = blockStart + std::min(newBlockSize, blockSize);
+    uint8_t * residentEnd   = blockEnd;
+
+    // The following free block is either being grown into or is taking back the remainder, either way it is rebuilt
+    if( nextFreeBlock != nullptr )
+    {
+        uint8_t * nextResidentStart;
+        uint8_t * nextResidentEnd;
+        getResidentRange(nextFreeBlock, nextResidentStart, nextResidentEnd);
+
+        residentEnd = blockEnd + sizeof(FreeBlock) + sizeof(PurgeInfo);
+        extendRange(residentStart, residentEnd, nextResidentStart, nextResidentEnd);
+
+        nextUsed       = getFooter(nextFreeBlock, nextFreeBlock->m_size)->m_nextUsed;
+        availableSize += nextFreeBlock->m_size;
+        removeFreeBlock(nextFreeBlock);
+    }
+
+    if( availableSize - newBlockSize < MIN_BLOCK_SIZE )
+    {
+        // Cannot fit any additional allocations in the remainder, take all of it
+        newBlockSize = availableSize;
+        setFooter(blockStart, newBlockSize, true, nextUsed);
+    }
+    else
+    {
+        // Create a new FreeBlock containing remaining memory and insert it into the list
+        FreeBlock * remainder = reinterpret_cast<FreeBlock *>(blockStart + newBlockSize);
+        remainder->m_size = availableSize - newBlockSize;
+        setFooter(remainder, remainder->m_size, false, nextUsed);
+
+        insertFreeBlock(remainder, residentStart, residentEnd);
+        setFooter(blockStart, newBlockSize, true, false);
+    }
+
+    header->m_size = newBlockSize;
+
+    m_usedMemory += newBlockSize;
+    m_usedMemory -= blockSize;
+    m_statistics.recordUsedMemory(m_usedMemory);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+FreeListMemoryManager::Handle FreeListMemoryManager::allocateRelocatable(size_t size, uint8_t alignment)
+{
+    validateAllocation(size, alignment);
+
+    // Take a slot before the block, so that nothing can fail once the block is allocated
+    if( m_freeRelocatableSlot == NO_SLOT )
+    {
+        RelocatableSlot slot = {};
+        slot.m_offset = NO_SLOT;
+
+        m_relocatableSlots.push_back(slot);
+        m_freeRelocatableSlot = static_cast<uint32_t>(m_relocatableSlots.size() - 1);
+    }
+
+    void * p = tryAllocate(size, alignment);
+
+    if( !p && m_numRelocatable > 0 )
+    {
+        compact();
+        p = tryAllocate(size, alignment);
+    }
+
+    if( !p )
+    {
+        m_statistics.recordFailure();
+
+        const std::string msg("No free space large enough to accomodate requested size was found.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    const uint32_t    slotIndex = m_freeRelocatableSlot;
+    RelocatableSlot & slot      = m_relocatableSlots[slotIndex];
+    m_freeRelocatableSlot = slot.m_offset;
+
+    if( m_headerPolicy == HeaderPolicy::Headerless )
+    {
+        // Headerless blocks start at p, and the footer where a block of this size would end holds the real size of the block
+        slot.m_blockStart = static_cast<uint8_t *>(p);
+        slot.m_blockSize  = getFooter(p, getBlockSize(0, size))->m_size;
+    }
+    else
+    {
+        const AllocationHeader * header = reinterpret_cast<AllocationHeader *>(static_cast<uint8_t *>(p) - sizeof(AllocationHeader));
+        slot.m_blockStart = static_cast<uint8_t *>(p) - header->m_adjustment;
+        slot.m_blockSize  = header->m_size;
+    }
+
+    slot.m_offset    = static_cast<uint32_t>(static_cast<uint8_t *>(p) - slot.m_blockStart);
+    slot.m_alignment = alignment;
+    ++slot.m_generation;
+    ++m_numRelocatable;
+
+    return Handle{ slotIndex, slot.m_generation };
+}
+
+//------------------------------------------------------------------------------
+void FreeListMemoryManager::freeRelocatable(Handle handle)
+{
+    RelocatableSlot & slot = getRelocatableSlot(handle);
+    releaseBlock(slot.m_blockStart, slot.m_blockSize);
+
+    ++slot.m_generation;
+    slot.m_offset = m_freeRelocatableSlot;
+    m_freeRelocatableSlot = handle.m_slot;
+    --m_numRelocatable;
+}
+
+//------------------------------------------------------------------------------
+void * FreeListMemoryManager::resolve(Handle handle) const
+{
+    const RelocatableSlot & slot = getRelocatableSlot(handle);
+    return slot.m_blockStart + slot.m_offset;
+}
+
+//------------------------------------------------------------------------------
+bool FreeListMemoryManager::isValid(Handle handle) const
+{
+    return handle.m_slot < m_relocatableSlots.size() && (handle.m_generation & 1)
+        && m_relocatableSlots[handle.m_slot].m_generation == handle.m_generation;
+}
+
+//------------------------------------------------------------------------------
+FreeListMemoryManager::RelocatableSlot & FreeListMemoryManager::getRelocatableSlot(Handle handle)
+{
+    return const_cast<RelocatableSlot &>(static_cast<const FreeListMemoryManager *>(this)->getRelocatableSlot(handle));
+}
+
+//------------------------------------------------------------------------------
+const FreeListMemoryManager::RelocatableSlot & FreeListMemoryManager::getRelocatableSlot(Handle handle) const
+{
+    if( !isValid(handle) )
+    {
+        // Error - Stale or foreign handle
+        const std::string msg("Invalid handle. The allocation was freed, or the handle did not come from this memory manager.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    return m_relocatableSlots[handle.m_slot];
+}
+
+//------------------------------------------------------------------------------
+size_t FreeListMemoryManager::compact(size_t maxBytesMoved)
+{
+    m_compactionOrder.clear();
+
+    for( uint32_t slotIndex = 0; slotIndex < m_relocatableSlots.size(); ++slotIndex )
+    {
+        if( m_relocatableSlots[slotIndex].m_generation & 1 )
+        {
+            m_compactionOrder.push_back(slotIndex);
+        }
+    }
+
+    // Highest first, so that free space is carried down past a whole run of relocatable blocks in one pass
+    std::sort(m_compactionOrder.begin(), m_compactionOrder.end(), [this](uint32_t lhs, uint32_t rhs)
+    {
+        return std::greater<const uint8_t *>()(m_relocatableSlots[lhs].m_blockStart, m_relocatableSlots[rhs].m_blockStart);
+    });
+
+    size_t bytesMoved = 0;
+
+    for( uint32_t slotIndex : m_compactionOrder )
+    {
+        if( bytesMoved >= maxBytesMoved )
+        {
+            break;
+        }
+
+        bytesMoved += relocate(m_relocatableSlots[slotIndex]);
+    }
+
+    return bytesMoved;
+}
+
+//------------------------------------------------------------------------------
+size_t FreeListMemoryManager::relocate(RelocatableSlot & slot)
+{
+    uint8_t *    blockStart = slot.m_blockStart;
+    const size_t blockSize  = slot.m_blockSize;
+
+    if( blockStart + blockSize == m_end || getFooter(blockStart, blockSize)->m_nextUsed )
+    {
+        return 0;
+    }
+
+    FreeBlock *  nextBlock = reinterpret_cast<FreeBlock *>(blockStart + blockSize);
+    const size_t nextSize  = nextBlock->m_size;
+
+    // Move by a multiple of both the alignment and the block granularity, so that the object stays aligned.
+    // The space moved out of becomes a free block, so a move shorter than the smallest block is not made,
+    // which only happens for alignments that are not a power of two.
+    const size_t granularity = std::lcm<size_t>(slot.m_alignment, alignof(FreeBlock));
+    const size_t distance    = nextSize - nextSize % granularity;
+
+    if( distance < MIN_BLOCK_SIZE )
+    {
+        return 0;
+    }
+
+    const bool nextUsed = getFooter(nextBlock, nextSize)->m_nextUsed;
+    removeFreeBlock(nextBlock);
+
+    // The header, if there is one, moves with the block. Whatever is left of the free block is too small
+    // to be a block of its own, so the moved block takes it.
+    uint8_t *    newBlockStart = blockStart + distance;
+    const size_t newBlockSize  = blockSize + nextSize - distance;
+
+    memmove(newBlockStart, blockStart, blockSize);
+    setFooter(newBlockStart, newBlockSize, true, nextUsed);
+
+    if( m_headerPolicy == HeaderPolicy::Headers )
+    {
+        AllocationHeader * header = reinterpret_cast<AllocationHeader *>(newBlockStart + slot.m_offset - sizeof(AllocationHeader));
+        header->m_size = newBlockSize;
+    }
+
+    m_usedMemory += newBlockSize - blockSize;
+    m_statistics.recordUsedMemory(m_usedMemory);
+
+    // The space the block moved out of merges with the free block before it, if there is one
+    uint8_t * freeStart = blockStart;
+    size_t    freeSize  = distance;
+
+    // The space moved out of is resident, the free block before it keeps whatever was purged of it
+    uint8_t * residentStart = blockStart;
+    uint8_t * residentEnd   = blockStart + distance;
+
+    if( freeStart != m_start )
+    {
+        const BlockFooter * previousFooter = reinterpret_cast<BlockFooter *>(freeStart - sizeof(BlockFooter));
+
+        if( !previousFooter->m_used )
+        {
+            residentStart = blockStart - sizeof(BlockFooter);
+
+            freeStart -= previousFooter->m_size;
+            freeSize  += previousFooter->m_size;
+
+            uint8_t * previousResidentStart;
+            uint8_t * previousResidentEnd;
+            getResidentRange(reinterpret_cast<FreeBlock *>(freeStart), previousResidentStart, previousResidentEnd);
+            extendRange(residentStart, residentEnd, previousResidentStart, previousResidentEnd);
+
+            removeFreeBlock(reinterpret_cast<FreeBlock *>(freeStart));
+        }
+    }
+
+    FreeBlock * freeBlock = reinterpret_cast<FreeBlock *>(freeStart);
+    freeBlock->m_size = freeSize;
+    setFooter(freeBlock, freeSize, false, true);
+    setPreviousNextUsed(freeBlock, false);
+    insertFreeBlock(freeBlock, residentStart, residentEnd);
+
+    slot.m_blockStart = newBlockStart;
+    slot.m_blockSize  = newBlockSize;
+
+    return blockSize;
+}
+
+//------------------------------------------------------------------------------
+size_t FreeListMemoryManager::getAllocationSize(const void * p) const
+{
+    if( m_headerPolicy == HeaderPolicy::Headerless )
+    {
+        // Error - No header to find the size from
+        const std::string msg("Headerless allocations do not record their size.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    const AllocationHeader * header = reinterpret_cast<const AllocationHeader *>(static_cast<const uint8_t *>(p) - sizeof(AllocationHeader));
+    return header->m_size - header->m_adjustment - sizeof(BlockFooter);
+}
+
+//------------------------------------------------------------------------------
+bool FreeListMemoryManager::owns(const void * p) const
+{
+    const uint8_t * address = static_cast<const uint8_t *>(p);
+    return address >= static_cast<const uint8_t *>(m_start) && address < static_cast<const uint8_t *>(m_end);
+}
+
+//------------------------------------------------------------------------------
+const void * FreeListMemoryManager::getStart() const
+{
+    return m_start;
+}
+
+//------------------------------------------------------------------------------
+const void * FreeListMemoryManager::getEnd() const
+{
+    return m_end;
+}
+
+//------------------------------------------------------------------------------
+FreeListMemoryManager::HeaderPolicy FreeListMemoryManager::getHeaderPolicy() const
+{
+    return m_headerPolicy;
+}
+
+//------------------------------------------------------------------------------
+FreeListMemoryManager::PurgeInfo * FreeListMemoryManager::getPurgeInfo(FreeBlock * freeBlock)
+{
+    return reinterpret_cast<PurgeInfo *>(reinterpret_cast<uint8_t *>(freeBlock) + sizeof(FreeBlock));
+}
+
+//------------------------------------------------------------------------------
+void FreeListMemoryManager::getResidentRange(FreeBlock * freeBlock, uint8_t *& residentStart, uint8_t *& residentEnd) const
+{
+    if( freeBlock->m_size < m_minPurgeSize )
+    {
+        // Never purged
+        residentStart = reinterpret_cast<uint8_t *>(freeBlock);
+        residentEnd   = residentStart + freeBlock->m_size;
+        return;
+    }
+
+    const PurgeInfo * purgeInfo = getPurgeInfo(freeBlock);
+    residentStart = purgeInfo->m_residentStart;
+    residentEnd   = purgeInfo->m_residentEnd;
+}
+
+//------------------------------------------------------------------------------
+size_t FreeListMemoryManager::purgeBlock(FreeBlock * freeBlock)
+{
+    PurgeInfo * purgeInfo = getPurgeInfo(freeBlock);
+
+    if( purgeInfo->m_residentStart >= purgeInfo->m_residentEnd )
+    {
+        return 0;
+    }
+
+    // Leave the free block, the purge info and the footer in place, only the whole pages between them go,
+    // and of those only the ones overlapping the range that may still be resident
+    const uintptr_t pageMask = ~static_cast<uintptr_t>(BackingStore::getPageSize(m_backingStorePolicy) - 1);
+    const uintptr_t first    = (std::max(reinterpret_cast<uintptr_t>(purgeInfo + 1), reinterpret_cast<uintptr_t>(purgeInfo->m_residentStart) & pageMask) + ~pageMask) & pageMask;
+    const uintptr_t last     = std::min(reinterpret_cast<uintptr_t>(getFooter(freeBlock, freeBlock->m_size)), reinterpret_cast<uintptr_t>(purgeInfo->m_residentEnd) + ~pageMask) & pageMask;
+
+    purgeInfo->m_residentStart = purgeInfo->m_residentEnd;
+
+    if( last <= first )
+    {
+        return 0;
+    }
+
+    // Merging can take pages purged before into the range, so only count, and only bother purging, what is resident now
+    void * const pages         = reinterpret_cast<void *>(first);
+    const size_t residentBytes = BackingStore::getResidentBytes(pages, last - first);
+
+    if( !residentBytes || !BackingStore::purge(pages, last - first, m_backingStorePolicy, m_purgeMode) )
+    {
+        return 0;
+    }
+
+    return residentBytes;
+}
+
+//------------------------------------------------------------------------------
+size_t FreeListMemoryManager::purgeFreeBlocks(uint64_t maxEpoch)
+{
+    size_t purgedBytes = 0;
+
+    auto purgeIfOld = [&](FreeBlock * freeBlock)
+    {
+        if( freeBlock->m_size >= m_minPurgeSize && getPurgeInfo(freeBlock)->m_epoch <= maxEpoch )
+        {
+            purgedBytes += purgeBlock(freeBlock);
+        }
+    };
+
+    if( m_policy == AllocationPolicy::SegregatedFit )
+    {
+        // Size classes below the one holding m_minPurgeSize only hold smaller blocks
+        size_t minFirstLevelIndex;
+        size_t minSecondLevelIndex;
+        mapSize(m_minPurgeSize, minFirstLevelIndex, minSecondLevelIndex);
+
+        for( uint64_t firstLevelMap = m_firstLevelBitmap & (~0ull << minFirstLevelIndex); firstLevelMap; firstLevelMap &= firstLevelMap - 1 )
+        {
+            const size_t firstLevelIndex = findFirstSet(firstLevelMap);
+
+            for( uint32_t secondLevelMap = m_secondLevelBitmaps[firstLevelIndex]; secondLevelMap; secondLevelMap &= secondLevelMap - 1 )
+            {
+                for( FreeBlock * freeBlock = m_sizeClasses[firstLevelIndex][findFirstSet(secondLevelMap)]; freeBlock != nullptr; freeBlock = freeBlock->m_next )
+                {
+                    purgeIfOld(freeBlock);
+                }
+            }
+        }
+    }
+    else
+    {
+        for( FreeBlock * freeBlock = m_freeBlocks; freeBlock != nullptr; freeBlock = freeBlock->m_next )
+        {
+            purgeIfOld(freeBlock);
+        }
+    }
+
+    m_statistics.recordPurge(purgedBytes);
+    return purgedBytes;
+}
+
+//------------------------------------------------------------------------------
+void FreeListMemoryManager::setDecay(std::chrono::milliseconds decayTime, BackingStore::PurgeMode purgeMode)
+{
+    m_decayTime = decayTime;
+    m_purgeMode = purgeMode;
+}
+
+//------------------------------------------------------------------------------
+size_t FreeListMemoryManager::decay()
+{
+    if( m_decayTime.count() <= 0 )
+    {
+        return purge();
+    }
+
+    // Epochs only ever advance one at a time, and only once a whole epoch has passed since the last one started,
+    // so a block freed in epoch e has been free for at least a decay time when epoch e + DECAY_EPOCHS + 1 starts,
+    // however seldom this is called
+    const Clock::time_point now = Clock::now();
+
+    if( (now - m_decayEpochStart) * static_cast<Clock::rep>(DECAY_EPOCHS) < m_decayTime )
+    {
+        return 0;
+    }
+
+    ++m_decayEpoch;
+    m_decayEpochStart = now;
+
+    if( m_decayEpoch <= DECAY_EPOCHS )
+    {
+        return 0;
+    }
+
+    return purgeFreeBlocks(m_decayEpoch - DECAY_EPOCHS - 1);
+}
+
+//------------------------------------------------------------------------------
+size_t FreeListMemoryManager::purge()
+{
+    return purgeFreeBlocks(UINT64_MAX);
+}
+
+//------------------------------------------------------------------------------
+MemoryStatistics FreeListMemoryManager::getStatistics() const
+{
+    MemoryStatistics statistics = m_statistics;
+    statistics.m_capacity       = static_cast<uint8_t *>(m_end) - static_cast<uint8_t *>(m_start);
+    statistics.m_usedMemory     = m_usedMemory;
+    statistics.m_numAllocations = m_numAllocations;
+
+    size_t numFreeBlocks    = 0;
+    size_t largestFreeBlock = 0;
+
+    if( m_policy == AllocationPolicy::SegregatedFit )
+    {
+        // Only the non-empty size classes need to be visited
+        for( uint64_t firstLevelMap = m_firstLevelBitmap; firstLevelMap; firstLevelMap &= firstLevelMap - 1 )
+        {
+            const size_t firstLevelIndex = findFirstSet(firstLevelMap);
+
+            for( uint32_t secondLevelMap = m_secondLevelBitmaps[firstLevelIndex]; secondLevelMap; secondLevelMap &= secondLevelMap - 1 )
+            {
+                for( const FreeBlock * freeBlock = m_sizeClasses[firstLevelIndex][findFirstSet(secondLevelMap)]; freeBlock != nullptr; freeBlock = freeBlock->m_next )
+                {
+                    ++numFreeBlocks;
+                    largestFreeBlock = freeBlock->m_size > largestFreeBlock ? freeBlock->m_size : largestFreeBlock;
+                }
+            }
+        }
+    }
+    else
+    {
+        for( const FreeBlock * freeBlock = m_freeBlocks; freeBlock != nullptr; freeBlock = freeBlock->m_next )
+        {
+            ++numFreeBlocks;
+            largestFreeBlock = freeBlock->m_size > largestFreeBlock ? freeBlock->m_size : largestFreeBlock;
+        }
+    }
+
+    // Every byte of the blocks that is not used is free
+    statistics.setFreeBlocks(numFreeBlocks, statistics.m_capacity - m_usedMemory, largestFreeBlock);
+
+    statistics.m_reservedBytes = m_size;
+
+    return statistics;
+}
+
+//------------------------------------------------------------------------------
+size_t FreeListMemoryManager::getResidentBytes() const
+{
+    return BackingStore::getResidentBytes(m_start, m_size);
 }
 
 //------------------------------------------------------------------------------
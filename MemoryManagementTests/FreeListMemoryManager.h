@@ -1,14 +1,40 @@
 #pragma once
 
 // Project Includes
+#include "BackingStore.h"
 #include "IMemoryManager.h"
 
 // Standard Includes
+#include <chrono>
 #include <cstdint>
+#include <vector>
 
 //------------------------------------------------------------------------------
 class FreeListMemoryManager : public IMemoryManager
 {
+public:
+
+    // How a free block is chosen to satisfy an allocation
+    enum class AllocationPolicy
+    {
+        FirstFit,       // Walk the free list and take the first block that fits
+        SegregatedFit   // Take a block from the smallest non-empty size class that is guaranteed to fit (TLSF style)
+    };
+
+    // Whether allocations carry a header recording their block
+    enum class HeaderPolicy
+    {
+        Headers,        // free(p) finds the block from the header in front of p
+        Headerless      // No header, the sized free(p, size, alignment) finds the block from the size instead
+    };
+
+    // Refers to a relocatable allocation, which compact() may move
+    struct Handle
+    {
+        uint32_t m_slot;
+        uint32_t m_generation;   // Changed every time the slot is reused, so stale handles are caught
+    };
+
 protected:
 
     struct AllocationHeader
@@ -17,25 +43,210 @@ protected:
         uint8_t m_adjustment;
     };
 
+    // Boundary tag written at the end of every block, free or allocated,
+    // so that a block can find the physical block that precedes it
+    // It also records whether the block that follows is used, as an allocated block may not start with its size
+    // Block sizes are always a multiple of 8, so the flags share a word with the size
+    struct BlockFooter
+    {
+        size_t m_used     : 1;
+        size_t m_nextUsed : 1;
+        size_t m_size     : sizeof(size_t) * 8 - 2;
+    };
+
     struct FreeBlock
     {
         size_t      m_size;
-        FreeBlock * m_next;
+        FreeBlock * m_next;       // Next block in the free list, or in the size class for SegregatedFit
+        FreeBlock * m_previous;   // Previous block in the free list, or in the size class for SegregatedFit
     };
 
-    size_t      m_size;            // Total size of allocated memory, in bytes
-    void *      m_start;           // First address in allocated memory
-    size_t      m_usedMemory;      // Number of bytes used
-    size_t      m_numAllocations;  // Number of caller allocations that have occured
-    FreeBlock * m_freeBlocks;
+    // Size classes are split into power of two first level ranges,
+    // each of which is split into 2^SECOND_LEVEL_INDEX_LOG2 linear second level ranges
+    static const size_t SECOND_LEVEL_INDEX_LOG2  = 4;
+    static const size_t SECOND_LEVEL_INDEX_COUNT = 1 << SECOND_LEVEL_INDEX_LOG2;
+    static const size_t FIRST_LEVEL_INDEX_COUNT  = sizeof(size_t) * 8 - SECOND_LEVEL_INDEX_LOG2 + 1;
+
+    // Every block must be able to become a FreeBlock again once it is freed
+    static const size_t MIN_BLOCK_SIZE = sizeof(FreeBlock) + sizeof(BlockFooter);
+
+    static const uint32_t NO_SLOT = UINT32_MAX;
+
+    // Kept just after the FreeBlock of every free block of at least m_minPurgeSize bytes, so that decay() can tell
+    // how long the block has been free and which of its pages may still be resident. It lies in the first page of the
+    // block, which is never purged.
+    struct PurgeInfo
+    {
+        uint64_t  m_epoch;           // Decay epoch the block was freed in
+        uint8_t * m_residentStart;   // Only pages overlapping [m_residentStart, m_residentEnd) may still be resident,
+        uint8_t * m_residentEnd;     // the rest of the block has been purged. Empty once all of it has been.
+    };
+
+    // Epochs in a decay time. A block is purged once DECAY_EPOCHS whole epochs have passed since it was freed.
+    static const uint64_t DECAY_EPOCHS = 4;
+
+    typedef std::chrono::steady_clock Clock;
+
+    // Where a relocatable allocation lives now
+    struct RelocatableSlot
+    {
+        uint8_t * m_blockStart;
+        size_t    m_blockSize;
+        uint32_t  m_offset;       // From the start of the block to the caller's address when in use, next free slot when not
+        uint32_t  m_generation;   // Odd while in use
+        uint8_t   m_alignment;
+    };
+
+    size_t           m_size;            // Total size of allocated memory, in bytes
+    void *           m_start;           // First address in allocated memory
+    void *           m_end;             // One past the last address that belongs to a block
+    size_t           m_usedMemory;      // Number of bytes used
+    size_t           m_numAllocations;  // Number of caller allocations that have occured
+    FreeBlock *      m_freeBlocks;      // Free blocks in no particular order, only used by FirstFit
+    AllocationPolicy m_policy;
+    HeaderPolicy     m_headerPolicy;
+    MemoryStatistics m_statistics;
+
+    BackingStore::Policy m_backingStorePolicy;
+
+    // Relocatable allocations
+    std::vector<RelocatableSlot> m_relocatableSlots;
+    uint32_t                     m_freeRelocatableSlot;   // Head of the free slot list
+    size_t                       m_numRelocatable;        // Relocatable allocations that are live now
+    std::vector<uint32_t>        m_compactionOrder;       // Live slots in the order compact() visits them
+
+    // Purging
+    size_t                    m_minPurgeSize;      // Smallest free block that is purged, two backing store pages
+    std::chrono::milliseconds m_decayTime;
+    BackingStore::PurgeMode   m_purgeMode;
+    uint64_t                  m_decayEpoch;
+    Clock::time_point         m_decayEpochStart;
+
+    // Segregated fit index
+    // A set bit in the first level bitmap means the second level bitmap at that index is non-zero,
+    // a set bit in a second level bitmap means the size class list at that index is non-empty
+    uint64_t    m_firstLevelBitmap;
+    uint32_t    m_secondLevelBitmaps[FIRST_LEVEL_INDEX_COUNT];
+    FreeBlock * m_sizeClasses[FIRST_LEVEL_INDEX_COUNT][SECOND_LEVEL_INDEX_COUNT];
+
+    static uint8_t getAdjustment(const void * address, uint8_t alignment);
+    static size_t getHeaderlessAdjustment(const void * address, uint8_t alignment);
+    static size_t getBlockSize(size_t adjustment, size_t size);
+    static void mapSize(size_t size, size_t & firstLevelIndex, size_t & secondLevelIndex);
+    static BlockFooter * getFooter(void * blockStart, size_t blockSize);
+    static void setFooter(void * blockStart, size_t blockSize, bool used, bool nextUsed);
+
+    void setPreviousNextUsed(void * blockStart, bool nextUsed);
+    void releaseBlock(uint8_t * blockStart, size_t blockSize, size_t numBlocks = 1);
+
+    void validateAllocation(size_t size, uint8_t alignment) const;
+
+    // Returns nullptr, without recording a failure, if no free block fits
+    void * tryAllocate(size_t size, uint8_t alignment);
+
+    // Throws if the handle is stale, or did not come from this manager
+    RelocatableSlot & getRelocatableSlot(Handle handle);
+    const RelocatableSlot & getRelocatableSlot(Handle handle) const;
+
+    // Slides a relocatable block up into the free block that follows it, returns the bytes moved
+    size_t relocate(RelocatableSlot & slot);
+
+    static PurgeInfo * getPurgeInfo(FreeBlock * freeBlock);
+
+    // The part of a free block that may be resident, leaving out the boundary tags at either end, which always are.
+    // Empty once the block has been purged.
+    void getResidentRange(FreeBlock * freeBlock, uint8_t *& residentStart, uint8_t *& residentEnd) const;
+
+    // Purges the pages inside a free block that may still be resident, returns the bytes purged
+    size_t purgeBlock(FreeBlock * freeBlock);
+
+    // Purges every free block large enough that was freed in maxEpoch or earlier, returns the bytes purged
+    size_t purgeFreeBlocks(uint64_t maxEpoch);
+
+    FreeBlock * findSizeClassBlock(size_t size) const;
+
+    // Links a free block into its list and starts its decay over. A block made of memory that was already free, by
+    // merging or splitting, passes the range of it that may be resident, so that pages purged before stay purged.
+    void insertFreeBlock(FreeBlock * freeBlock);
+    void insertFreeBlock(FreeBlock * freeBlock, uint8_t * residentStart, uint8_t * residentEnd);
+    void removeFreeBlock(FreeBlock * freeBlock);
+    void * allocateFromBlock(FreeBlock * freeBlock, size_t size, size_t adjustment);
+
+    // Batch helpers, a batch is carved from and given back to the free list a run of adjacent blocks at a time
+    FreeBlock * findBatchBlock(size_t count, size_t size, uint8_t alignment) const;
+    size_t allocateRunFromBlock(FreeBlock * freeBlock, size_t count, size_t size, uint8_t alignment, void ** out);
+    void releaseSortedBatch(void ** ptrs, size_t count, size_t size);
 
 public:
 
-    FreeListMemoryManager(size_t size);
+    FreeListMemoryManager(size_t size, AllocationPolicy policy = AllocationPolicy::FirstFit,
+                          BackingStore::Policy backingStorePolicy = BackingStore::Policy::Malloc,
+                          HeaderPolicy headerPolicy = HeaderPolicy::Headers);
     FreeListMemoryManager(const FreeListMemoryManager &) = delete;
     FreeListMemoryManager & operator = (const FreeListMemoryManager &) = delete;
     ~FreeListMemoryManager();
 
     void * allocate(size_t size, uint8_t alignment);
     void free(void* p);
+    void free(void * p, size_t size, uint8_t alignment);
+
+    // Carves as many of the objects as fit from one free block at a time, in address order, with one set of counter updates per block
+    void allocateBatch(size_t count, size_t size, uint8_t alignment, void ** out);
+
+    // Sorts ptrs by address, then gives back each run of adjacent blocks as a single block, so it is coalesced once
+    void freeBatch(void ** ptrs, size_t count);
+    void freeBatch(void ** ptrs, size_t count, size_t size, uint8_t alignment);
+
+    void * reallocate(void * p, size_t newSize, uint8_t alignment);
+    bool tryExpandInPlace(void * p, size_t newSize);
+
+    // Relocatable allocations are reached through handles, so that compact() can move them to merge the free space
+    // around them. A pointer from resolve() is only valid until the next call to allocateRelocatable() or compact().
+    // Other allocations are never moved, and relocatable blocks are not moved past them.
+    // If nothing fits, allocateRelocatable() compacts and tries once more before throwing.
+    Handle allocateRelocatable(size_t size, uint8_t alignment);
+    void freeRelocatable(Handle handle);
+    void * resolve(Handle handle) const;
+    bool isValid(Handle handle) const;
+
+    // Slides relocatable blocks, highest first, up into the free blocks that follow them, so that the free space
+    // between fixed blocks merges into one block. Stops early once maxBytesMoved bytes have been moved,
+    // so that the work can be spread over several calls. Returns the bytes moved.
+    size_t compact(size_t maxBytesMoved = SIZE_MAX);
+
+    // Purging hands the whole pages inside large free blocks back to the OS, so that memory sized for a burst does not
+    // stay resident once the burst is over. The address range is kept, and purged pages are faulted in again when reused.
+    // decay() only purges blocks that have stayed free for the decay time, so that blocks in steady use are not purged
+    // and faulted in over and over. Nothing is purged unless decay() or purge() is called, so call decay() from a timer
+    // or an idle loop, several times per decay time. Both return the bytes purged.
+    void setDecay(std::chrono::milliseconds decayTime, BackingStore::PurgeMode purgeMode = BackingStore::PurgeMode::Eager);
+    size_t decay();
+
+    // Purges every free block now, however recently it was freed
+    size_t purge();
+
+    // Number of bytes the caller may use at p, which may be more than was requested
+    size_t getAllocationSize(const void * p) const;
+
+    // Whether p lies inside the memory this manager hands out, which says nothing about whether it is allocated
+    bool owns(const void * p) const;
+
+    // First address, and one past the last address, of the memory this manager hands out
+    const void * getStart() const;
+    const void * getEnd() const;
+
+    HeaderPolicy getHeaderPolicy() const;
+
+    // Walks the free blocks to fill in the free block count, the largest free block and fragmentation
+    MemoryStatistics getStatistics() const;
+
+    // Bytes of the memory that are resident in physical memory now. Asks the OS about every page, so it is not
+    // part of getStatistics(), and is best called as rarely as the purging it is meant to check on.
+    size_t getResidentBytes() const;
+
+    // Allocate and free without argument validation, for statically dispatched callers that validate at compile time
+    // The caller guarantees that size and alignment are greater than zero and that p came from this manager
+    void * allocateUnchecked(size_t size, uint8_t alignment);
+    void freeUnchecked(void * p);
+    void freeUnchecked(void * p, size_t size, uint8_t alignment);
 };
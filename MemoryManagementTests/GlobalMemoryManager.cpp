@@ -0,0 +1,489 @@
+
+// Project Includes
+#include "GlobalMemoryManager.h"
+
+// Standard Includes
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+//------------------------------------------------------------------------------
+// Initial exec, so that reading a thread local never allocates, even when this is built into a preloaded shared library
+#if defined(__GNUC__)
+#define INITIAL_EXEC_TLS __attribute__((tls_model("initial-exec")))
+#else
+#define INITIAL_EXEC_TLS
+#endif
+
+// Set while the calling thread is inside the global memory manager
+static thread_local bool t_inside INITIAL_EXEC_TLS = false;
+
+static std::atomic<GlobalMemoryManager *> g_instance(nullptr);
+static std::atomic<bool>                  g_creatingInstance(false);
+
+// The instance is never destroyed, so it lives in static storage rather than being a static object
+alignas(GlobalMemoryManager) static unsigned char g_instanceStorage[sizeof(GlobalMemoryManager)];
+
+// What malloc guarantees, and what operator new guarantees without an explicit alignment
+static const size_t DEFAULT_ALIGNMENT = alignof(std::max_align_t);
+
+//------------------------------------------------------------------------------
+// Marks the calling thread as inside the global memory manager, and takes the lock if the memory manager needs one
+class ScopedEntry
+{
+public:
+
+    ScopedEntry(std::mutex & mutex, bool lock)
+        :
+        m_mutex(mutex)
+      , m_locked(lock)
+    {
+        t_inside = true;
+
+        if( m_locked )
+        {
+            m_mutex.lock();
+        }
+    }
+
+    ~ScopedEntry()
+    {
+        if( m_locked )
+        {
+            m_mutex.unlock();
+        }
+
+        t_inside = false;
+    }
+
+    ScopedEntry(const ScopedEntry &) = delete;
+    ScopedEntry & operator = (const ScopedEntry &) = delete;
+
+private:
+
+    std::mutex & m_mutex;
+    bool         m_locked;
+};
+
+//------------------------------------------------------------------------------
+// Reads a byte count, optionally ending in K, M or G, without allocating
+// Returns false, leaving size untouched, if the text is not a count or the count does not fit in a size_t
+static bool parseSize(const char * text, size_t & size)
+{
+    // strtoull() would accept leading space and signs, and negate a negative count
+    if( *text < '0' || *text > '9' )
+    {
+        return false;
+    }
+
+    char * end = nullptr;
+    errno = 0;
+    const unsigned long long value = std::strtoull(text, &end, 10);
+
+    if( errno == ERANGE )
+    {
+        return false;
+    }
+
+    size_t shift = 0;
+
+    switch( *end )
+    {
+    case 'k': case 'K': shift = 10; ++end; break;
+    case 'm': case 'M': shift = 20; ++end; break;
+    case 'g': case 'G': shift = 30; ++end; break;
+    default: break;
+    }
+
+    if( *end || !value || value > (static_cast<unsigned long long>(SIZE_MAX) >> shift) )
+    {
+        return false;
+    }
+
+    size = static_cast<size_t>(value) << shift;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+GlobalMemoryManager::Configuration::Configuration()
+    :
+    m_composition(Composition::ThreadCaching)
+  , m_size(static_cast<size_t>(1) << 30)
+  , m_maxSize(static_cast<size_t>(1) << 20)
+  , m_reportStatistics(false)
+{
+}
+
+//------------------------------------------------------------------------------
+GlobalMemoryManager::Configuration GlobalMemoryManager::Configuration::fromEnvironment()
+{
+    Configuration configuration;
+
+    if( const char * composition = std::getenv("MEMORY_MANAGER") )
+    {
+        const struct
+        {
+            const char * m_name;
+            Composition  m_composition;
+        }
+        compositions[] =
+        {
+            { "system",        Composition::System        },
+            { "firstfit",      Composition::FirstFit      },
+            { "segregatedfit", Composition::SegregatedFit },
+            { "threadcaching", Composition::ThreadCaching },
+            { "buddy",         Composition::Buddy         }
+        };
+
+        for( const auto & entry : compositions )
+        {
+            if( std::strcmp(composition, entry.m_name) == 0 )
+            {
+                configuration.m_composition = entry.m_composition;
+            }
+        }
+    }
+
+    if( const char * size = std::getenv("MEMORY_MANAGER_SIZE") )
+    {
+        parseSize(size, configuration.m_size);
+    }
+
+    if( const char * maxSize = std::getenv("MEMORY_MANAGER_MAX_SIZE") )
+    {
+        parseSize(maxSize, configuration.m_maxSize);
+    }
+
+    configuration.m_reportStatistics = std::getenv("MEMORY_MANAGER_STATISTICS") != nullptr;
+
+    return configuration;
+}
+
+//------------------------------------------------------------------------------
+GlobalMemoryManager::GlobalMemoryManager(const Configuration & configuration, const SystemAllocator & systemAllocator)
+    :
+    m_configuration(configuration)
+  , m_systemAllocator(systemAllocator)
+  , m_freeList(nullptr)
+  , m_threadCaching(nullptr)
+  , m_buddy(nullptr)
+  , m_memoryManager(nullptr)
+  , m_needsLock(false)
+  , m_mutex()
+  , m_systemAllocations(0)
+{
+    // The memory managers must never get their memory from malloc, which may be the shim calling in here
+    const BackingStore::Policy backingStorePolicy = BackingStore::Policy::Mapped;
+
+    try
+    {
+        switch( m_configuration.m_composition )
+        {
+        case Composition::FirstFit:
+            m_freeList      = new FreeListMemoryManager(m_configuration.m_size, FreeListMemoryManager::AllocationPolicy::FirstFit, backingStorePolicy);
+            m_memoryManager = m_freeList;
+            m_needsLock     = true;
+            break;
+
+        case Composition::SegregatedFit:
+            m_freeList      = new FreeListMemoryManager(m_configuration.m_size, FreeListMemoryManager::AllocationPolicy::SegregatedFit, backingStorePolicy);
+            m_memoryManager = m_freeList;
+            m_needsLock     = true;
+            break;
+
+        case Composition::ThreadCaching:
+            m_freeList      = new FreeListMemoryManager(m_configuration.m_size, FreeListMemoryManager::AllocationPolicy::SegregatedFit, backingStorePolicy);
+            m_threadCaching = new ThreadCachingMemoryManager(*m_freeList);
+            m_memoryManager = m_threadCaching;
+            break;
+
+        case Composition::Buddy:
+            m_buddy         = new BuddyMemoryManager(m_configuration.m_size, 64, backingStorePolicy);
+            m_memoryManager = m_buddy;
+            m_needsLock     = true;
+            break;
+
+        default:
+            break;
+        }
+    }
+    catch( ... )
+    {
+        // Serve everything from the system rather than fail
+        delete m_threadCaching;
+        delete m_freeList;
+        delete m_buddy;
+
+        m_freeList      = nullptr;
+        m_threadCaching = nullptr;
+        m_buddy         = nullptr;
+        m_memoryManager = nullptr;
+        m_needsLock     = false;
+        m_configuration.m_composition = Composition::System;
+    }
+}
+
+//------------------------------------------------------------------------------
+GlobalMemoryManager::~GlobalMemoryManager()
+{
+    delete m_threadCaching;
+    delete m_freeList;
+    delete m_buddy;
+}
+
+//------------------------------------------------------------------------------
+static void writeInstanceStatistics()
+{
+    g_instance.load(std::memory_order_acquire)->writeStatistics();
+}
+
+//------------------------------------------------------------------------------
+GlobalMemoryManager * GlobalMemoryManager::getInstance(const SystemAllocator & systemAllocator)
+{
+    if( t_inside )
+    {
+        return nullptr;
+    }
+
+    GlobalMemoryManager * instance = g_instance.load(std::memory_order_acquire);
+
+    if( instance )
+    {
+        return instance;
+    }
+
+    // Only one thread creates the instance, any other thread uses the system until it is ready
+    if( g_creatingInstance.exchange(true, std::memory_order_acq_rel) )
+    {
+        return nullptr;
+    }
+
+    // Everything allocated while the instance is created comes from the system
+    t_inside = true;
+
+    instance = new (g_instanceStorage) GlobalMemoryManager(Configuration::fromEnvironment(), systemAllocator);
+    g_instance.store(instance, std::memory_order_release);
+
+    if( instance->m_configuration.m_reportStatistics )
+    {
+        std::atexit(writeInstanceStatistics);
+    }
+
+    t_inside = false;
+
+    return instance;
+}
+
+//------------------------------------------------------------------------------
+void * GlobalMemoryManager::allocateFromMemoryManager(size_t size, size_t alignment)
+{
+    ScopedEntry entry(m_mutex, m_needsLock);
+
+    try
+    {
+        return m_memoryManager->allocate(size, static_cast<uint8_t>(alignment));
+    }
+    catch( ... )
+    {
+        // The memory manager is full, or too fragmented to fit the request
+        return nullptr;
+    }
+}
+
+//------------------------------------------------------------------------------
+void GlobalMemoryManager::freeToMemoryManager(void * p)
+{
+    ScopedEntry entry(m_mutex, m_needsLock);
+
+    try
+    {
+        m_memoryManager->free(p);
+    }
+    catch( const std::exception & e )
+    {
+        // Error - The memory manager caught a double free, or a pointer it never handed out
+        // There is no way to report it to a caller of free(), so stop, as the system allocator would
+        std::fputs("GlobalMemoryManager: invalid free: ", stderr);
+        std::fputs(e.what(), stderr);
+        std::fputs("\n", stderr);
+        std::abort();
+    }
+}
+
+//------------------------------------------------------------------------------
+void * GlobalMemoryManager::allocate(size_t size, size_t alignment)
+{
+    if( !size )
+    {
+        size = 1;
+    }
+
+    if( m_memoryManager )
+    {
+        if( size <= m_configuration.m_maxSize && alignment <= MAX_ALIGNMENT )
+        {
+            if( void * p = allocateFromMemoryManager(size, alignment) )
+            {
+                return p;
+            }
+        }
+
+        m_systemAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if( alignment <= DEFAULT_ALIGNMENT )
+    {
+        return m_systemAllocator.m_allocate(size);
+    }
+
+    return m_systemAllocator.m_allocateAligned(size, alignment);
+}
+
+//------------------------------------------------------------------------------
+void GlobalMemoryManager::free(void * p)
+{
+    if( !p )
+    {
+        return;
+    }
+
+    if( owns(p) )
+    {
+        freeToMemoryManager(p);
+        return;
+    }
+
+    m_systemAllocator.m_free(p);
+}
+
+//------------------------------------------------------------------------------
+void * GlobalMemoryManager::reallocate(void * p, size_t newSize)
+{
+    if( !p )
+    {
+        return allocate(newSize, DEFAULT_ALIGNMENT);
+    }
+
+    if( !newSize )
+    {
+        free(p);
+        return nullptr;
+    }
+
+    if( !owns(p) )
+    {
+        // Blocks from the system stay with the system
+        return m_systemAllocator.m_reallocate(p, newSize);
+    }
+
+    if( newSize <= m_configuration.m_maxSize )
+    {
+        ScopedEntry entry(m_mutex, m_needsLock);
+
+        try
+        {
+            return m_memoryManager->reallocate(p, newSize, static_cast<uint8_t>(DEFAULT_ALIGNMENT));
+        }
+        catch( ... )
+        {
+            // The memory manager leaves p untouched when it cannot fit the new size, so move it to the system below
+        }
+    }
+
+    const size_t oldSize = getAllocationSize(p);
+    void * newP = allocate(newSize, DEFAULT_ALIGNMENT);
+
+    if( !newP )
+    {
+        return nullptr;
+    }
+
+    std::memcpy(newP, p, oldSize < newSize ? oldSize : newSize);
+    free(p);
+
+    return newP;
+}
+
+//------------------------------------------------------------------------------
+size_t GlobalMemoryManager::getAllocationSize(void * p)
+{
+    if( !p )
+    {
+        return 0;
+    }
+
+    if( !owns(p) )
+    {
+        return m_systemAllocator.m_getAllocationSize(p);
+    }
+
+    ScopedEntry entry(m_mutex, m_needsLock);
+
+    if( m_threadCaching )
+    {
+        return m_threadCaching->getAllocationSize(p);
+    }
+
+    if( m_freeList )
+    {
+        return m_freeList->getAllocationSize(p);
+    }
+
+    return m_buddy->getAllocationSize(p);
+}
+
+//------------------------------------------------------------------------------
+bool GlobalMemoryManager::owns(const void * p) const
+{
+    // The thread caching memory manager hands out memory from its free list
+    if( m_freeList )
+    {
+        return m_freeList->owns(p);
+    }
+
+    return m_buddy && m_buddy->owns(p);
+}
+
+//------------------------------------------------------------------------------
+void GlobalMemoryManager::writeStatistics() const
+{
+    const char * compositionNames[] = { "system", "first fit", "segregated fit", "thread caching", "buddy" };
+
+    // Building the report allocates, which must go to the system while the lock is held
+    const bool inside = t_inside;
+    t_inside = true;
+
+    {
+        std::string report("Global memory manager: ");
+        report += compositionNames[static_cast<int>(m_configuration.m_composition)];
+        report += "\n";
+
+        if( m_memoryManager )
+        {
+            MemoryStatistics statistics;
+
+            if( m_needsLock )
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                statistics = m_memoryManager->getStatistics();
+            }
+            else
+            {
+                statistics = m_memoryManager->getStatistics();
+            }
+
+            report += "Statistics: " + statistics.toJson() + "\n";
+            report += "Requests served by the system: " + std::to_string(m_systemAllocations.load(std::memory_order_relaxed)) + "\n";
+        }
+
+        std::fputs(report.c_str(), stderr);
+    }
+
+    t_inside = inside;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,123 @@
+#pragma once
+
+// Project Includes
+#include "BuddyMemoryManager.h"
+#include "FreeListMemoryManager.h"
+#include "ThreadCachingMemoryManager.h"
+
+// Standard Includes
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+
+//------------------------------------------------------------------------------
+// Serves every allocation of a process from a composition of the memory managers, for the replacement
+// global operator new and delete in GlobalOperatorNew.cpp and the LD_PRELOAD malloc shim in MallocShim.cpp
+//
+// Requests up to the maximum size and alignment go to the chosen memory manager, everything else goes to the system
+// allocator that the replacement was handed. A request the memory manager cannot fit also falls back to the system,
+// so a process never fails because the region was sized too small. free() tells the two apart by address.
+//
+// The memory managers allocate as they are used, for their own bookkeeping, and report errors by throwing,
+// which allocates too. Any allocation made while the calling thread is already inside the global memory manager
+// goes to the system allocator, so that it never calls back into itself.
+//
+// The composition is read from the environment the first time memory is allocated, so that the same binary can be
+// compared against the system allocator without being rebuilt:
+//
+//   MEMORY_MANAGER             system, firstfit, segregatedfit, threadcaching or buddy, defaults to threadcaching
+//   MEMORY_MANAGER_SIZE        Bytes of address space to reserve for the memory manager, defaults to 1 GiB.
+//                              Pages are only faulted in when first used. May end in K, M or G.
+//   MEMORY_MANAGER_MAX_SIZE    Largest request given to the memory manager, defaults to 1 MiB. May end in K, M or G.
+//   MEMORY_MANAGER_STATISTICS  If set, the memory manager's statistics are written to stderr at exit
+class GlobalMemoryManager
+{
+public:
+
+    // Which memory managers serve the requests that do not go to the system
+    enum class Composition
+    {
+        System,          // Every request goes to the system allocator, the baseline to compare against
+        FirstFit,        // A FreeListMemoryManager using first fit, behind a mutex
+        SegregatedFit,   // A FreeListMemoryManager using segregated fit, behind a mutex
+        ThreadCaching,   // A ThreadCachingMemoryManager in front of a segregated fit FreeListMemoryManager
+        Buddy            // A BuddyMemoryManager with 64 byte minimum blocks, behind a mutex
+    };
+
+    struct Configuration
+    {
+        Composition m_composition;
+        size_t      m_size;                // Bytes of address space reserved for the memory manager
+        size_t      m_maxSize;             // Larger requests go to the system
+        bool        m_reportStatistics;    // Write statistics to stderr at exit
+
+        Configuration();
+
+        // Defaults, overridden by any of the environment variables that are set and valid
+        static Configuration fromEnvironment();
+    };
+
+    // The allocator that requests the memory managers do not serve go to
+    struct SystemAllocator
+    {
+        void * (*m_allocate)(size_t size);
+        void * (*m_allocateAligned)(size_t size, size_t alignment);
+        void * (*m_reallocate)(void * p, size_t size);
+        void   (*m_free)(void * p);
+        size_t (*m_getAllocationSize)(void * p);
+    };
+
+    // Largest alignment the memory managers are given, larger alignments go to the system
+    static const size_t MAX_ALIGNMENT = 128;
+
+protected:
+
+    Configuration   m_configuration;
+    SystemAllocator m_systemAllocator;
+
+    // Only the ones the composition needs are created
+    FreeListMemoryManager *      m_freeList;
+    ThreadCachingMemoryManager * m_threadCaching;
+    BuddyMemoryManager *         m_buddy;
+    IMemoryManager *             m_memoryManager;    // The one requests go to, or nullptr for System
+    bool                         m_needsLock;        // Whether m_memoryManager must be called under m_mutex
+    mutable std::mutex           m_mutex;
+
+    // Counted only when a request goes to the system, so that routing costs nothing extra otherwise
+    std::atomic<size_t> m_systemAllocations;
+
+    void * allocateFromMemoryManager(size_t size, size_t alignment);
+    void freeToMemoryManager(void * p);
+
+public:
+
+    GlobalMemoryManager(const Configuration & configuration, const SystemAllocator & systemAllocator);
+    GlobalMemoryManager(const GlobalMemoryManager &) = delete;
+    GlobalMemoryManager & operator = (const GlobalMemoryManager &) = delete;
+    ~GlobalMemoryManager();
+
+    // The process wide instance, created from the environment on first use and never destroyed,
+    // because memory is still freed after static destructors have run.
+    // Returns nullptr while the calling thread is already inside the global memory manager, or while another thread
+    // is creating the instance, in which case the caller should use the system allocator directly.
+    static GlobalMemoryManager * getInstance(const SystemAllocator & systemAllocator);
+
+    // Never throws. Returns nullptr if neither the memory manager nor the system could allocate.
+    // Alignment must be a power of two. A size of zero is served as one byte, so that every allocation is unique.
+    void * allocate(size_t size, size_t alignment);
+    void free(void * p);
+
+    // Follows realloc: p may be nullptr, and a newSize of zero frees p and returns nullptr.
+    // Returns nullptr, leaving p untouched, if the new size could not be allocated.
+    void * reallocate(void * p, size_t newSize);
+
+    // Number of bytes the caller may use at p, which may be more than was requested
+    size_t getAllocationSize(void * p);
+
+    // Whether p was allocated by the memory manager rather than the system
+    bool owns(const void * p) const;
+
+    void writeStatistics() const;
+};
+
+//------------------------------------------------------------------------------
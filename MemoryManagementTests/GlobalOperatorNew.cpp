@@ -0,0 +1,178 @@
+
+// Replaces the global operator new and delete, every form of them, with the GlobalMemoryManager
+// Link this into a program, ahead of the standard library, to have every new and delete in it served by the memory managers.
+// It is built as the MemoryManagementGlobalNew object library, which is not part of the MemoryManagement library,
+// so that the benchmarks keep comparing against the system allocator.
+
+// Project Includes
+#include "GlobalMemoryManager.h"
+
+// Standard Includes
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+//------------------------------------------------------------------------------
+// The system allocator, which the global memory manager falls back to
+// On Windows every block comes from _aligned_malloc, so that there is only one way to free them
+#ifdef _WIN32
+static void * systemAllocate(size_t size)
+{
+    return _aligned_malloc(size, alignof(std::max_align_t));
+}
+
+static void * systemAllocateAligned(size_t size, size_t alignment)
+{
+    return _aligned_malloc(size, alignment);
+}
+
+static void * systemReallocate(void * p, size_t size)
+{
+    return _aligned_realloc(p, size, alignof(std::max_align_t));
+}
+
+static void systemFree(void * p)
+{
+    _aligned_free(p);
+}
+
+static size_t systemGetAllocationSize(void * p)
+{
+    return _aligned_msize(p, alignof(std::max_align_t), 0);
+}
+#else
+static void * systemAllocate(size_t size)
+{
+    return std::malloc(size);
+}
+
+static void * systemAllocateAligned(size_t size, size_t alignment)
+{
+    void * p = nullptr;
+    return posix_memalign(&p, alignment, size) == 0 ? p : nullptr;
+}
+
+static void * systemReallocate(void * p, size_t size)
+{
+    return std::realloc(p, size);
+}
+
+static void systemFree(void * p)
+{
+    std::free(p);
+}
+
+static size_t systemGetAllocationSize(void * p)
+{
+#ifdef __APPLE__
+    return malloc_size(p);
+#else
+    return malloc_usable_size(p);
+#endif
+}
+#endif
+
+static const GlobalMemoryManager::SystemAllocator g_systemAllocator =
+{
+    systemAllocate,
+    systemAllocateAligned,
+    systemReallocate,
+    systemFree,
+    systemGetAllocationSize
+};
+
+//------------------------------------------------------------------------------
+static void * allocate(size_t size, size_t alignment)
+{
+    if( GlobalMemoryManager * globalMemoryManager = GlobalMemoryManager::getInstance(g_systemAllocator) )
+    {
+        return globalMemoryManager->allocate(size, alignment);
+    }
+
+    if( !size )
+    {
+        size = 1;
+    }
+
+    return alignment <= alignof(std::max_align_t) ? systemAllocate(size) : systemAllocateAligned(size, alignment);
+}
+
+//------------------------------------------------------------------------------
+// Calls the new handler until the allocation succeeds, as the standard operator new does
+static void * allocateOrThrow(size_t size, size_t alignment)
+{
+    for( ;; )
+    {
+        if( void * p = allocate(size, alignment) )
+        {
+            return p;
+        }
+
+        std::new_handler handler = std::get_new_handler();
+
+        if( !handler )
+        {
+            throw std::bad_alloc();
+        }
+
+        handler();
+    }
+}
+
+//------------------------------------------------------------------------------
+static void * allocateOrNull(size_t size, size_t alignment) noexcept
+{
+    try
+    {
+        return allocateOrThrow(size, alignment);
+    }
+    catch( ... )
+    {
+        return nullptr;
+    }
+}
+
+//------------------------------------------------------------------------------
+static void deallocate(void * p) noexcept
+{
+    if( GlobalMemoryManager * globalMemoryManager = GlobalMemoryManager::getInstance(g_systemAllocator) )
+    {
+        globalMemoryManager->free(p);
+        return;
+    }
+
+    // Only reached from inside the global memory manager, or before it exists, when p came from the system
+    systemFree(p);
+}
+
+//------------------------------------------------------------------------------
+// The sized forms ignore the size, every block already records its own
+void * operator new(size_t size)                                                   { return allocateOrThrow(size, alignof(std::max_align_t)); }
+void * operator new[](size_t size)                                                 { return allocateOrThrow(size, alignof(std::max_align_t)); }
+void * operator new(size_t size, const std::nothrow_t &) noexcept                  { return allocateOrNull(size, alignof(std::max_align_t)); }
+void * operator new[](size_t size, const std::nothrow_t &) noexcept                { return allocateOrNull(size, alignof(std::max_align_t)); }
+void * operator new(size_t size, std::align_val_t alignment)                       { return allocateOrThrow(size, static_cast<size_t>(alignment)); }
+void * operator new[](size_t size, std::align_val_t alignment)                     { return allocateOrThrow(size, static_cast<size_t>(alignment)); }
+void * operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept   { return allocateOrNull(size, static_cast<size_t>(alignment)); }
+void * operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept { return allocateOrNull(size, static_cast<size_t>(alignment)); }
+
+void operator delete(void * p) noexcept                                            { deallocate(p); }
+void operator delete[](void * p) noexcept                                          { deallocate(p); }
+void operator delete(void * p, const std::nothrow_t &) noexcept                    { deallocate(p); }
+void operator delete[](void * p, const std::nothrow_t &) noexcept                  { deallocate(p); }
+void operator delete(void * p, size_t) noexcept                                    { deallocate(p); }
+void operator delete[](void * p, size_t) noexcept                                  { deallocate(p); }
+void operator delete(void * p, std::align_val_t) noexcept                          { deallocate(p); }
+void operator delete[](void * p, std::align_val_t) noexcept                        { deallocate(p); }
+void operator delete(void * p, std::align_val_t, const std::nothrow_t &) noexcept  { deallocate(p); }
+void operator delete[](void * p, std::align_val_t, const std::nothrow_t &) noexcept { deallocate(p); }
+void operator delete(void * p, size_t, std::align_val_t) noexcept                  { deallocate(p); }
+void operator delete[](void * p, size_t, std::align_val_t) noexcept                { deallocate(p); }
+
+//------------------------------------------------------------------------------
@@ -1,5 +1,8 @@
 #pragma once
 
+// Project Includes
+#include "MemoryStatistics.h"
+
 // Standard Includes
 #include <cstdint>
 
@@ -16,6 +19,86 @@ public:
 
     virtual void * allocate(size_t size, uint8_t alignment) = 0;
     virtual void free(void * p) = 0;
+
+    /// <summary>
+    /// Frees p, given the size and alignment it was allocated with
+    /// Memory managers that keep no headers need these to find the block, others may ignore them.
+    /// </summary>
+    virtual void free(void * p, size_t, uint8_t)
+    {
+        free(p);
+    }
+
+    /// <summary>
+    /// Allocates count objects of the same size and alignment, writing their addresses to out
+    /// Either every object is allocated or, if one cannot be, none are and the failure is thrown.
+    /// Memory managers that can carve a run of objects in one pass override this, the default allocates one at a time.
+    /// </summary>
+    virtual void allocateBatch(size_t count, size_t size, uint8_t alignment, void ** out)
+    {
+        size_t numAllocated = 0;
+
+        try
+        {
+            for( ; numAllocated < count; ++numAllocated )
+            {
+                out[numAllocated] = allocate(size, alignment);
+            }
+        }
+        catch( ... )
+        {
+            for( size_t index = 0; index < numAllocated; ++index )
+            {
+                free(out[index], size, alignment);
+            }
+
+            throw;
+        }
+    }
+
+    /// <summary>
+    /// Frees count allocations, which may be reordered in ptrs
+    /// Memory managers that can give back many blocks in one pass override this, the default frees one at a time.
+    /// </summary>
+    virtual void freeBatch(void ** ptrs, size_t count)
+    {
+        for( size_t index = 0; index < count; ++index )
+        {
+            free(ptrs[index]);
+        }
+    }
+
+    /// <summary>
+    /// Frees count allocations that were all made with the given size and alignment, which may be reordered in ptrs
+    /// Memory managers that keep no headers need these to find the blocks, others may ignore them.
+    /// </summary>
+    virtual void freeBatch(void ** ptrs, size_t count, size_t size, uint8_t alignment)
+    {
+        for( size_t index = 0; index < count; ++index )
+        {
+            free(ptrs[index], size, alignment);
+        }
+    }
+
+    /// <summary>
+    /// Resizes the allocation at p to newSize bytes, moving it and copying its contents if it cannot be resized in place
+    /// Returns the address of the resized allocation. If p is nullptr, this is the same as allocate.
+    /// </summary>
+    virtual void * reallocate(void * p, size_t newSize, uint8_t alignment) = 0;
+
+    /// <summary>
+    /// Attempts to grow or shrink the allocation at p to newSize bytes without moving it
+    /// Returns false, leaving the allocation untouched, if that is not possible.
+    /// </summary>
+    virtual bool tryExpandInPlace(void *, size_t)
+    {
+        return false;
+    }
+
+    /// <summary>
+    /// Returns a snapshot of the usage counters kept by the memory manager
+    /// </summary>
+    virtual MemoryStatistics getStatistics() const = 0;
 };
 
 //------------------------------------------------------------------------------
@@ -10,10 +10,14 @@
 #include <memory>
 
 //------------------------------------------------------------------------------
-LinearMemoryManager::LinearMemoryManager(size_t size)
+LinearMemoryManager::LinearMemoryManager(size_t size, BackingStore::Policy backingStorePolicy)
     :
     m_size(size)
   , m_usedMemory(0)
+  , m_numAllocations(0)
+  , m_clearCount(0)
+  , m_backingStorePolicy(backingStorePolicy)
+  , m_statistics()
 {
     if (size <= 0)
     {
@@ -22,7 +26,7 @@ LinearMemoryManager::LinearMemoryManager(size_t size)
         throw Common::Exception(__FILE__, __LINE__, msg);
     }
 
-    m_start = ::malloc(size);
+    m_start = BackingStore::allocate(size, m_backingStorePolicy);
 
     if (!m_start)
     {
@@ -37,7 +41,7 @@ LinearMemoryManager::LinearMemoryManager(size_t size)
 //------------------------------------------------------------------------------
 LinearMemoryManager::~LinearMemoryManager()
 {
-    ::free(m_start);
+    BackingStore::release(m_start, m_size, m_backingStorePolicy);
 }
 
 //------------------------------------------------------------------------------
@@ -57,11 +61,15 @@ void * LinearMemoryManager::allocate(size_t size, uint8_t alignment)
         throw Common::Exception(__FILE__, __LINE__, msg);
     }
 
-    size_t availableSpace = m_size - m_usedMemory;
-    void * alignedAddress = std::align(alignment, size, m_currentPosition, availableSpace);
+    // std::align moves the pointer it is given, so hand it a copy in order to measure the adjustment
+    size_t availableSpace  = m_size - m_usedMemory;
+    void * currentPosition = m_currentPosition;
+    void * alignedAddress  = std::align(alignment, size, currentPosition, availableSpace);
 
     if( !alignedAddress )
     {
+        m_statistics.recordFailure();
+
         // Error - Could not fit the desired number of bytes aligned by the specified alignment into the available memory space
         const std::string msg(" Could not fit the desired number of bytes aligned by the specified alignment into the available memory space.");
         throw Common::Exception(__FILE__, __LINE__, msg);
@@ -73,14 +81,144 @@ void * LinearMemoryManager::allocate(size_t size, uint8_t alignment)
     m_usedMemory += adjustment + size;
     m_currentPosition = (static_cast<uint8_t *>(alignedAddress) + size);
     ++m_numAllocations;
+    m_statistics.recordAllocation(size, adjustment, 0, m_usedMemory);
 
     return alignedAddress;
 }
 
+//------------------------------------------------------------------------------
+void LinearMemoryManager::allocateBatch(size_t count, size_t size, uint8_t alignment, void ** out)
+{
+    if (size <= 0)
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid size requested. Size must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if (!alignment || (alignment & (alignment - 1)))
+    {
+        // Error - Invalid alignment
+        const std::string msg("Invalid alignment. Alignment must be a power of two.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if (!count)
+    {
+        return;
+    }
+
+    // After the first object, each one starts at the end of the one before, rounded up to the alignment
+    uint8_t * currentPosition = static_cast<uint8_t *>(m_currentPosition);
+    uint8_t * alignedAddress  = reinterpret_cast<uint8_t *>((reinterpret_cast<uintptr_t>(currentPosition) + alignment - 1) &
+                                                            ~static_cast<uintptr_t>(alignment - 1));
+    const size_t stride       = (size + alignment - 1) & ~static_cast<size_t>(alignment - 1);
+    const size_t adjustment   = alignedAddress - currentPosition;
+    const size_t available    = m_size - m_usedMemory;
+
+    if (adjustment > available || size > available - adjustment || count - 1 > (available - adjustment - size) / stride)
+    {
+        m_statistics.recordFailure();
+
+        // Error - Could not fit the desired number of bytes aligned by the specified alignment into the available memory space
+        const std::string msg(" Could not fit the desired number of bytes aligned by the specified alignment into the available memory space.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    for (size_t index = 0; index < count; ++index)
+    {
+        out[index] = alignedAddress + index * stride;
+    }
+
+    const size_t batchSize = adjustment + stride * (count - 1) + size;
+
+    m_usedMemory     += batchSize;
+    m_currentPosition = currentPosition + batchSize;
+    m_numAllocations += count;
+    m_statistics.recordAllocations(count, size, batchSize - size * count, 0, m_usedMemory);
+}
+
 //------------------------------------------------------------------------------
 void LinearMemoryManager::clear()
 {
+    m_statistics.recordFree(m_numAllocations);
+
     m_numAllocations  = 0;
     m_usedMemory      = 0;
     m_currentPosition = m_start;
+    ++m_clearCount;
+}
+
+//------------------------------------------------------------------------------
+LinearMemoryManager::Marker LinearMemoryManager::getMarker() const
+{
+    Marker marker;
+    marker.m_position       = m_currentPosition;
+    marker.m_usedMemory     = m_usedMemory;
+    marker.m_numAllocations = m_numAllocations;
+    marker.m_clearCount     = m_clearCount;
+
+    return marker;
+}
+
+//------------------------------------------------------------------------------
+void LinearMemoryManager::rewindTo(const Marker & marker)
+{
+    if( !tryRewindTo(marker) )
+    {
+        // Error - Marker is stale, or not behind the current position
+        const std::string msg("Invalid marker. Can only rewind to a marker taken from this memory manager since it was last cleared, and not rewound past.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+}
+
+//------------------------------------------------------------------------------
+bool LinearMemoryManager::tryRewindTo(const Marker & marker) noexcept
+{
+    // A marker taken before the last clear() may point anywhere into what has been allocated since
+    if( marker.m_clearCount != m_clearCount || marker.m_position < m_start || marker.m_position > m_currentPosition ||
+        marker.m_numAllocations > m_numAllocations || marker.m_usedMemory > m_usedMemory )
+    {
+        return false;
+    }
+
+    m_statistics.recordFree(m_numAllocations - marker.m_numAllocations);
+
+    m_currentPosition = marker.m_position;
+    m_usedMemory      = marker.m_usedMemory;
+    m_numAllocations  = marker.m_numAllocations;
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+MemoryStatistics LinearMemoryManager::getStatistics() const
+{
+    MemoryStatistics statistics = m_statistics;
+    statistics.m_capacity       = m_size;
+    statistics.m_usedMemory     = m_usedMemory;
+    statistics.m_numAllocations = m_numAllocations;
+
+    return statistics;
+}
+
+//------------------------------------------------------------------------------
+BackingStore::Policy LinearMemoryManager::getBackingStorePolicy() const
+{
+    return m_backingStorePolicy;
+}
+
+//------------------------------------------------------------------------------
+LinearMemoryManager::Scope::Scope(LinearMemoryManager & memoryManager)
+    :
+    m_memoryManager(memoryManager)
+  , m_marker(memoryManager.getMarker())
+{
+}
+
+//------------------------------------------------------------------------------
+LinearMemoryManager::Scope::~Scope()
+{
+    // A destructor must not throw, so a scope that was already rewound past is left alone
+    m_memoryManager.tryRewindTo(m_marker);
 }
@@ -1,5 +1,9 @@
 #pragma once
 
+// Project Includes
+#include "BackingStore.h"
+#include "MemoryStatistics.h"
+
 // Standard Includes
 #include <cstdint>
 
@@ -7,9 +11,40 @@
 // A pool of memory that us allocated once and freed once
 //
 // New allocations simply move the pointer to the first free address forward.
-// Individual deallocations cannot be made, instead use clear() to completely clear the memory used by the allocator.
+// Individual deallocations cannot be made, instead use clear() to completely clear the memory used by the allocator,
+// or rewindTo() a marker taken earlier to release everything allocated since.
 class LinearMemoryManager
 {
+public:
+
+    // A position in the memory manager that can be rewound to later
+    struct Marker
+    {
+        void * m_position;        // Address of the first free byte at the time the marker was taken
+        size_t m_usedMemory;      // Number of bytes used at the time the marker was taken
+        size_t m_numAllocations;  // Number of caller allocations at the time the marker was taken
+        size_t m_clearCount;      // Number of times the memory manager had been cleared when the marker was taken
+    };
+
+    // Rewinds the memory manager to where it was when the scope was entered, when the scope is left
+    // Scopes may be nested, but must be left in the reverse order they were entered
+    // Nothing is rewound if the memory manager was cleared after the scope was entered, or was rewound past the scope
+    // and has not made as many allocations again since
+    class Scope
+    {
+    public:
+
+        explicit Scope(LinearMemoryManager & memoryManager);
+        Scope(const Scope &) = delete;
+        Scope & operator = (const Scope &) = delete;
+        ~Scope();
+
+    protected:
+
+        LinearMemoryManager & m_memoryManager;
+        Marker                m_marker;
+    };
+
 protected:
 
     size_t m_size;             // Total size of allocated memory, in bytes
@@ -17,15 +52,62 @@ protected:
     size_t m_usedMemory;       // Number of bytes used
     size_t m_numAllocations;   // Number of caller allocations that have occured
     void * m_currentPosition;  // Address to first available free byte
+    size_t m_clearCount;       // Number of times clear() has been called, so that older markers are refused
+
+    BackingStore::Policy m_backingStorePolicy;
+    MemoryStatistics     m_statistics;
+
+    // Rewinds to the marker, or returns false and leaves everything as it is if the memory manager was cleared
+    // since the marker was taken, or is behind the marker
+    bool tryRewindTo(const Marker & marker) noexcept;
 
 public:
 
-    LinearMemoryManager(size_t size);
+    LinearMemoryManager(size_t size, BackingStore::Policy backingStorePolicy = BackingStore::Policy::Malloc);
     LinearMemoryManager(const LinearMemoryManager &) = delete;
     LinearMemoryManager & operator = (const LinearMemoryManager &) = delete;
     ~LinearMemoryManager();
 
     void * allocate(size_t size, uint8_t alignment);
+
+    // Bumps the pointer once for the whole batch, the objects are laid out as one allocate() after another would
+    void allocateBatch(size_t count, size_t size, uint8_t alignment, void ** out);
+
     void clear();
+
+    Marker getMarker() const;
+    void rewindTo(const Marker & marker);
+
+    MemoryStatistics getStatistics() const;
+
+    // The policy the memory came from, which may be a fallback from the one requested
+    BackingStore::Policy getBackingStorePolicy() const;
+
+    // Bump allocation without argument validation, visible here so that statically dispatched callers can inline it
+    // The caller guarantees that size is greater than zero and alignment is a power of two
+    void * allocateUnchecked(size_t size, uint8_t alignment);
 };
 
+//------------------------------------------------------------------------------
+inline void * LinearMemoryManager::allocateUnchecked(size_t size, uint8_t alignment)
+{
+    uint8_t * currentPosition = static_cast<uint8_t *>(m_currentPosition);
+    uint8_t * alignedAddress  = reinterpret_cast<uint8_t *>((reinterpret_cast<uintptr_t>(currentPosition) + alignment - 1) &
+                                                            ~static_cast<uintptr_t>(alignment - 1));
+
+    const size_t usedMemory = m_usedMemory + (alignedAddress - currentPosition) + size;
+
+    if( usedMemory > m_size )
+    {
+        // Let the checked path report that the request does not fit
+        return allocate(size, alignment);
+    }
+
+    m_usedMemory      = usedMemory;
+    m_currentPosition = alignedAddress + size;
+    ++m_numAllocations;
+    m_statistics.recordAllocation(size, alignedAddress - currentPosition, 0, usedMemory);
+
+    return alignedAddress;
+}
+
@@ -0,0 +1,252 @@
+
+// Replaces malloc and the functions around it with the GlobalMemoryManager, for use through LD_PRELOAD, so that
+// an unmodified binary is served by the memory managers. The standard library's operator new calls malloc, so new and
+// delete are served too. It is built as the MemoryManagementPreload shared library, on glibc only:
+//
+//   MEMORY_MANAGER=segregatedfit LD_PRELOAD=./libMemoryManagementPreload.so ./program
+//
+// Requests the memory managers do not serve go to glibc's own allocator, through its __libc_ entry points,
+// rather than through dlsym(RTLD_NEXT), which may itself allocate.
+
+// Project Includes
+#include "GlobalMemoryManager.h"
+
+// Standard Includes
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+#ifndef __GLIBC__
+#error The malloc shim relies on the __libc_ allocation functions, which only glibc provides
+#endif
+
+#include <dlfcn.h>
+#include <unistd.h>
+
+//------------------------------------------------------------------------------
+extern "C"
+{
+    void * __libc_malloc(size_t size);
+    void * __libc_calloc(size_t count, size_t size);
+    void * __libc_realloc(void * p, size_t size);
+    void * __libc_memalign(size_t alignment, size_t size);
+    void   __libc_free(void * p);
+}
+
+// Only the replaced functions are visible outside the shim, so that the copy of the memory managers in it
+// never clashes with one linked into the program
+#define SHIM_EXPORT extern "C" __attribute__((visibility("default")))
+
+//------------------------------------------------------------------------------
+static void * systemAllocateAligned(size_t size, size_t alignment)
+{
+    return __libc_memalign(alignment, size);
+}
+
+//------------------------------------------------------------------------------
+// glibc has no __libc_ name for malloc_usable_size, so it is looked up the first time a block from glibc is asked about.
+// That never happens while the memory manager is in use, so dlsym is free to allocate.
+static size_t systemGetAllocationSize(void * p)
+{
+    typedef size_t (*GetAllocationSize)(void *);
+    static std::atomic<GetAllocationSize> getAllocationSize(nullptr);
+
+    GetAllocationSize function = getAllocationSize.load(std::memory_order_acquire);
+
+    if( !function )
+    {
+        function = reinterpret_cast<GetAllocationSize>(dlsym(RTLD_NEXT, "malloc_usable_size"));
+        getAllocationSize.store(function, std::memory_order_release);
+    }
+
+    return p && function ? function(p) : 0;
+}
+
+static const GlobalMemoryManager::SystemAllocator g_systemAllocator =
+{
+    __libc_malloc,
+    systemAllocateAligned,
+    __libc_realloc,
+    __libc_free,
+    systemGetAllocationSize
+};
+
+static const size_t DEFAULT_ALIGNMENT = alignof(std::max_align_t);
+
+//------------------------------------------------------------------------------
+static void * allocate(size_t size, size_t alignment)
+{
+    if( GlobalMemoryManager * globalMemoryManager = GlobalMemoryManager::getInstance(g_systemAllocator) )
+    {
+        return globalMemoryManager->allocate(size, alignment);
+    }
+
+    return alignment <= DEFAULT_ALIGNMENT ? __libc_malloc(size) : __libc_memalign(alignment, size);
+}
+
+//------------------------------------------------------------------------------
+// Alignment must be a power of two, and for posix_memalign a multiple of sizeof(void *)
+static bool isValidAlignment(size_t alignment)
+{
+    return alignment && !(alignment & (alignment - 1));
+}
+
+//------------------------------------------------------------------------------
+SHIM_EXPORT void * malloc(size_t size) noexcept
+{
+    void * p = allocate(size, DEFAULT_ALIGNMENT);
+
+    if( !p )
+    {
+        errno = ENOMEM;
+    }
+
+    return p;
+}
+
+//------------------------------------------------------------------------------
+SHIM_EXPORT void free(void * p) noexcept
+{
+    if( GlobalMemoryManager * globalMemoryManager = GlobalMemoryManager::getInstance(g_systemAllocator) )
+    {
+        globalMemoryManager->free(p);
+        return;
+    }
+
+    // Only reached from inside the global memory manager, or before it exists, when p came from glibc
+    __libc_free(p);
+}
+
+//------------------------------------------------------------------------------
+SHIM_EXPORT void * calloc(size_t count, size_t size) noexcept
+{
+    if( size && count > static_cast<size_t>(-1) / size )
+    {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    GlobalMemoryManager * globalMemoryManager = GlobalMemoryManager::getInstance(g_systemAllocator);
+
+    if( !globalMemoryManager )
+    {
+        return __libc_calloc(count, size);
+    }
+
+    // Blocks are reused without being cleared, so clear them here
+    void * p = globalMemoryManager->allocate(count * size, DEFAULT_ALIGNMENT);
+
+    if( !p )
+    {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    std::memset(p, 0, count * size);
+    return p;
+}
+
+//------------------------------------------------------------------------------
+SHIM_EXPORT void * realloc(void * p, size_t size) noexcept
+{
+    GlobalMemoryManager * globalMemoryManager = GlobalMemoryManager::getInstance(g_systemAllocator);
+
+    if( !globalMemoryManager )
+    {
+        return __libc_realloc(p, size);
+    }
+
+    void * newP = globalMemoryManager->reallocate(p, size);
+
+    if( !newP && size )
+    {
+        errno = ENOMEM;
+    }
+
+    return newP;
+}
+
+//------------------------------------------------------------------------------
+SHIM_EXPORT void * reallocarray(void * p, size_t count, size_t size) noexcept
+{
+    if( size && count > static_cast<size_t>(-1) / size )
+    {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    return realloc(p, count * size);
+}
+
+//------------------------------------------------------------------------------
+SHIM_EXPORT int posix_memalign(void ** out, size_t alignment, size_t size) noexcept
+{
+    if( !isValidAlignment(alignment) || alignment % sizeof(void *) )
+    {
+        return EINVAL;
+    }
+
+    void * p = allocate(size, alignment);
+
+    if( !p )
+    {
+        return ENOMEM;
+    }
+
+    *out = p;
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+SHIM_EXPORT void * aligned_alloc(size_t alignment, size_t size) noexcept
+{
+    if( !isValidAlignment(alignment) )
+    {
+        errno = EINVAL;
+        return nullptr;
+    }
+
+    void * p = allocate(size, alignment);
+
+    if( !p )
+    {
+        errno = ENOMEM;
+    }
+
+    return p;
+}
+
+//------------------------------------------------------------------------------
+SHIM_EXPORT void * memalign(size_t alignment, size_t size) noexcept
+{
+    return aligned_alloc(alignment, size);
+}
+
+//------------------------------------------------------------------------------
+SHIM_EXPORT void * valloc(size_t size) noexcept
+{
+    return aligned_alloc(static_cast<size_t>(getpagesize()), size);
+}
+
+//------------------------------------------------------------------------------
+SHIM_EXPORT void * pvalloc(size_t size) noexcept
+{
+    const size_t pageSize = static_cast<size_t>(getpagesize());
+    return aligned_alloc(pageSize, (size + pageSize - 1) & ~(pageSize - 1));
+}
+
+//------------------------------------------------------------------------------
+SHIM_EXPORT size_t malloc_usable_size(void * p) noexcept
+{
+    GlobalMemoryManager * globalMemoryManager = GlobalMemoryManager::getInstance(g_systemAllocator);
+
+    if( !globalMemoryManager )
+    {
+        return systemGetAllocationSize(p);
+    }
+
+    return globalMemoryManager->getAllocationSize(p);
+}
+
+//------------------------------------------------------------------------------
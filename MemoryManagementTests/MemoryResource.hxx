@@ -0,0 +1,88 @@
+#pragma once
+
+// Project Includes
+#include "FreeListMemoryManager.h"
+#include "LinearMemoryManager.h"
+#include "StackMemoryManager.h"
+
+// Common Library
+#include "Exception.h"
+
+// Standard Includes
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+
+//------------------------------------------------------------------------------
+/// <summary>
+/// A std::pmr::memory_resource that gets its memory from one of the memory managers
+///
+/// The memory resource does not take ownership of the memory manager, which must outlive it.
+/// Failures are reported as std::bad_alloc, as the standard containers expect.
+/// The rules of the memory manager still apply, so a StackMemoryResource can only be used by containers that
+/// deallocate in the reverse order they allocate, and a LinearMemoryResource never gives memory back until
+/// the memory manager is cleared.
+/// </summary>
+template <class MemoryManager>
+class MemoryResource : public std::pmr::memory_resource
+{
+protected:
+
+    MemoryManager & m_memoryManager;
+
+    void * do_allocate(size_t bytes, size_t alignment) override
+    {
+        // The memory managers store alignment adjustments in a byte
+        if( alignment > 128 )
+        {
+            throw std::bad_alloc();
+        }
+
+        try
+        {
+            // Zero byte requests are allowed, but must still return a unique address
+            return m_memoryManager.allocate(bytes ? bytes : 1, static_cast<uint8_t>(alignment));
+        }
+        catch( const Common::Exception & )
+        {
+            throw std::bad_alloc();
+        }
+    }
+
+    void do_deallocate(void * p, size_t bytes, size_t alignment) override
+    {
+        m_memoryManager.free(p, bytes ? bytes : 1, static_cast<uint8_t>(alignment));
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource & rhs) const noexcept override
+    {
+        // Memory from one memory resource can be deallocated by another, if they share the same memory manager
+        const MemoryResource * other = dynamic_cast<const MemoryResource *>(&rhs);
+        return other != nullptr && &other->m_memoryManager == &m_memoryManager;
+    }
+
+public:
+
+    explicit MemoryResource(MemoryManager & memoryManager)
+        :
+        m_memoryManager(memoryManager)
+    {
+    }
+
+    MemoryManager & getMemoryManager() const
+    {
+        return m_memoryManager;
+    }
+};
+
+//------------------------------------------------------------------------------
+// Individual deallocations cannot be made, the memory is reclaimed by clearing the memory manager
+template <>
+inline void MemoryResource<LinearMemoryManager>::do_deallocate(void *, size_t, size_t)
+{
+}
+
+//------------------------------------------------------------------------------
+typedef MemoryResource<FreeListMemoryManager> FreeListMemoryResource;
+typedef MemoryResource<LinearMemoryManager>   LinearMemoryResource;
+typedef MemoryResource<StackMemoryManager>    StackMemoryResource;
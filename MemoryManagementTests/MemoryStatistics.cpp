@@ -0,0 +1,79 @@
+
+// Project Includes
+#include "MemoryStatistics.h"
+
+// Standard Includes
+#include <sstream>
+
+//------------------------------------------------------------------------------
+MemoryStatistics::MemoryStatistics()
+    :
+    m_capacity(0)
+  , m_usedMemory(0)
+  , m_peakUsedMemory(0)
+  , m_numAllocations(0)
+  , m_totalAllocations(0)
+  , m_totalFrees(0)
+  , m_failedAllocations(0)
+  , m_requestedBytes(0)
+  , m_paddingBytes(0)
+  , m_overheadBytes(0)
+  , m_numFreeBlocks(0)
+  , m_largestFreeBlock(0)
+  , m_fragmentation(0.0)
+  , m_reservedBytes(0)
+  , m_purgedBytes(0)
+  , m_sizeClassHistogram()
+{
+}
+
+//------------------------------------------------------------------------------
+void MemoryStatistics::setFreeBlocks(size_t numFreeBlocks, size_t freeBytes, size_t largestFreeBlock)
+{
+    m_numFreeBlocks    = numFreeBlocks;
+    m_largestFreeBlock = largestFreeBlock;
+    m_fragmentation    = freeBytes ? 1.0 - static_cast<double>(largestFreeBlock) / static_cast<double>(freeBytes) : 0.0;
+}
+
+//------------------------------------------------------------------------------
+std::string MemoryStatistics::toJson() const
+{
+    std::ostringstream json;
+
+    json << "{"
+         << "\"capacity\":"          << m_capacity          << ","
+         << "\"usedMemory\":"        << m_usedMemory        << ","
+         << "\"peakUsedMemory\":"    << m_peakUsedMemory    << ","
+         << "\"numAllocations\":"    << m_numAllocations    << ","
+         << "\"totalAllocations\":"  << m_totalAllocations  << ","
+         << "\"totalFrees\":"        << m_totalFrees        << ","
+         << "\"failedAllocations\":" << m_failedAllocations << ","
+         << "\"requestedBytes\":"    << m_requestedBytes    << ","
+         << "\"paddingBytes\":"      << m_paddingBytes      << ","
+         << "\"overheadBytes\":"     << m_overheadBytes     << ","
+         << "\"numFreeBlocks\":"     << m_numFreeBlocks     << ","
+         << "\"largestFreeBlock\":"  << m_largestFreeBlock  << ","
+         << "\"fragmentation\":"     << m_fragmentation     << ","
+         << "\"reservedBytes\":"     << m_reservedBytes     << ","
+         << "\"purgedBytes\":"       << m_purgedBytes       << ","
+         << "\"sizeClassHistogram\":[";
+
+    // Trailing empty size classes are left out, the index of each entry is its size class
+    size_t numSizeClasses = NUM_SIZE_CLASSES;
+
+    while( numSizeClasses > 0 && !m_sizeClassHistogram[numSizeClasses - 1] )
+    {
+        --numSizeClasses;
+    }
+
+    for( size_t sizeClass = 0; sizeClass < numSizeClasses; ++sizeClass )
+    {
+        json << (sizeClass ? "," : "") << m_sizeClassHistogram[sizeClass];
+    }
+
+    json << "]}";
+
+    return json.str();
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,131 @@
+#pragma once
+
+// Standard Includes
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Usage counters kept by every memory manager, and the snapshot returned by getStatistics()
+//
+// Recording is a handful of additions per call, so it is always on. Byte totals for requests, padding and overhead
+// accumulate over every successful allocation since construction, so that their ratios describe the whole workload.
+// The free block fields are only filled in by memory managers that keep free blocks, and are zero otherwise.
+// Likewise the reserved and purged bytes are only filled in by memory managers that purge. Finding which pages are
+// resident asks the OS about every page, so those memory managers answer it separately, from getResidentBytes().
+struct MemoryStatistics
+{
+    // Requested sizes are grouped by the power of two they round up to, the last class takes everything larger
+    static const size_t NUM_SIZE_CLASSES = 32;
+
+    size_t m_capacity;            // Total size of memory managed, in bytes
+    size_t m_usedMemory;          // Bytes in use now, including padding and overhead
+    size_t m_peakUsedMemory;      // Most bytes in use at once
+    size_t m_numAllocations;      // Allocations that are live now
+    size_t m_totalAllocations;    // Successful allocations since construction
+    size_t m_totalFrees;          // Allocations given back since construction, including by clearing or rewinding
+    size_t m_failedAllocations;   // Allocations that could not be satisfied for lack of memory
+    size_t m_requestedBytes;      // Bytes asked for by all successful allocations
+    size_t m_paddingBytes;        // Bytes lost to alignment and rounding by all successful allocations
+    size_t m_overheadBytes;       // Bytes spent on headers and boundary tags by all successful allocations
+    size_t m_numFreeBlocks;       // Number of free blocks
+    size_t m_largestFreeBlock;    // Size of the largest free block, in bytes
+    double m_fragmentation;       // 1 - largest free block / free bytes, 0 when all free memory is in one block
+    size_t m_reservedBytes;       // Bytes taken from the backing store
+    size_t m_purgedBytes;         // Bytes handed back to the OS by purging since construction
+
+    size_t m_sizeClassHistogram[NUM_SIZE_CLASSES];  // Successful allocations by size class of the requested size
+
+    MemoryStatistics();
+
+    // Size class 0 holds sizes up to 1, size class i holds sizes greater than 2^(i-1) and up to 2^i
+    static size_t getSizeClass(size_t size);
+
+    void recordAllocation(size_t size, size_t padding, size_t overhead, size_t usedMemory);
+
+    // Records count allocations of the same size at once, padding and overhead are the totals for all of them
+    void recordAllocations(size_t count, size_t size, size_t padding, size_t overhead, size_t usedMemory);
+    void recordFree(size_t count = 1);
+    void recordFailure();
+    void recordUsedMemory(size_t usedMemory);
+    void recordPurge(size_t bytes);
+
+    // Fills in the free block fields from the free bytes and the largest free block
+    void setFreeBlocks(size_t numFreeBlocks, size_t freeBytes, size_t largestFreeBlock);
+
+    std::string toJson() const;
+};
+
+//------------------------------------------------------------------------------
+inline size_t MemoryStatistics::getSizeClass(size_t size)
+{
+    if( size <= 1 )
+    {
+        return 0;
+    }
+
+#ifdef _MSC_VER
+    unsigned long highestBit;
+    _BitScanReverse64(&highestBit, static_cast<uint64_t>(size - 1));
+    const size_t sizeClass = highestBit + 1;
+#else
+    const size_t sizeClass = static_cast<size_t>(64 - __builtin_clzll(static_cast<uint64_t>(size - 1)));
+#endif
+
+    return sizeClass < NUM_SIZE_CLASSES ? sizeClass : NUM_SIZE_CLASSES - 1;
+}
+
+//------------------------------------------------------------------------------
+inline void MemoryStatistics::recordAllocation(size_t size, size_t padding, size_t overhead, size_t usedMemory)
+{
+    ++m_totalAllocations;
+    m_requestedBytes += size;
+    m_paddingBytes   += padding;
+    m_overheadBytes  += overhead;
+    ++m_sizeClassHistogram[getSizeClass(size)];
+
+    recordUsedMemory(usedMemory);
+}
+
+//------------------------------------------------------------------------------
+inline void MemoryStatistics::recordAllocations(size_t count, size_t size, size_t padding, size_t overhead, size_t usedMemory)
+{
+    m_totalAllocations += count;
+    m_requestedBytes   += size * count;
+    m_paddingBytes     += padding;
+    m_overheadBytes    += overhead;
+    m_sizeClassHistogram[getSizeClass(size)] += count;
+
+    recordUsedMemory(usedMemory);
+}
+
+//------------------------------------------------------------------------------
+inline void MemoryStatistics::recordFree(size_t count)
+{
+    m_totalFrees += count;
+}
+
+//------------------------------------------------------------------------------
+inline void MemoryStatistics::recordFailure()
+{
+    ++m_failedAllocations;
+}
+
+//------------------------------------------------------------------------------
+inline void MemoryStatistics::recordPurge(size_t bytes)
+{
+    m_purgedBytes += bytes;
+}
+
+//------------------------------------------------------------------------------
+inline void MemoryStatistics::recordUsedMemory(size_t usedMemory)
+{
+    if( usedMemory > m_peakUsedMemory )
+    {
+        m_peakUsedMemory = usedMemory;
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+// Standard Includes
+#include <cstddef>
+#include <cstdint>
+
+//------------------------------------------------------------------------------
+/// <summary>
+/// A pointer that stores the distance from itself to what it points at, rather than an address
+///
+/// Structures linked with these stay valid when the memory holding them is mapped at another address,
+/// as long as both ends lie in that memory, so they can live in a PersistentMemoryManager heap across runs.
+/// Copying one recomputes the distance from its new location.
+/// </summary>
+template <class T>
+class OffsetPointer
+{
+protected:
+
+    // Would point inside the pointer itself, which can never be a T
+    static const uintptr_t NULL_OFFSET = 1;
+
+    uintptr_t m_offset;
+
+    void set(T * p)
+    {
+        m_offset = p ? reinterpret_cast<uintptr_t>(p) - reinterpret_cast<uintptr_t>(this) : NULL_OFFSET;
+    }
+
+public:
+
+    OffsetPointer()
+        :
+        m_offset(NULL_OFFSET)
+    {
+    }
+
+    OffsetPointer(T * p)
+    {
+        set(p);
+    }
+
+    OffsetPointer(const OffsetPointer & rhs)
+    {
+        set(rhs.get());
+    }
+
+    OffsetPointer & operator = (const OffsetPointer & rhs)
+    {
+        set(rhs.get());
+        return *this;
+    }
+
+    OffsetPointer & operator = (T * p)
+    {
+        set(p);
+        return *this;
+    }
+
+    T * get() const
+    {
+        return m_offset == NULL_OFFSET ? nullptr : reinterpret_cast<T *>(reinterpret_cast<uintptr_t>(this) + m_offset);
+    }
+
+    T * operator -> () const
+    {
+        return get();
+    }
+
+    T & operator * () const
+    {
+        return *get();
+    }
+
+    explicit operator bool () const
+    {
+        return m_offset != NULL_OFFSET;
+    }
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,651 @@
+
+// Project Includes
+#include "PersistentMemoryManager.h"
+
+// Common Libary
+#include "Exception.h"
+
+// Standard Includes
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Index of the lowest set bit. value must be non-zero.
+static size_t findFirstSet(uint64_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return index;
+#else
+    return static_cast<size_t>(__builtin_ctzll(value));
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Index of the highest set bit. value must be non-zero.
+static size_t findLastSet(uint64_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return index;
+#else
+    return static_cast<size_t>(63 - __builtin_clzll(value));
+#endif
+}
+
+//------------------------------------------------------------------------------
+PersistentMemoryManager::PersistentMemoryManager(const std::string & path, size_t size, OpenMode openMode)
+    :
+    m_path(path)
+  , m_base(nullptr)
+  , m_header(nullptr)
+  , m_reopened(false)
+  , m_statistics()
+{
+    size_t fileSize = 0;
+
+    if( openMode != OpenMode::Create )
+    {
+        m_base = static_cast<uint8_t *>(BackingStore::mapFile(path, fileSize, false));
+
+        if( !m_base && (openMode == OpenMode::OpenExisting || openMode == OpenMode::Recover) )
+        {
+            // Error - No heap to open
+            const std::string msg("There is no heap to open at " + path + ".");
+            throw Common::Exception(__FILE__, __LINE__, msg);
+        }
+    }
+
+    if( m_base )
+    {
+        m_header = reinterpret_cast<HeapHeader *>(m_base);
+
+        std::string msg;
+
+        if( fileSize < HEAP_START || m_header->m_magic != MAGIC || m_header->m_size != fileSize )
+        {
+            // Error - Not a heap
+            msg = path + " does not hold a heap.";
+        }
+        else if( m_header->m_version != VERSION )
+        {
+            // Error - Written by another version
+            msg = path + " holds a heap of another version.";
+        }
+        else if( m_header->m_open && openMode != OpenMode::Recover )
+        {
+            // Error - Not closed by the last run, so it may be half way through an update
+            msg = path + " holds a heap that was not closed, it may be damaged.";
+        }
+
+        if( !msg.empty() )
+        {
+            BackingStore::unmapFile(m_base, fileSize);
+            throw Common::Exception(__FILE__, __LINE__, msg);
+        }
+
+        if( m_header->m_open )
+        {
+            try
+            {
+                recoverHeap(path);
+            }
+            catch( ... )
+            {
+                BackingStore::unmapFile(m_base, fileSize);
+                throw;
+            }
+        }
+
+        m_reopened = true;
+    }
+    else
+    {
+        if( size < HEAP_START + MIN_BLOCK_SIZE + sizeof(BlockHeader) )
+        {
+            // Error - Invalid size
+            const std::string msg("Invalid size requested. Size must be large enough to hold the heap header and one block.");
+            throw Common::Exception(__FILE__, __LINE__, msg);
+        }
+
+        fileSize = size;
+        m_base   = static_cast<uint8_t *>(BackingStore::mapFile(path, fileSize, true));
+
+        if( !m_base )
+        {
+            // Error - Could not map the file
+            const std::string msg("Could not create and map " + path + ".");
+            throw Common::Exception(__FILE__, __LINE__, msg);
+        }
+
+        m_header = reinterpret_cast<HeapHeader *>(m_base);
+        memset(m_header, 0, sizeof(HeapHeader));
+        m_header->m_magic   = MAGIC;
+        m_header->m_version = VERSION;
+        m_header->m_size    = fileSize;
+
+        // One free block spans the heap, followed by a header that is always allocated, so that every block has one after it
+        const uint64_t capacity = (fileSize - HEAP_START - sizeof(BlockHeader)) & ~static_cast<uint64_t>(GRANULARITY - 1);
+        getBlock(HEAP_START + capacity)->m_size = USED;
+        pushFreeBlock(HEAP_START, capacity);
+    }
+
+    // Marked open in the file before anything else is written, so that an update never reaches the file under a closed header
+    m_header->m_open = 1;
+
+    if( !BackingStore::flushFile(m_base, sizeof(HeapHeader)) )
+    {
+        // Error - Could not write the header back
+        BackingStore::unmapFile(m_base, fileSize);
+
+        const std::string msg("Could not mark the heap in " + path + " open.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    m_statistics.recordUsedMemory(m_header->m_usedMemory);
+}
+
+//------------------------------------------------------------------------------
+PersistentMemoryManager::~PersistentMemoryManager()
+{
+    closeHeap();
+}
+
+//------------------------------------------------------------------------------
+void PersistentMemoryManager::recoverHeap(const std::string & path)
+{
+    const uint64_t flagBits = GRANULARITY - 1;
+    const uint64_t capacity = (m_header->m_size - HEAP_START - sizeof(BlockHeader)) & ~flagBits;
+    const uint64_t end      = HEAP_START + capacity;
+
+    // A free block that lost its place in a list half way through an update is found again by the walk
+    memset(m_header->m_freeLists, 0, sizeof(m_header->m_freeLists));
+    m_header->m_nonEmptyClasses = 0;
+    m_header->m_usedMemory      = 0;
+    m_header->m_numAllocations  = 0;
+
+    bool     rootFound = !m_header->m_root;
+    uint64_t freeStart = 0;
+    uint64_t freeSize  = 0;     // Free blocks in a row are merged into one
+    uint64_t offset    = HEAP_START;
+
+    while( offset < end )
+    {
+        BlockHeader *  block = getBlock(offset);
+        const uint64_t size  = block->m_size & ~flagBits;
+
+        if( size < MIN_BLOCK_SIZE || size > end - offset )
+        {
+            // Error - The blocks do not tile the heap
+            const std::string msg(path + " holds a heap that was not closed, and is damaged beyond recovery.");
+            throw Common::Exception(__FILE__, __LINE__, msg);
+        }
+
+        if( block->m_size & USED )
+        {
+            if( freeSize )
+            {
+                // Also tells this block that the one before it is free
+                pushFreeBlock(freeStart, freeSize);
+                freeSize = 0;
+            }
+            else
+            {
+                block->m_size |= PREVIOUS_USED;
+            }
+
+            m_header->m_usedMemory += size;
+            ++m_header->m_numAllocations;
+            rootFound = rootFound || m_header->m_root == offset + sizeof(BlockHeader);
+        }
+        else
+        {
+            freeStart = freeSize ? freeStart : offset;
+            freeSize += size;
+        }
+
+        offset += size;
+    }
+
+    if( !rootFound )
+    {
+        // Error - The root is not an allocation
+        const std::string msg(path + " holds a heap that was not closed, and is damaged beyond recovery.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    // The header at the end of the heap is always allocated
+    getBlock(end)->m_size = USED | (freeSize ? 0 : PREVIOUS_USED);
+
+    if( freeSize )
+    {
+        pushFreeBlock(freeStart, freeSize);
+    }
+}
+
+//------------------------------------------------------------------------------
+void PersistentMemoryManager::closeHeap()
+{
+    if( m_base )
+    {
+        // Marked closed only once everything else is in the file, in a second write, as the OS may write pages in any order
+        if( BackingStore::flushFile(m_base, m_header->m_size) )
+        {
+            m_header->m_open = 0;
+            BackingStore::flushFile(m_base, sizeof(HeapHeader));
+        }
+
+        BackingStore::unmapFile(m_base, m_header->m_size);
+
+        m_base   = nullptr;
+        m_header = nullptr;
+    }
+}
+
+//------------------------------------------------------------------------------
+PersistentMemoryManager::BlockHeader * PersistentMemoryManager::getBlock(uint64_t offset) const
+{
+    return reinterpret_cast<BlockHeader *>(m_base + offset);
+}
+
+//------------------------------------------------------------------------------
+PersistentMemoryManager::FreeBlock * PersistentMemoryManager::getFreeBlock(uint64_t offset) const
+{
+    return reinterpret_cast<FreeBlock *>(m_base + offset);
+}
+
+//------------------------------------------------------------------------------
+uint64_t PersistentMemoryManager::getBlockOffset(const void * p) const
+{
+    const uint8_t * address  = static_cast<const uint8_t *>(p);
+    const uint64_t  offset   = static_cast<uint64_t>(address - m_base) - sizeof(BlockHeader);
+    const uint64_t  capacity = (m_header->m_size - HEAP_START - sizeof(BlockHeader)) & ~static_cast<uint64_t>(GRANULARITY - 1);
+
+    if( address < m_base + HEAP_START + sizeof(BlockHeader) || offset >= HEAP_START + capacity || (offset & (GRANULARITY - 1)) ||
+        !(getBlock(offset)->m_size & USED) )
+    {
+        // Error - Not one of our blocks
+        const std::string msg("p was not allocated by this memory manager, or was already freed.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    return offset;
+}
+
+//------------------------------------------------------------------------------
+void PersistentMemoryManager::pushFreeBlock(uint64_t offset, uint64_t size)
+{
+    FreeBlock * freeBlock = getFreeBlock(offset);
+    freeBlock->m_size     = size | PREVIOUS_USED;
+
+    BlockHeader * next = getBlock(offset + size);
+    next->m_previousSize = size;
+    next->m_size        &= ~static_cast<uint64_t>(PREVIOUS_USED);
+
+    const size_t sizeClass = findLastSet(size);
+    freeBlock->m_next      = m_header->m_freeLists[sizeClass];
+    freeBlock->m_previous  = 0;
+
+    if( freeBlock->m_next )
+    {
+        getFreeBlock(freeBlock->m_next)->m_previous = offset;
+    }
+
+    m_header->m_freeLists[sizeClass] = offset;
+    m_header->m_nonEmptyClasses     |= 1ull << sizeClass;
+}
+
+//------------------------------------------------------------------------------
+void PersistentMemoryManager::removeFreeBlock(uint64_t offset)
+{
+    FreeBlock * freeBlock = getFreeBlock(offset);
+
+    if( freeBlock->m_next )
+    {
+        getFreeBlock(freeBlock->m_next)->m_previous = freeBlock->m_previous;
+    }
+
+    if( freeBlock->m_previous )
+    {
+        getFreeBlock(freeBlock->m_previous)->m_next = freeBlock->m_next;
+    }
+    else
+    {
+        const size_t sizeClass = findLastSet(freeBlock->m_size & ~static_cast<uint64_t>(GRANULARITY - 1));
+        m_header->m_freeLists[sizeClass] = freeBlock->m_next;
+
+        if( !freeBlock->m_next )
+        {
+            m_header->m_nonEmptyClasses &= ~(1ull << sizeClass);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+uint64_t PersistentMemoryManager::findFreeBlock(uint64_t size) const
+{
+    // The list of the size class size falls in may also hold smaller blocks, so it is searched,
+    // every block in the lists above is large enough
+    const size_t sizeClass = findLastSet(size);
+
+    if( m_header->m_nonEmptyClasses & (1ull << sizeClass) )
+    {
+        for( uint64_t offset = m_header->m_freeLists[sizeClass]; offset; offset = getFreeBlock(offset)->m_next )
+        {
+            if( (getBlock(offset)->m_size & ~static_cast<uint64_t>(GRANULARITY - 1)) >= size )
+            {
+                return offset;
+            }
+        }
+    }
+
+    const uint64_t classes = sizeClass + 1 < NUM_SIZE_CLASSES ? m_header->m_nonEmptyClasses & (~0ull << (sizeClass + 1)) : 0;
+    return classes ? m_header->m_freeLists[findFirstSet(classes)] : 0;
+}
+
+//------------------------------------------------------------------------------
+uint64_t PersistentMemoryManager::getBlockSize(size_t size)
+{
+    const uint64_t blockSize = ((static_cast<uint64_t>(size) + GRANULARITY - 1) & ~static_cast<uint64_t>(GRANULARITY - 1)) + sizeof(BlockHeader);
+    return blockSize < MIN_BLOCK_SIZE ? MIN_BLOCK_SIZE : blockSize;
+}
+
+//------------------------------------------------------------------------------
+void PersistentMemoryManager::markNextPreviousUsed(uint64_t offset, uint64_t size)
+{
+    getBlock(offset + size)->m_size |= PREVIOUS_USED;
+}
+
+//------------------------------------------------------------------------------
+void * PersistentMemoryManager::allocate(size_t size, uint8_t alignment)
+{
+    if( size <= 0 )
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid size requested. Size must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( !alignment || (alignment & (alignment - 1)) )
+    {
+        // Error - Invalid alignment
+        const std::string msg("Invalid alignment. Alignment must be a power of two.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    // A larger alignment may need room for a free block in front of the allocation
+    const uint64_t flagBits = GRANULARITY - 1;
+    uint64_t       needed   = getBlockSize(size);
+    const uint64_t search   = alignment > GRANULARITY ? needed + alignment + MIN_BLOCK_SIZE : needed;
+    uint64_t       offset   = size < m_header->m_size ? findFreeBlock(search) : 0;
+
+    if( !offset )
+    {
+        m_statistics.recordFailure();
+
+        const std::string msg("No free space large enough to accomodate requested size was found.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    removeFreeBlock(offset);
+
+    uint64_t blockSize    = getBlock(offset)->m_size & ~flagBits;
+    uint64_t previousUsed = PREVIOUS_USED;
+
+    if( alignment > GRANULARITY )
+    {
+        // The file is mapped at a page boundary, so offsets are aligned wherever addresses are
+        const uint64_t start   = offset + sizeof(BlockHeader);
+        uint64_t       padding = ((start + alignment - 1) & ~static_cast<uint64_t>(alignment - 1)) - start;
+
+        if( padding && padding < MIN_BLOCK_SIZE )
+        {
+            padding += (MIN_BLOCK_SIZE - padding + alignment - 1) & ~static_cast<uint64_t>(alignment - 1);
+        }
+
+        if( padding )
+        {
+            pushFreeBlock(offset, padding);
+            offset      += padding;
+            blockSize   -= padding;
+            previousUsed = 0;
+        }
+    }
+
+    BlockHeader * block = getBlock(offset);
+
+    if( blockSize - needed >= MIN_BLOCK_SIZE )
+    {
+        block->m_size = needed | USED | previousUsed;
+        pushFreeBlock(offset + needed, blockSize - needed);
+    }
+    else
+    {
+        needed        = blockSize;
+        block->m_size = blockSize | USED | previousUsed;
+        markNextPreviousUsed(offset, blockSize);
+    }
+
+    m_header->m_usedMemory += needed;
+    ++m_header->m_numAllocations;
+    m_statistics.recordAllocation(size, needed - sizeof(BlockHeader) - size, sizeof(BlockHeader), m_header->m_usedMemory);
+
+    return m_base + offset + sizeof(BlockHeader);
+}
+
+//------------------------------------------------------------------------------
+void PersistentMemoryManager::free(void * p)
+{
+    if( !p )
+    {
+        // Error - p is nullptr
+        const std::string msg("p is nullptr");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    uint64_t            offset = getBlockOffset(p);
+    const BlockHeader * block  = getBlock(offset);
+    uint64_t            size   = block->m_size & ~static_cast<uint64_t>(GRANULARITY - 1);
+
+    m_header->m_usedMemory -= size;
+    --m_header->m_numAllocations;
+    m_statistics.recordFree();
+
+    // Merge with the block after, the header at the end of the heap is always allocated
+    const BlockHeader * next = getBlock(offset + size);
+
+    if( !(next->m_size & USED) )
+    {
+        const uint64_t nextSize = next->m_size & ~static_cast<uint64_t>(GRANULARITY - 1);
+        removeFreeBlock(offset + size);
+        size += nextSize;
+    }
+
+    // And with the block before, whose size is only kept while it is free
+    if( !(block->m_size & PREVIOUS_USED) )
+    {
+        const uint64_t previousSize = block->m_previousSize;
+        offset -= previousSize;
+        size   += previousSize;
+        removeFreeBlock(offset);
+    }
+
+    pushFreeBlock(offset, size);
+}
+
+//------------------------------------------------------------------------------
+void * PersistentMemoryManager::reallocate(void * p, size_t newSize, uint8_t alignment)
+{
+    if( !p )
+    {
+        return allocate(newSize, alignment);
+    }
+
+    if( newSize <= 0 )
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid size requested. Size must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( reinterpret_cast<uintptr_t>(p) % alignment == 0 && tryExpandInPlace(p, newSize) )
+    {
+        return p;
+    }
+
+    const size_t oldSize = getAllocationSize(p);
+    void * newAddress = allocate(newSize, alignment);
+
+    memcpy(newAddress, p, std::min(oldSize, newSize));
+    free(p);
+
+    return newAddress;
+}
+
+//------------------------------------------------------------------------------
+bool PersistentMemoryManager::tryExpandInPlace(void * p, size_t newSize)
+{
+    if( newSize <= 0 || newSize >= m_header->m_size )
+    {
+        return false;
+    }
+
+    const uint64_t flagBits   = GRANULARITY - 1;
+    const uint64_t offset     = getBlockOffset(p);
+    BlockHeader *  block      = getBlock(offset);
+    const uint64_t size       = block->m_size & ~flagBits;
+    const uint64_t flags      = block->m_size & flagBits;
+    uint64_t       needed     = getBlockSize(newSize);
+    const uint64_t nextOffset = offset + size;
+    const BlockHeader * next  = getBlock(nextOffset);
+    const uint64_t nextSize   = next->m_size & USED ? 0 : next->m_size & ~flagBits;
+
+    if( needed <= size )
+    {
+        // Give back the end of the block, together with the free block after it if there is one
+        if( size == needed || (!nextSize && size - needed < MIN_BLOCK_SIZE) )
+        {
+            return true;
+        }
+
+        if( nextSize )
+        {
+            removeFreeBlock(nextOffset);
+        }
+
+        block->m_size = needed | flags;
+        pushFreeBlock(offset + needed, size - needed + nextSize);
+    }
+    else
+    {
+        if( size + nextSize < needed )
+        {
+            return false;
+        }
+
+        removeFreeBlock(nextOffset);
+
+        const uint64_t total = size + nextSize;
+
+        if( total - needed >= MIN_BLOCK_SIZE )
+        {
+            block->m_size = needed | flags;
+            pushFreeBlock(offset + needed, total - needed);
+        }
+        else
+        {
+            needed        = total;
+            block->m_size = total | flags;
+            markNextPreviousUsed(offset, total);
+        }
+    }
+
+    m_header->m_usedMemory = m_header->m_usedMemory - size + needed;
+    m_statistics.recordUsedMemory(m_header->m_usedMemory);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+size_t PersistentMemoryManager::getAllocationSize(const void * p) const
+{
+    return (getBlock(getBlockOffset(p))->m_size & ~static_cast<uint64_t>(GRANULARITY - 1)) - sizeof(BlockHeader);
+}
+
+//------------------------------------------------------------------------------
+void PersistentMemoryManager::setRoot(void * p)
+{
+    m_header->m_root = p ? getBlockOffset(p) + sizeof(BlockHeader) : 0;
+}
+
+//------------------------------------------------------------------------------
+void * PersistentMemoryManager::getRoot() const
+{
+    return m_header->m_root ? m_base + m_header->m_root : nullptr;
+}
+
+//------------------------------------------------------------------------------
+void PersistentMemoryManager::flush()
+{
+    if( !BackingStore::flushFile(m_base, m_header->m_size) )
+    {
+        // Error - Could not write the heap back
+        const std::string msg("Could not write the heap back to " + m_path + ".");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+}
+
+//------------------------------------------------------------------------------
+bool PersistentMemoryManager::wasReopened() const
+{
+    return m_reopened;
+}
+
+//------------------------------------------------------------------------------
+uint8_t * PersistentMemoryManager::getBase() const
+{
+    return m_base;
+}
+
+//------------------------------------------------------------------------------
+MemoryStatistics PersistentMemoryManager::getStatistics() const
+{
+    const uint64_t capacity = (m_header->m_size - HEAP_START - sizeof(BlockHeader)) & ~static_cast<uint64_t>(GRANULARITY - 1);
+
+    MemoryStatistics statistics = m_statistics;
+    statistics.m_capacity       = capacity;
+    statistics.m_usedMemory     = m_header->m_usedMemory;
+    statistics.m_numAllocations = m_header->m_numAllocations;
+
+    size_t numFreeBlocks    = 0;
+    size_t largestFreeBlock = 0;
+
+    for( uint64_t classes = m_header->m_nonEmptyClasses; classes; classes &= classes - 1 )
+    {
+        for( uint64_t offset = m_header->m_freeLists[findFirstSet(classes)]; offset; offset = getFreeBlock(offset)->m_next )
+        {
+            ++numFreeBlocks;
+            largestFreeBlock = std::max<size_t>(largestFreeBlock, getBlock(offset)->m_size & ~static_cast<uint64_t>(GRANULARITY - 1));
+        }
+    }
+
+    statistics.setFreeBlocks(numFreeBlocks, capacity - m_header->m_usedMemory, largestFreeBlock);
+    statistics.m_reservedBytes = m_header->m_size;
+
+    return statistics;
+}
+
+//------------------------------------------------------------------------------
+size_t PersistentMemoryManager::getResidentBytes() const
+{
+    return BackingStore::getResidentBytes(m_base, m_header->m_size);
+}
+
+//------------------------------------------------------------------------------
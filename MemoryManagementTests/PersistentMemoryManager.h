@@ -0,0 +1,154 @@
+#pragma once
+
+// Project Includes
+#include "BackingStore.h"
+#include "IMemoryManager.h"
+
+// Standard Includes
+#include <cstdint>
+#include <string>
+
+//------------------------------------------------------------------------------
+// A heap kept in a memory mapped file, so that a process can close it and a later one map it again and carry on
+// where the first left off, rather than rebuilding its data from scratch
+//
+// Everything the memory manager knows lives in the file: a header at the start holds the free lists and a root,
+// and every link between blocks is an offset from the start of the file rather than an address, so the heap is valid
+// wherever the file is mapped. Data structures kept in the heap must link their objects the same way,
+// with OffsetPointer or offsets from getBase(), and are found again through the root.
+//
+// Blocks carry boundary tags, so a freed block merges with free neighbours on either side at once, and free blocks
+// are kept in one list per power of two size. Allocate takes the first block that fits from the smallest list that
+// may hold one.
+//
+// The header records whether the heap is open, and is written back to the file as soon as the heap is opened.
+// Closing writes everything else back first, and only then marks the heap closed in the file, so a heap marked
+// closed is complete however the process or the machine stopped. A heap left open may have been written half way
+// through an update, so it is refused, unless it is opened to be recovered.
+class PersistentMemoryManager : public IMemoryManager
+{
+protected:
+
+    static const uint64_t MAGIC            = 0x5041454850454d4dull;   // "MMEPHEAP"
+    static const uint32_t VERSION          = 1;
+    static const size_t   NUM_SIZE_CLASSES = 64;
+    static const size_t   GRANULARITY      = 16;    // Every block starts at, and is sized to, a multiple of this
+    static const size_t   USED             = 1;     // Low bits of BlockHeader::m_size
+    static const size_t   PREVIOUS_USED    = 2;
+
+    // Written at the start of the file
+    struct HeapHeader
+    {
+        uint64_t m_magic;
+        uint32_t m_version;
+        uint32_t m_open;                 // Set while a process has the heap mapped
+        uint64_t m_size;                 // Size of the file, in bytes
+        uint64_t m_root;                 // Offset of the root, or 0
+        uint64_t m_usedMemory;           // Bytes in allocated blocks, headers included
+        uint64_t m_numAllocations;
+        uint64_t m_nonEmptyClasses;      // A set bit means the free list of that size class is non-empty
+        uint64_t m_freeLists[NUM_SIZE_CLASSES];   // Offset of the first free block in each size class, or 0
+    };
+
+    // Written before every block, allocated or free
+    struct BlockHeader
+    {
+        uint64_t m_previousSize;         // Size of the block before this one, only kept while that block is free
+        uint64_t m_size;                 // Size of this block, header included, with the USED and PREVIOUS_USED bits
+    };
+
+    struct FreeBlock : BlockHeader
+    {
+        uint64_t m_next;                 // Offsets of the neighbours in the free list, or 0
+        uint64_t m_previous;
+    };
+
+    static const size_t HEAP_START     = (sizeof(HeapHeader) + GRANULARITY - 1) & ~(GRANULARITY - 1);
+    static const size_t MIN_BLOCK_SIZE = sizeof(FreeBlock);
+
+    std::string      m_path;
+    uint8_t *        m_base;             // Start of the mapped file
+    HeapHeader *     m_header;
+    bool             m_reopened;         // Whether the heap was left by an earlier run
+    MemoryStatistics m_statistics;
+
+    BlockHeader * getBlock(uint64_t offset) const;
+    FreeBlock *   getFreeBlock(uint64_t offset) const;
+
+    // Offset of the block holding the allocation at p, throws if p is not an allocation from this heap
+    uint64_t getBlockOffset(const void * p) const;
+
+    // Marks the block at offset free, tells the block after it, and links it into the list of its size class.
+    // The block before it must be allocated.
+    void pushFreeBlock(uint64_t offset, uint64_t size);
+    void removeFreeBlock(uint64_t offset);
+
+    // Size of the block that holds an allocation of size bytes
+    static uint64_t getBlockSize(size_t size);
+
+    // Offset of a free block of at least size bytes, or 0 if there is none
+    uint64_t findFreeBlock(uint64_t size) const;
+
+    // Sets the PREVIOUS_USED bit of the block after the one at offset
+    void markNextPreviousUsed(uint64_t offset, uint64_t size);
+
+    // Walks every block from the start of the heap, merging free neighbours and relinking the free lists,
+    // and recounts the used memory. Throws if the blocks do not tile the heap.
+    void recoverHeap(const std::string & path);
+
+    void closeHeap();
+
+public:
+
+    enum class OpenMode
+    {
+        Create,          // Start an empty heap, replacing any file at the path
+        OpenExisting,    // Map the heap an earlier run left at the path, throws if there is none
+        OpenOrCreate,    // Map the heap an earlier run left at the path, or start an empty one if there is none
+        Recover          // As OpenExisting, but a heap that was not closed is taken as it is, its free lists rebuilt.
+                         // Only the memory manager's own state is repaired, the caller must check the data it holds.
+    };
+
+    // Size is only used when a heap is created, a heap that is reopened keeps the size it was created with
+    PersistentMemoryManager(const std::string & path, size_t size, OpenMode openMode = OpenMode::OpenOrCreate);
+    PersistentMemoryManager(const PersistentMemoryManager &) = delete;
+    PersistentMemoryManager & operator = (const PersistentMemoryManager &) = delete;
+
+    // Closes the heap, leaving the file for the next run. Waits for every modified page to be written back,
+    // then marks the heap closed in the file. If the OS reports an error the heap is left marked open.
+    ~PersistentMemoryManager();
+
+    // Alignment must be a power of two
+    void * allocate(size_t size, uint8_t alignment);
+    using IMemoryManager::free;
+    void free(void * p);
+    void * reallocate(void * p, size_t newSize, uint8_t alignment);
+
+    // Shrinks by splitting off the end of the block, grows by merging with a free block after it
+    bool tryExpandInPlace(void * p, size_t newSize);
+
+    // Number of bytes the caller may use at p, which may be more than was requested
+    size_t getAllocationSize(const void * p) const;
+
+    // The object a later run starts from, which must be an allocation from this heap, or nullptr
+    void setRoot(void * p);
+    void * getRoot() const;
+
+    // Writes every modified page back to the file and waits for it, so that the updates so far survive the machine
+    // stopping. The heap stays marked open, so after a stop it can only be opened with OpenMode::Recover.
+    // Throws if the OS reports an error.
+    void flush();
+
+    // Whether the heap was mapped from a file an earlier run left, rather than created empty
+    bool wasReopened() const;
+
+    // Start of the mapped file, for data structures that link their objects by offset
+    uint8_t * getBase() const;
+
+    MemoryStatistics getStatistics() const;
+
+    // Bytes of the mapped file that are resident in physical memory now, asks the OS about every page
+    size_t getResidentBytes() const;
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,304 @@
+
+// Project Includes
+#include "PoolMemoryManager.h"
+
+// Common Libary
+#include "Exception.h"
+
+// Standard Includes
+#include <memory>
+#include <string>
+
+//------------------------------------------------------------------------------
+PoolMemoryManager::PoolMemoryManager(size_t blockSize, uint8_t alignment, size_t blocksPerSlab, bool canGrow,
+                                     BackingStore::Policy backingStorePolicy)
+    :
+    m_blockSize(blockSize)
+  , m_alignment(alignment)
+  , m_blocksPerSlab(blocksPerSlab)
+  , m_canGrow(canGrow)
+  , m_size(0)
+  , m_usedMemory(0)
+  , m_numAllocations(0)
+  , m_slabs(nullptr)
+  , m_freeBlocks(nullptr)
+  , m_backingStorePolicy(backingStorePolicy)
+  , m_statistics()
+{
+    if( blockSize <= 0 )
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid block size requested. Block size must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( !alignment || (alignment & (alignment - 1)) )
+    {
+        // Error - Invalid alignment
+        const std::string msg("Invalid alignment. Alignment must be a power of two greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( blocksPerSlab <= 0 )
+    {
+        // Error - Invalid number of blocks
+        const std::string msg("Invalid number of blocks per slab requested. Number of blocks must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    // Free blocks store the link to the next free block in place, so every block must be able to hold one
+    if( m_alignment < alignof(FreeBlock) )
+    {
+        m_alignment = alignof(FreeBlock);
+    }
+
+    if( m_blockSize < sizeof(FreeBlock) )
+    {
+        m_blockSize = sizeof(FreeBlock);
+    }
+
+    // Round the block size up so that every block in a slab starts on an aligned address
+    m_blockSize = (m_blockSize + m_alignment - 1) & ~static_cast<size_t>(m_alignment - 1);
+
+    addSlab();
+}
+
+//------------------------------------------------------------------------------
+PoolMemoryManager::~PoolMemoryManager()
+{
+    while( m_slabs != nullptr )
+    {
+        Slab * slab = m_slabs;
+        m_slabs = slab->m_next;
+
+        BackingStore::release(slab, slab->m_size, slab->m_policy);
+    }
+}
+
+//------------------------------------------------------------------------------
+void PoolMemoryManager::addSlab()
+{
+    // Reserve room for the slab link and the worst case adjustment needed to align the first block
+    const size_t slabSize = sizeof(Slab) + m_alignment + m_blockSize * m_blocksPerSlab;
+
+    BackingStore::Policy policy = m_backingStorePolicy;
+    Slab * slab = static_cast<Slab *>(BackingStore::allocate(slabSize, policy));
+
+    if( !slab )
+    {
+        m_statistics.recordFailure();
+
+        // Error - System failed to allocate requested size
+        const std::string msg("System failed to allocate requested size");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    slab->m_next   = m_slabs;
+    slab->m_size   = slabSize;
+    slab->m_policy = policy;
+    m_slabs        = slab;
+    m_size        += slabSize;
+
+    size_t availableSpace = slabSize - sizeof(Slab);
+    void * address        = reinterpret_cast<uint8_t *>(slab) + sizeof(Slab);
+    uint8_t * firstBlock  = static_cast<uint8_t *>(std::align(m_alignment, m_blockSize * m_blocksPerSlab, address, availableSpace));
+
+    // Link the blocks back to front, so that they are handed out in address order
+    for( size_t index = m_blocksPerSlab; index > 0; --index )
+    {
+        FreeBlock * freeBlock = reinterpret_cast<FreeBlock *>(firstBlock + (index - 1) * m_blockSize);
+        freeBlock->m_next = m_freeBlocks;
+        m_freeBlocks = freeBlock;
+    }
+}
+
+//------------------------------------------------------------------------------
+void PoolMemoryManager::grow()
+{
+    if( !m_canGrow )
+    {
+        m_statistics.recordFailure();
+
+        // Error - Pool exhausted
+        const std::string msg("No free blocks remain in the pool.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    addSlab();
+}
+
+//------------------------------------------------------------------------------
+void PoolMemoryManager::validateAllocation(size_t size, uint8_t alignment) const
+{
+    if( size <= 0 || size > m_blockSize )
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid size requested. Size must be greater than zero and no larger than the block size.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( !alignment || m_alignment % alignment )
+    {
+        // Error - Invalid alignment
+        const std::string msg("Invalid alignment. Alignment must be greater than zero and a divisor of the pool alignment.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+}
+
+//------------------------------------------------------------------------------
+void * PoolMemoryManager::allocate(size_t size, uint8_t alignment)
+{
+    validateAllocation(size, alignment);
+    return allocateUnchecked(size, alignment);
+}
+
+//------------------------------------------------------------------------------
+void PoolMemoryManager::free(void * p)
+{
+    if( !p )
+    {
+        // Error - p is nullptr
+        const std::string msg("p is nullptr");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    freeUnchecked(p);
+}
+
+//------------------------------------------------------------------------------
+void PoolMemoryManager::free(void * p, size_t size, uint8_t alignment)
+{
+    if( !p )
+    {
+        // Error - p is nullptr
+        const std::string msg("p is nullptr");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    freeUnchecked(p, size, alignment);
+}
+
+//------------------------------------------------------------------------------
+void PoolMemoryManager::allocateBatch(size_t count, size_t size, uint8_t alignment, void ** out)
+{
+    validateAllocation(size, alignment);
+
+    for( size_t index = 0; index < count; ++index )
+    {
+        if( !m_freeBlocks )
+        {
+            try
+            {
+                grow();
+            }
+            catch( const Common::Exception & )
+            {
+                // Put back what was taken so far, so that the batch fails as a whole
+                for( size_t taken = index; taken > 0; --taken )
+                {
+                    FreeBlock * freeBlock = static_cast<FreeBlock *>(out[taken - 1]);
+                    freeBlock->m_next = m_freeBlocks;
+                    m_freeBlocks = freeBlock;
+                }
+
+                throw;
+            }
+        }
+
+        out[index]   = m_freeBlocks;
+        m_freeBlocks = m_freeBlocks->m_next;
+    }
+
+    m_usedMemory     += m_blockSize * count;
+    m_numAllocations += count;
+    m_statistics.recordAllocations(count, size, (m_blockSize - size) * count, 0, m_usedMemory);
+}
+
+//------------------------------------------------------------------------------
+void PoolMemoryManager::freeBatch(void ** ptrs, size_t count)
+{
+    for( size_t index = 0; index < count; ++index )
+    {
+        if( !ptrs[index] )
+        {
+            // Error - p is nullptr
+            const std::string msg("p is nullptr");
+            throw Common::Exception(__FILE__, __LINE__, msg);
+        }
+    }
+
+    for( size_t index = 0; index < count; ++index )
+    {
+        FreeBlock * freeBlock = static_cast<FreeBlock *>(ptrs[index]);
+        freeBlock->m_next = m_freeBlocks;
+        m_freeBlocks = freeBlock;
+    }
+
+    m_usedMemory     -= m_blockSize * count;
+    m_numAllocations -= count;
+    m_statistics.recordFree(count);
+}
+
+//------------------------------------------------------------------------------
+void PoolMemoryManager::freeBatch(void ** ptrs, size_t count, size_t, uint8_t)
+{
+    // Every block is the same size, so there is nothing for the size to tell us
+    freeBatch(ptrs, count);
+}
+
+//------------------------------------------------------------------------------
+void * PoolMemoryManager::reallocate(void * p, size_t newSize, uint8_t alignment)
+{
+    if( !p )
+    {
+        return allocate(newSize, alignment);
+    }
+
+    if( newSize <= 0 || newSize > m_blockSize )
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid size requested. Size must be greater than zero and no larger than the block size.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( !alignment || m_alignment % alignment )
+    {
+        // Error - Invalid alignment
+        const std::string msg("Invalid alignment. Alignment must be greater than zero and a divisor of the pool alignment.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    // Every block is already as large as any allocation can be
+    return p;
+}
+
+//------------------------------------------------------------------------------
+bool PoolMemoryManager::tryExpandInPlace(void *, size_t newSize)
+{
+    // Every block is the same size, so any size up to it fits
+    return newSize > 0 && newSize <= m_blockSize;
+}
+
+//------------------------------------------------------------------------------
+MemoryStatistics PoolMemoryManager::getStatistics() const
+{
+    MemoryStatistics statistics = m_statistics;
+    statistics.m_capacity       = m_size;
+    statistics.m_usedMemory     = m_usedMemory;
+    statistics.m_numAllocations = m_numAllocations;
+
+    // Every block is interchangeable, so the pool cannot fragment
+    size_t numBlocks = 0;
+
+    for( const Slab * slab = m_slabs; slab != nullptr; slab = slab->m_next )
+    {
+        numBlocks += m_blocksPerSlab;
+    }
+
+    statistics.m_numFreeBlocks    = numBlocks - m_numAllocations;
+    statistics.m_largestFreeBlock = statistics.m_numFreeBlocks ? m_blockSize : 0;
+
+    return statistics;
+}
+
+//------------------------------------------------------------------------------
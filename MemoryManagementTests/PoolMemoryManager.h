@@ -0,0 +1,120 @@
+#pragma once
+
+// Project Includes
+#include "BackingStore.h"
+#include "IMemoryManager.h"
+
+// Standard Includes
+#include <cstdint>
+
+//------------------------------------------------------------------------------
+// A pool of fixed size blocks, all with the same alignment
+//
+// Block size and alignment are chosen at construction. Free blocks are kept in an intrusive singly linked list,
+// so there is no per-block header and both allocate() and free() are O(1).
+// If growth is enabled, a new slab of blocks is requested from the system whenever the pool runs dry.
+class PoolMemoryManager : public IMemoryManager
+{
+protected:
+
+    struct FreeBlock
+    {
+        FreeBlock * m_next;
+    };
+
+    struct Slab
+    {
+        Slab *               m_next;
+        size_t               m_size;     // Size of the slab, including this header, in bytes
+        BackingStore::Policy m_policy;   // Backing store policy actually used for this slab
+    };
+
+    size_t      m_blockSize;       // Size of each block, in bytes, after rounding for alignment and the free list link
+    uint8_t     m_alignment;       // Alignment of every block
+    size_t      m_blocksPerSlab;   // Number of blocks carved out of each slab
+    bool        m_canGrow;         // Whether additional slabs may be allocated once the first is exhausted
+    size_t      m_size;            // Total size of allocated memory across all slabs, in bytes
+    size_t      m_usedMemory;      // Number of bytes used
+    size_t      m_numAllocations;  // Number of caller allocations that have occured
+    Slab *      m_slabs;           // Most recently allocated slab, each slab links to the one before it
+    FreeBlock * m_freeBlocks;
+
+    BackingStore::Policy m_backingStorePolicy;
+    MemoryStatistics     m_statistics;
+
+    void addSlab();
+    void grow();
+    void validateAllocation(size_t size, uint8_t alignment) const;
+
+public:
+
+    PoolMemoryManager(size_t blockSize, uint8_t alignment, size_t blocksPerSlab, bool canGrow = false,
+                      BackingStore::Policy backingStorePolicy = BackingStore::Policy::Malloc);
+    PoolMemoryManager(const PoolMemoryManager &) = delete;
+    PoolMemoryManager & operator = (const PoolMemoryManager &) = delete;
+    ~PoolMemoryManager();
+
+    void * allocate(size_t size, uint8_t alignment);
+    void free(void * p);
+    void free(void * p, size_t size, uint8_t alignment);
+
+    // Pops or pushes a whole batch of blocks, with one set of counter updates
+    void allocateBatch(size_t count, size_t size, uint8_t alignment, void ** out);
+    void freeBatch(void ** ptrs, size_t count);
+    void freeBatch(void ** ptrs, size_t count, size_t size, uint8_t alignment);
+
+    void * reallocate(void * p, size_t newSize, uint8_t alignment);
+    bool tryExpandInPlace(void * p, size_t newSize);
+    MemoryStatistics getStatistics() const;
+
+    // Fast paths without argument validation, visible here so that statically dispatched callers can inline them
+    // The caller guarantees that alignment is valid for this pool and that p came from this pool. Size is still checked
+    // against the block size, it is a single comparison and a caller asking for several objects at once would otherwise
+    // be handed a block too small for them.
+    void * allocateUnchecked(size_t size, uint8_t alignment);
+    void freeUnchecked(void * p);
+    void freeUnchecked(void * p, size_t size, uint8_t alignment);
+};
+
+//------------------------------------------------------------------------------
+inline void * PoolMemoryManager::allocateUnchecked(size_t size, uint8_t alignment)
+{
+    if( size > m_blockSize )
+    {
+        // Throws with the reason
+        validateAllocation(size, alignment);
+    }
+
+    if( !m_freeBlocks )
+    {
+        grow();
+    }
+
+    FreeBlock * freeBlock = m_freeBlocks;
+    m_freeBlocks = freeBlock->m_next;
+
+    m_usedMemory += m_blockSize;
+    ++m_numAllocations;
+    m_statistics.recordAllocation(size, m_blockSize - size, 0, m_usedMemory);
+
+    return freeBlock;
+}
+
+//------------------------------------------------------------------------------
+inline void PoolMemoryManager::freeUnchecked(void * p)
+{
+    FreeBlock * freeBlock = static_cast<FreeBlock *>(p);
+    freeBlock->m_next = m_freeBlocks;
+    m_freeBlocks = freeBlock;
+
+    m_usedMemory -= m_blockSize;
+    --m_numAllocations;
+    m_statistics.recordFree();
+}
+
+//------------------------------------------------------------------------------
+inline void PoolMemoryManager::freeUnchecked(void * p, size_t, uint8_t)
+{
+    // Every block is the same size, so there is nothing for the size to tell us
+    freeUnchecked(p);
+}
@@ -0,0 +1,388 @@
+
+// Project Includes
+#include "RingBufferMemoryManager.h"
+
+// Common Libary
+#include "Exception.h"
+
+// Standard Includes
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+//------------------------------------------------------------------------------
+RingBufferMemoryManager::RingBufferMemoryManager(size_t size, ThreadingPolicy threadingPolicy, BackingStore::Policy backingStorePolicy)
+    :
+    m_size(0)
+  , m_memory(nullptr)
+  , m_start(nullptr)
+  , m_capacity(size & ~(BLOCK_ALIGNMENT - 1))
+  , m_threadingPolicy(threadingPolicy)
+  , m_backingStorePolicy(backingStorePolicy)
+  , m_head(0)
+  , m_headOffset(0)
+  , m_cachedTail(0)
+  , m_lastBlock(nullptr)
+  , m_statistics()
+  , m_tail(0)
+  , m_tailOffset(0)
+  , m_cachedHead(0)
+  , m_numFrees(0)
+{
+    if( m_capacity < 2 * BLOCK_ALIGNMENT )
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid size requested. Size must be large enough to hold at least one block.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    // Leave room to align the start of the ring
+    m_size   = m_capacity + BLOCK_ALIGNMENT;
+    m_memory = BackingStore::allocate(m_size, m_backingStorePolicy);
+
+    if( !m_memory )
+    {
+        // Error - System failed to allocate requested size
+        const std::string msg("System failed to allocate requested size");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    m_start = reinterpret_cast<uint8_t *>((reinterpret_cast<uintptr_t>(m_memory) + BLOCK_ALIGNMENT - 1) & ~static_cast<uintptr_t>(BLOCK_ALIGNMENT - 1));
+}
+
+//------------------------------------------------------------------------------
+RingBufferMemoryManager::~RingBufferMemoryManager()
+{
+    BackingStore::release(m_memory, m_size, m_backingStorePolicy);
+}
+
+//------------------------------------------------------------------------------
+uint64_t RingBufferMemoryManager::loadHead() const
+{
+    // Acquire, so that the headers of every block before the head are visible to the freeing thread
+    if( m_threadingPolicy == ThreadingPolicy::SingleProducerSingleConsumer )
+    {
+        return m_head.load(std::memory_order_acquire);
+    }
+
+    return m_head.load(std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+uint64_t RingBufferMemoryManager::loadTail() const
+{
+    // Acquire, so that the freeing thread is done with every block before the tail before it is reused
+    if( m_threadingPolicy == ThreadingPolicy::SingleProducerSingleConsumer )
+    {
+        return m_tail.load(std::memory_order_acquire);
+    }
+
+    return m_tail.load(std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+void RingBufferMemoryManager::publishHead(uint64_t head)
+{
+    if( m_threadingPolicy == ThreadingPolicy::SingleProducerSingleConsumer )
+    {
+        m_head.store(head, std::memory_order_release);
+        return;
+    }
+
+    m_head.store(head, std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+void RingBufferMemoryManager::publishTail(uint64_t tail)
+{
+    if( m_threadingPolicy == ThreadingPolicy::SingleProducerSingleConsumer )
+    {
+        m_tail.store(tail, std::memory_order_release);
+        return;
+    }
+
+    m_tail.store(tail, std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+void * RingBufferMemoryManager::allocate(size_t size, uint8_t alignment)
+{
+    if( size <= 0 )
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid size requested. Size must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( !alignment || (alignment & (alignment - 1)) )
+    {
+        // Error - Invalid alignment
+        const std::string msg("Invalid alignment. Alignment must be a power of two.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    void * p = tryAllocate(size, alignment);
+
+    if( !p )
+    {
+        m_statistics.recordFailure();
+
+        // Error - Could not fit the desired number of bytes before the oldest block still in use
+        const std::string msg("Could not fit the desired number of bytes aligned by the specified alignment into the free space of the ring.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    return p;
+}
+
+//------------------------------------------------------------------------------
+void * RingBufferMemoryManager::tryAllocate(size_t size, uint8_t alignment)
+{
+    const size_t blockSize = sizeof(BlockHeader) + ((size + BLOCK_ALIGNMENT - 1) & ~(BLOCK_ALIGNMENT - 1));
+
+    // Block starts are aligned to BLOCK_ALIGNMENT, so larger alignments need a multiple of it in front of the block
+    auto getPadding = [&](size_t offset)
+    {
+        const uintptr_t misalignment = reinterpret_cast<uintptr_t>(m_start + offset + sizeof(BlockHeader)) & (alignment - 1);
+        return misalignment ? alignment - misalignment : 0;
+    };
+
+    size_t offset  = m_headOffset;
+    size_t padding = getPadding(offset);
+    size_t skipped = 0;
+
+    if( offset + padding + blockSize > m_capacity )
+    {
+        // Skip the rest of the buffer and start again from the beginning
+        skipped = m_capacity - offset;
+        padding = getPadding(0);
+
+        if( padding + blockSize > m_capacity )
+        {
+            return nullptr;
+        }
+    }
+
+    const uint64_t head      = m_head.load(std::memory_order_relaxed);
+    const size_t   totalSize = skipped + padding + blockSize;
+
+    if( head + totalSize - m_cachedTail > m_capacity )
+    {
+        m_cachedTail = loadTail();
+
+        if( head + totalSize - m_cachedTail > m_capacity )
+        {
+            return nullptr;
+        }
+    }
+
+    if( skipped )
+    {
+        BlockHeader * skippedBlock = reinterpret_cast<BlockHeader *>(m_start + offset);
+        skippedBlock->m_size  = skipped;
+        skippedBlock->m_freed = true;
+        offset = 0;
+    }
+
+    if( padding )
+    {
+        BlockHeader * paddingBlock = reinterpret_cast<BlockHeader *>(m_start + offset);
+        paddingBlock->m_size  = padding;
+        paddingBlock->m_freed = true;
+        offset += padding;
+    }
+
+    BlockHeader * header = reinterpret_cast<BlockHeader *>(m_start + offset);
+    header->m_size  = blockSize;
+    header->m_freed = false;
+
+    offset += blockSize;
+    m_headOffset = offset == m_capacity ? 0 : offset;
+    m_lastBlock  = header;
+
+    // Publish the head only once every header before it is written
+    publishHead(head + totalSize);
+
+    m_statistics.recordAllocation(size, totalSize - size - sizeof(BlockHeader), sizeof(BlockHeader), head + totalSize - m_cachedTail);
+
+    return header + 1;
+}
+
+//------------------------------------------------------------------------------
+RingBufferMemoryManager::BlockHeader * RingBufferMemoryManager::getHeader(void * p) const
+{
+    uint8_t * address = static_cast<uint8_t *>(p);
+
+    if( address < m_start + sizeof(BlockHeader) || address >= m_start + m_capacity )
+    {
+        // Error - p is not inside the ring
+        const std::string msg("p was not allocated by this memory manager.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    BlockHeader * header = reinterpret_cast<BlockHeader *>(address) - 1;
+
+    if( header->m_freed )
+    {
+        // Error - Double free
+        const std::string msg("p was already freed.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    return header;
+}
+
+//------------------------------------------------------------------------------
+void RingBufferMemoryManager::free(void * p)
+{
+    if( !p )
+    {
+        // Error - p is nullptr
+        const std::string msg("p is nullptr");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    getHeader(p)->m_freed = true;
+
+    // Only this thread writes the count, so there is no need for an atomic increment
+    m_numFrees.store(m_numFrees.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    releaseFreedBlocks();
+}
+
+//------------------------------------------------------------------------------
+void RingBufferMemoryManager::free(void * p, size_t, uint8_t)
+{
+    // The header already knows the size of every block
+    free(p);
+}
+
+//------------------------------------------------------------------------------
+void RingBufferMemoryManager::releaseFreedBlocks()
+{
+    const uint64_t startTail = m_tail.load(std::memory_order_relaxed);
+    uint64_t       tail      = startTail;
+
+    // Stop at the head, which is only read again once the tail has caught up with it.
+    // A block grown in place may take the tail past the head as last read.
+    while( tail < m_cachedHead || tail < (m_cachedHead = loadHead()) )
+    {
+        const BlockHeader * header = reinterpret_cast<const BlockHeader *>(m_start + m_tailOffset);
+
+        if( !header->m_freed )
+        {
+            break;
+        }
+
+        tail         += header->m_size;
+        m_tailOffset += header->m_size;
+
+        if( m_tailOffset == m_capacity )
+        {
+            m_tailOffset = 0;
+        }
+    }
+
+    if( tail != startTail )
+    {
+        publishTail(tail);
+    }
+}
+
+//------------------------------------------------------------------------------
+void * RingBufferMemoryManager::reallocate(void * p, size_t newSize, uint8_t alignment)
+{
+    if( !p )
+    {
+        return allocate(newSize, alignment);
+    }
+
+    if( newSize <= 0 )
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid size requested. Size must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( reinterpret_cast<uintptr_t>(p) % alignment == 0 && tryExpandInPlace(p, newSize) )
+    {
+        return p;
+    }
+
+    const size_t oldSize = getHeader(p)->m_size - sizeof(BlockHeader);
+    void * newAddress = allocate(newSize, alignment);
+
+    memcpy(newAddress, p, std::min(oldSize, newSize));
+    free(p);
+
+    return newAddress;
+}
+
+//------------------------------------------------------------------------------
+bool RingBufferMemoryManager::tryExpandInPlace(void * p, size_t newSize)
+{
+    BlockHeader * header = getHeader(p);
+
+    if( header != m_lastBlock || newSize <= 0 )
+    {
+        return false;
+    }
+
+    const size_t    newBlockSize = sizeof(BlockHeader) + ((newSize + BLOCK_ALIGNMENT - 1) & ~(BLOCK_ALIGNMENT - 1));
+    const size_t    blockOffset  = reinterpret_cast<uint8_t *>(header) - m_start;
+    const uint64_t  head         = m_head.load(std::memory_order_relaxed);
+
+    // The block can grow up to the end of the buffer, as long as that does not reach the tail
+    if( newBlockSize > header->m_size )
+    {
+        const size_t growth = newBlockSize - header->m_size;
+
+        if( blockOffset + newBlockSize > m_capacity )
+        {
+            return false;
+        }
+
+        if( head + growth - m_cachedTail > m_capacity )
+        {
+            m_cachedTail = loadTail();
+
+            if( head + growth - m_cachedTail > m_capacity )
+            {
+                return false;
+            }
+        }
+    }
+
+    const uint64_t newHead = head - header->m_size + newBlockSize;
+
+    header->m_size = newBlockSize;
+    m_headOffset   = blockOffset + newBlockSize == m_capacity ? 0 : blockOffset + newBlockSize;
+
+    // A shrinking block moves the head back, past where the freeing side may have seen it
+    m_cachedHead = std::min(m_cachedHead, newHead);
+
+    publishHead(newHead);
+    m_statistics.recordUsedMemory(newHead - m_cachedTail);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+MemoryStatistics RingBufferMemoryManager::getStatistics() const
+{
+    MemoryStatistics statistics = m_statistics;
+
+    const size_t numFrees = m_numFrees.load(std::memory_order_relaxed);
+
+    statistics.m_capacity       = m_capacity;
+    statistics.m_usedMemory     = m_head.load(std::memory_order_relaxed) - loadTail();
+    statistics.m_numAllocations = statistics.m_totalAllocations - numFrees;
+    statistics.recordFree(numFrees);
+
+    // The free space is the one run from the head to the tail, split in two where it wraps
+    const size_t freeBytes = m_capacity - statistics.m_usedMemory;
+    const size_t headRun   = std::min(freeBytes, m_capacity - m_headOffset);
+    statistics.setFreeBlocks(freeBytes ? (headRun < freeBytes ? 2 : 1) : 0, freeBytes, std::max(headRun, freeBytes - headRun));
+
+    return statistics;
+}
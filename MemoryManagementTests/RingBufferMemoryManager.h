@@ -0,0 +1,102 @@
+#pragma once
+
+// Project Includes
+#include "BackingStore.h"
+#include "IMemoryManager.h"
+
+// Standard Includes
+#include <atomic>
+#include <cstdint>
+
+//------------------------------------------------------------------------------
+// Allocations are taken in order from a fixed buffer, wrapping around to the start when they reach the end,
+// and memory is given back in the same order it was allocated, for messages that are freed in roughly the order they arrive.
+//
+// Every block starts with a small header. free() marks the block, then moves the tail past every marked block at the
+// oldest end, so a block freed out of order is only given back once every block allocated before it has been freed too.
+// An allocation that does not fit before the end of the buffer leaves the rest of it as a skipped block.
+//
+// In the SingleProducerSingleConsumer mode one thread may allocate while another frees, without any lock:
+// the allocating thread owns the head, the freeing thread owns the tail, and each only reads the other's with acquire.
+class RingBufferMemoryManager : public IMemoryManager
+{
+public:
+
+    // Which threads may call the memory manager
+    enum class ThreadingPolicy
+    {
+        SingleThreaded,                 // One thread at a time does everything
+        SingleProducerSingleConsumer    // One thread allocates while one other thread frees
+    };
+
+protected:
+
+    struct BlockHeader
+    {
+        size_t m_size;     // Bytes from this header to the next one, a multiple of BLOCK_ALIGNMENT
+        size_t m_freed;    // Set once the block is freed, skipped and alignment blocks are created freed
+    };
+
+    // Every block starts on a BLOCK_ALIGNMENT boundary, so the bytes left before the end of the buffer can always hold a header
+    static const size_t BLOCK_ALIGNMENT = sizeof(BlockHeader);
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    size_t    m_size;          // Size of the memory requested from the backing store, in bytes
+    void *    m_memory;        // Memory requested from the backing store
+    uint8_t * m_start;         // First address of the ring, aligned to BLOCK_ALIGNMENT
+    size_t    m_capacity;      // Bytes in the ring, a multiple of BLOCK_ALIGNMENT
+
+    ThreadingPolicy      m_threadingPolicy;
+    BackingStore::Policy m_backingStorePolicy;
+
+    // Owned by the allocating thread, on a cache line of their own so that the freeing thread does not share it
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> m_head;     // Bytes ever allocated, skipped bytes included
+    size_t           m_headOffset;                             // Offset of the next block from m_start
+    uint64_t         m_cachedTail;                             // Tail as last read, refreshed only when the ring looks full
+    BlockHeader *    m_lastBlock;                              // Most recent allocation, which may be resized in place
+    MemoryStatistics m_statistics;
+
+    // Owned by the freeing thread
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> m_tail;     // Bytes ever given back
+    size_t                m_tailOffset;                        // Offset of the oldest block from m_start
+    uint64_t              m_cachedHead;                        // Head as last read, refreshed only when the tail catches up
+    std::atomic<size_t>   m_numFrees;                          // Read by getStatistics()
+
+    uint64_t loadHead() const;
+    uint64_t loadTail() const;
+    void publishHead(uint64_t head);
+    void publishTail(uint64_t tail);
+
+    BlockHeader * getHeader(void * p) const;
+
+    // Moves the tail past every freed block at the oldest end of the ring
+    void releaseFreedBlocks();
+
+public:
+
+    // Size is rounded down to a whole number of BLOCK_ALIGNMENT bytes
+    RingBufferMemoryManager(size_t size, ThreadingPolicy threadingPolicy = ThreadingPolicy::SingleThreaded,
+                            BackingStore::Policy backingStorePolicy = BackingStore::Policy::Malloc);
+    RingBufferMemoryManager(const RingBufferMemoryManager &) = delete;
+    RingBufferMemoryManager & operator = (const RingBufferMemoryManager &) = delete;
+    ~RingBufferMemoryManager();
+
+    // Alignment must be a power of two. Throws if the ring has no room until older blocks are freed.
+    void * allocate(size_t size, uint8_t alignment);
+
+    // Returns nullptr, without recording a failure, if the ring has no room, so that a producer can wait for its consumer
+    void * tryAllocate(size_t size, uint8_t alignment);
+
+    void free(void * p);
+    void free(void * p, size_t size, uint8_t alignment);
+
+    // Resizing touches both ends of the ring, so in the SingleProducerSingleConsumer mode these may only be called
+    // while the freeing thread is not using the memory manager. Only the most recent allocation can change size in place.
+    void * reallocate(void * p, size_t newSize, uint8_t alignment);
+    bool tryExpandInPlace(void * p, size_t newSize);
+
+    // In the SingleProducerSingleConsumer mode, call from the allocating thread
+    MemoryStatistics getStatistics() const;
+};
+
+//------------------------------------------------------------------------------
@@ -7,10 +7,11 @@
 #include "Exception.h"
 
 // Standard Includes
+#include <memory>
 #include <string>
 
 //------------------------------------------------------------------------------
-StackMemoryManager::StackMemoryManager(size_t size)
+StackMemoryManager::StackMemoryManager(size_t size, BackingStore::Policy backingStorePolicy, HeaderPolicy headerPolicy)
     :
     m_size(size)
   , m_start(nullptr)
@@ -18,6 +19,11 @@ StackMemoryManager::StackMemoryManager(size_t size)
   , m_previousPosition(nullptr)
   , m_usedMemory(0)
   , m_numAllocations(0)
+  , m_topPosition(nullptr)
+  , m_numTopAllocations(0)
+  , m_headerPolicy(headerPolicy)
+  , m_backingStorePolicy(backingStorePolicy)
+  , m_statistics()
 {
     if (size <= 0)
     {
@@ -26,7 +32,7 @@ StackMemoryManager::StackMemoryManager(size_t size)
         throw Common::Exception(__FILE__, __LINE__, msg);
     }
 
-    m_start = ::malloc(size);
+    m_start = BackingStore::allocate(size, m_backingStorePolicy);
 
     if (!m_start)
     {
@@ -36,12 +42,35 @@ StackMemoryManager::StackMemoryManager(size_t size)
     }
 
     m_currentPosition = m_start;
+    m_topPosition     = static_cast<uint8_t *>(m_start) + size;
+
+    if (m_headerPolicy == HeaderPolicy::Headerless)
+    {
+        // Headerless allocations are found from their size alone, so both stacks must start on the granularity
+        const uintptr_t top = reinterpret_cast<uintptr_t>(m_topPosition) & ~static_cast<uintptr_t>(HEADERLESS_GRANULARITY - 1);
+        m_topPosition = reinterpret_cast<void *>(top);
+
+        if (reinterpret_cast<uintptr_t>(m_start) % HEADERLESS_GRANULARITY)
+        {
+            BackingStore::release(m_start, m_size, m_backingStorePolicy);
+
+            // Error - System allocated memory without enough alignment
+            const std::string msg("System allocated memory that is not aligned for headerless allocations");
+            throw Common::Exception(__FILE__, __LINE__, msg);
+        }
+    }
 }
 
 //------------------------------------------------------------------------------
 StackMemoryManager::~StackMemoryManager()
 {
-    ::free(m_start);
+    BackingStore::release(m_start, m_size, m_backingStorePolicy);
+}
+
+//------------------------------------------------------------------------------
+size_t StackMemoryManager::getHeaderlessSize(size_t size)
+{
+    return (size + HEADERLESS_GRANULARITY - 1) & ~(HEADERLESS_GRANULARITY - 1);
 }
 
 //------------------------------------------------------------------------------
@@ -61,11 +90,56 @@ void * StackMemoryManager::allocate(size_t size, uint8_t alignment)
         throw Common::Exception(__FILE__, __LINE__, msg);
     }
 
-    size_t availableSpace = m_size - m_usedMemory;
-    void * alignedAddress = std::align(alignment, size, m_currentPosition, availableSpace);
+    if (m_headerPolicy == HeaderPolicy::Headerless && alignment > HEADERLESS_GRANULARITY)
+    {
+        // Error - Invalid alignment
+        const std::string msg("Invalid alignment. Headerless allocations cannot be aligned beyond the headerless granularity.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    return allocateUnchecked(size, alignment);
+}
+
+//------------------------------------------------------------------------------
+void * StackMemoryManager::allocateUnchecked(size_t size, uint8_t alignment)
+{
+    if (m_headerPolicy == HeaderPolicy::Headerless)
+    {
+        // Every headerless allocation is a whole number of granules, so the current position is always aligned
+        const size_t blockSize = getHeaderlessSize(size);
+
+        if (blockSize > static_cast<size_t>(static_cast<uint8_t *>(m_topPosition) - static_cast<uint8_t *>(m_currentPosition)))
+        {
+            m_statistics.recordFailure();
+
+            // Error - Could not fit the desired number of bytes into the available memory space
+            const std::string msg(" Could not fit the desired number of bytes into the available memory space.");
+            throw Common::Exception(__FILE__, __LINE__, msg);
+        }
+
+        void * address = m_currentPosition;
+
+        m_previousPosition = address;
+        m_currentPosition  = static_cast<uint8_t *>(address) + blockSize;
+
+        m_usedMemory += blockSize;
+        ++m_numAllocations;
+        m_statistics.recordAllocation(size, blockSize - size, 0, m_usedMemory);
+
+        return address;
+    }
+
+    // The bottom stack may grow up to wherever the top stack currently ends
+    // std::align moves the pointer it is given, so give it a copy, to keep the alignment padding accounted for
+    const size_t freeSpace = static_cast<uint8_t *>(m_topPosition) - static_cast<uint8_t *>(m_currentPosition);
+    size_t availableSpace = freeSpace;
+    void * currentPosition = m_currentPosition;
+    void * alignedAddress = std::align(alignment, size, currentPosition, availableSpace);
     
     if (!alignedAddress)
     {
+        m_statistics.recordFailure();
+
         // Error - Could not fit the desired number of bytes aligned by the specified alignment into the available memory space
         const std::string msg(" Could not fit the desired number of bytes aligned by the specified alignment into the available memory space.");
         throw Common::Exception(__FILE__, __LINE__, msg);
@@ -88,8 +162,10 @@ void * StackMemoryManager::allocate(size_t size, uint8_t alignment)
         }
     }
 
-    if (m_usedMemory + adjustment + size > m_size)
+    if (adjustment + size > freeSpace)
     {
+        m_statistics.recordFailure();
+
         // Error - Could not fit the desired number of bytes aligned by the specified alignment into the available memory space, with header
         const std::string msg(" Could not fit the desired number of bytes aligned by the specified alignment into the available memory space, with header");
         throw Common::Exception(__FILE__, __LINE__, msg);
@@ -108,13 +184,148 @@ void * StackMemoryManager::allocate(size_t size, uint8_t alignment)
 
     m_usedMemory += size + adjustment;
     ++m_numAllocations;
+    m_statistics.recordAllocation(size, adjustment - sizeof(AllocationHeader), sizeof(AllocationHeader), m_usedMemory);
 
     return alignedAddress;
 }
 
+//------------------------------------------------------------------------------
+void * StackMemoryManager::allocate(size_t size, uint8_t alignment, StackEnd end)
+{
+    if (end == StackEnd::Bottom)
+    {
+        return allocate(size, alignment);
+    }
+
+    return allocateTop(size, alignment);
+}
+
+//------------------------------------------------------------------------------
+void * StackMemoryManager::allocateTop(size_t size, uint8_t alignment)
+{
+    if (size <= 0)
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid size requested. Size must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if (!alignment)
+    {
+        // Error - Invalid alignment
+        const std::string msg("Invalid alignment. Alignment must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if (m_headerPolicy == HeaderPolicy::Headerless)
+    {
+        if (alignment > HEADERLESS_GRANULARITY)
+        {
+            // Error - Invalid alignment
+            const std::string msg("Invalid alignment. Headerless allocations cannot be aligned beyond the headerless granularity.");
+            throw Common::Exception(__FILE__, __LINE__, msg);
+        }
+
+        const size_t blockSize = getHeaderlessSize(size);
+
+        if (blockSize > static_cast<size_t>(static_cast<uint8_t *>(m_topPosition) - static_cast<uint8_t *>(m_currentPosition)))
+        {
+            m_statistics.recordFailure();
+
+            // Error - Could not fit the desired number of bytes into the available memory space
+            const std::string msg(" Could not fit the desired number of bytes into the available memory space.");
+            throw Common::Exception(__FILE__, __LINE__, msg);
+        }
+
+        m_topPosition = static_cast<uint8_t *>(m_topPosition) - blockSize;
+
+        m_usedMemory += blockSize;
+        ++m_numAllocations;
+        ++m_numTopAllocations;
+        m_statistics.recordAllocation(size, blockSize - size, 0, m_usedMemory);
+
+        return m_topPosition;
+    }
+
+    const uintptr_t bottom = reinterpret_cast<uintptr_t>(m_currentPosition);
+    const uintptr_t top    = reinterpret_cast<uintptr_t>(m_topPosition);
+
+    if (size + sizeof(AllocationHeader) > top - bottom)
+    {
+        m_statistics.recordFailure();
+
+        // Error - Could not fit the desired number of bytes into the available memory space, with header
+        const std::string msg(" Could not fit the desired number of bytes aligned by the specified alignment into the available memory space, with header");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    // The allocation ends at the current top, so align downward, and put the header below it
+    const uintptr_t alignedAddress = (top - size) / alignment * alignment;
+    const uintptr_t blockStart     = (alignedAddress - sizeof(AllocationHeader)) / alignof(AllocationHeader) * alignof(AllocationHeader);
+
+    if (alignedAddress < bottom + sizeof(AllocationHeader) || blockStart < bottom)
+    {
+        m_statistics.recordFailure();
+
+        // Error - Could not fit the desired number of bytes aligned by the specified alignment into the available memory space, with header
+        const std::string msg(" Could not fit the desired number of bytes aligned by the specified alignment into the available memory space, with header");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    // Add Allocation Header
+    AllocationHeader * header = reinterpret_cast<AllocationHeader *>(alignedAddress - sizeof(AllocationHeader));
+
+    header->m_adjustment      = static_cast<uint8_t>(alignedAddress - blockStart);
+    header->m_previousAddress = m_topPosition;
+
+    m_topPosition = reinterpret_cast<void *>(blockStart);
+
+    m_usedMemory += top - blockStart;
+    ++m_numAllocations;
+    ++m_numTopAllocations;
+    m_statistics.recordAllocation(size, top - blockStart - size - sizeof(AllocationHeader), sizeof(AllocationHeader), m_usedMemory);
+
+    return reinterpret_cast<void *>(alignedAddress);
+}
+
+//------------------------------------------------------------------------------
+void StackMemoryManager::freeTop(void * p)
+{
+    // Get the header in the bytes preceding the pointer
+    AllocationHeader * header = reinterpret_cast<AllocationHeader *>(static_cast<uint8_t *>(p) - sizeof(AllocationHeader));
+
+    if (static_cast<uint8_t *>(p) - header->m_adjustment != m_topPosition)
+    {
+        // Error - Can only free in LIFO order
+        const std::string msg(" Can only free in LIFO order");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    m_usedMemory -= static_cast<uint8_t *>(header->m_previousAddress) - static_cast<uint8_t *>(m_topPosition);
+    m_topPosition = header->m_previousAddress;
+
+    --m_numAllocations;
+    --m_numTopAllocations;
+    m_statistics.recordFree();
+}
+
 //------------------------------------------------------------------------------
 void StackMemoryManager::free(void * p)
 {
+    if (m_headerPolicy == HeaderPolicy::Headerless)
+    {
+        // Error - No header to find the previous position from
+        const std::string msg(" Headerless allocations can only be freed with the size and alignment they were allocated with.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if (p > m_topPosition && p < static_cast<uint8_t *>(m_start) + m_size)
+    {
+        // Belongs to the top stack
+        freeTop(p);
+        return;
+    }
+
     if (p != m_previousPosition)
     {
         // Error - Can only free in LIFO order
@@ -130,4 +341,123 @@ void StackMemoryManager::free(void * p)
     m_previousPosition = header->m_previousAddress;
 
     --m_numAllocations;
+    m_statistics.recordFree();
+}
+
+//------------------------------------------------------------------------------
+void StackMemoryManager::free(void * p, size_t size, uint8_t)
+{
+    if (m_headerPolicy == HeaderPolicy::Headers)
+    {
+        free(p);
+        return;
+    }
+
+    const size_t blockSize = getHeaderlessSize(size);
+
+    if (p >= m_topPosition && p < static_cast<uint8_t *>(m_start) + m_size)
+    {
+        // Belongs to the top stack
+        if (p != m_topPosition)
+        {
+            // Error - Can only free in LIFO order
+            const std::string msg(" Can only free in LIFO order");
+            throw Common::Exception(__FILE__, __LINE__, msg);
+        }
+
+        m_topPosition = static_cast<uint8_t *>(p) + blockSize;
+
+        m_usedMemory -= blockSize;
+        --m_numAllocations;
+        --m_numTopAllocations;
+        m_statistics.recordFree();
+        return;
+    }
+
+    if (static_cast<uint8_t *>(p) + blockSize != m_currentPosition)
+    {
+        // Error - Can only free in LIFO order
+        const std::string msg(" Can only free in LIFO order");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    // Headerless allocations do not remember the one before them, so the previous position is lost
+    m_currentPosition  = p;
+    m_previousPosition = nullptr;
+
+    m_usedMemory -= blockSize;
+    --m_numAllocations;
+    m_statistics.recordFree();
+}
+
+//------------------------------------------------------------------------------
+StackMemoryManager::Marker StackMemoryManager::getMarker(StackEnd end) const
+{
+    Marker marker;
+    marker.m_end = end;
+
+    if (end == StackEnd::Bottom)
+    {
+        marker.m_position         = m_currentPosition;
+        marker.m_previousPosition = m_previousPosition;
+        marker.m_numAllocations   = m_numAllocations - m_numTopAllocations;
+    }
+    else
+    {
+        marker.m_position         = m_topPosition;
+        marker.m_previousPosition = nullptr;
+        marker.m_numAllocations   = m_numTopAllocations;
+    }
+
+    return marker;
+}
+
+//------------------------------------------------------------------------------
+void StackMemoryManager::rewindTo(const Marker & marker)
+{
+    if (marker.m_end == StackEnd::Bottom)
+    {
+        if (marker.m_position < m_start || marker.m_position > m_currentPosition)
+        {
+            // Error - Marker is not below the current position
+            const std::string msg(" Invalid marker. Can only rewind the bottom stack to a marker below its current position.");
+            throw Common::Exception(__FILE__, __LINE__, msg);
+        }
+
+        m_statistics.recordFree(m_numAllocations - m_numTopAllocations - marker.m_numAllocations);
+
+        m_usedMemory     -= static_cast<uint8_t *>(m_currentPosition) - static_cast<uint8_t *>(marker.m_position);
+        m_numAllocations -= m_numAllocations - m_numTopAllocations - marker.m_numAllocations;
+
+        m_currentPosition  = marker.m_position;
+        m_previousPosition = marker.m_previousPosition;
+    }
+    else
+    {
+        if (marker.m_position < m_topPosition || marker.m_position > static_cast<uint8_t *>(m_start) + m_size)
+        {
+            // Error - Marker is not above the current position
+            const std::string msg(" Invalid marker. Can only rewind the top stack to a marker above its current position.");
+            throw Common::Exception(__FILE__, __LINE__, msg);
+        }
+
+        m_statistics.recordFree(m_numTopAllocations - marker.m_numAllocations);
+
+        m_usedMemory     -= static_cast<uint8_t *>(marker.m_position) - static_cast<uint8_t *>(m_topPosition);
+        m_numAllocations -= m_numTopAllocations - marker.m_numAllocations;
+
+        m_numTopAllocations = marker.m_numAllocations;
+        m_topPosition       = marker.m_position;
+    }
+}
+
+//------------------------------------------------------------------------------
+MemoryStatistics StackMemoryManager::getStatistics() const
+{
+    MemoryStatistics statistics = m_statistics;
+    statistics.m_capacity       = m_size;
+    statistics.m_usedMemory     = m_usedMemory;
+    statistics.m_numAllocations = m_numAllocations;
+
+    return statistics;
 }
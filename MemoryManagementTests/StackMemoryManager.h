@@ -1,18 +1,56 @@
 #pragma once
 
+// Project Includes
+#include "BackingStore.h"
+#include "MemoryStatistics.h"
+
 // Standard Includes
 #include <cstdint>
 
 //------------------------------------------------------------------------------
 // Memory must be deallocated in inverse order it was allocated!
 // So if you allocate object A and then object B you must free object B memory before you can free object A memory.
+//
+// There are two independent stacks sharing the same memory, one grows up from the bottom and one grows down from the top.
+// The LIFO rule applies to each stack separately, so long lived and short lived allocations can share one buffer.
+//
+// In headerless mode every allocation is rounded to HEADERLESS_GRANULARITY bytes and must be freed with its size,
+// which is then enough to find where the allocation started.
 class StackMemoryManager
 {
+public:
+
+    // Which of the two stacks to use
+    enum class StackEnd
+    {
+        Bottom,   // Grows up from the first address in allocated memory
+        Top       // Grows down from the last address in allocated memory
+    };
+
+    // Whether allocations carry a header recording where they started
+    enum class HeaderPolicy
+    {
+        Headers,      // free(p) finds the previous position from the header in front of p
+        Headerless    // No header, the sized free(p, size, alignment) finds the previous position from the size instead
+    };
+
+    // Size and alignment that every headerless allocation is rounded to
+    static const size_t HEADERLESS_GRANULARITY = 16;
+
+    // A position in one of the stacks that can be rewound to later
+    struct Marker
+    {
+        StackEnd m_end;
+        void *   m_position;          // First free byte for the bottom stack, last used byte for the top stack
+        void *   m_previousPosition;  // Most recent allocation in the bottom stack, unused for the top stack
+        size_t   m_numAllocations;    // Number of caller allocations in this stack at the time the marker was taken
+    };
+
 protected:
 
     struct AllocationHeader
     {
-        void *  m_previousAddress;
+        void *  m_previousAddress;    // Previous allocation for the bottom stack, previous top position for the top stack
         uint8_t m_adjustment;
     };
 
@@ -22,14 +60,37 @@ protected:
     size_t m_numAllocations;    // Number of caller allocations that have occured
     void * m_previousPosition; 
     void * m_currentPosition;
+    void * m_topPosition;       // Lowest address used by the top stack
+    size_t m_numTopAllocations; // Number of caller allocations that have occured in the top stack
+
+    HeaderPolicy         m_headerPolicy;
+    BackingStore::Policy m_backingStorePolicy;
+    MemoryStatistics     m_statistics;
+
+    static size_t getHeaderlessSize(size_t size);
+
+    void * allocateTop(size_t size, uint8_t alignment);
+    void freeTop(void * p);
 
 public:
 
-    StackMemoryManager(size_t size);
+    StackMemoryManager(size_t size, BackingStore::Policy backingStorePolicy = BackingStore::Policy::Malloc,
+                       HeaderPolicy headerPolicy = HeaderPolicy::Headers);
     StackMemoryManager(const StackMemoryManager &) = delete;
     StackMemoryManager & operator = (const StackMemoryManager &) = delete;
     ~StackMemoryManager();
 
     void * allocate(size_t size, uint8_t alignment);
+    void * allocate(size_t size, uint8_t alignment, StackEnd end);
     void free(void * p);
+    void free(void * p, size_t size, uint8_t alignment);
+
+    Marker getMarker(StackEnd end = StackEnd::Bottom) const;
+    void rewindTo(const Marker & marker);
+
+    MemoryStatistics getStatistics() const;
+
+    // Allocate from the bottom stack without argument validation, for statically dispatched callers
+    // The caller guarantees that size and alignment are greater than zero
+    void * allocateUnchecked(size_t size, uint8_t alignment);
 };
@@ -0,0 +1,188 @@
+#pragma once
+
+// Project Includes
+#include "FreeListMemoryManager.h"
+#include "LinearMemoryManager.h"
+#include "PoolMemoryManager.h"
+#include "StackMemoryManager.h"
+
+// Common Library
+#include "Exception.h"
+
+// Standard Includes
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+//------------------------------------------------------------------------------
+/// <summary>
+/// Validation policy that goes through each memory manager's checked allocate() and free()
+///
+/// Calls are qualified with the memory manager type, so they are bound at compile time rather than through the vtable.
+/// </summary>
+struct CheckedValidation
+{
+    template <class MemoryManager>
+    static void * allocate(MemoryManager & memoryManager, size_t size, uint8_t alignment)
+    {
+        return memoryManager.MemoryManager::allocate(size, alignment);
+    }
+
+    template <class MemoryManager>
+    static void free(MemoryManager & memoryManager, void * p, size_t size, uint8_t alignment)
+    {
+        memoryManager.MemoryManager::free(p, size, alignment);
+    }
+
+    static void free(LinearMemoryManager &, void *, size_t, uint8_t)
+    {
+        // Linear memory is only given back by clear() or rewindTo()
+    }
+};
+
+//------------------------------------------------------------------------------
+/// <summary>
+/// Validation policy that goes straight to each memory manager's unchecked fast path
+///
+/// Size and alignment are trusted, so the argument checks and the exceptions they construct drop out of the call.
+/// Running out of memory is still reported by the memory manager.
+/// </summary>
+struct UncheckedValidation
+{
+    template <class MemoryManager>
+    static void * allocate(MemoryManager & memoryManager, size_t size, uint8_t alignment)
+    {
+        return memoryManager.allocateUnchecked(size, alignment);
+    }
+
+    template <class MemoryManager>
+    static void free(MemoryManager & memoryManager, void * p, size_t size, uint8_t alignment)
+    {
+        memoryManager.freeUnchecked(p, size, alignment);
+    }
+
+    static void free(LinearMemoryManager &, void *, size_t, uint8_t)
+    {
+        // Linear memory is only given back by clear() or rewindTo()
+    }
+
+    static void free(StackMemoryManager & memoryManager, void * p, size_t size, uint8_t alignment)
+    {
+        // Stack order is still enforced, as getting it wrong would corrupt the stack
+        memoryManager.free(p, size, alignment);
+    }
+};
+
+//------------------------------------------------------------------------------
+/// <summary>
+/// Validation policy used when none is given
+///
+/// Debug builds keep the checks, release builds drop them from the hot path.
+/// </summary>
+#ifdef NDEBUG
+typedef UncheckedValidation DefaultValidation;
+#else
+typedef CheckedValidation DefaultValidation;
+#endif
+
+//------------------------------------------------------------------------------
+/// <summary>
+/// A STL compliant allocator that is bound to a concrete memory manager type at compile time
+///
+/// Unlike CustomAllocator, which calls through IMemoryManager, every call here is statically dispatched, so the
+/// Linear and Pool fast paths can be inlined into the container. Alignment is a template parameter, defaulting to
+/// alignof(T), and is checked at compile time. It is a lower bound, every allocation is aligned to the larger of it
+/// and alignof(T), so rebinding keeps it unchanged and rebinding back gives the original allocator type.
+/// The Validation policy chooses between the checked and unchecked entry points of the memory manager.
+///
+/// Allocators compare equal when they share a memory manager, and the memory manager travels with the
+/// container on copy, move and swap, so memory is always given back to the memory manager it came from.
+/// </summary>
+template <class T, class MemoryManager, class Validation = DefaultValidation, size_t Alignment = alignof(T)>
+class StaticAllocator
+{
+    static_assert(Alignment && !(Alignment & (Alignment - 1)), "Alignment must be a power of two greater than zero.");
+
+protected:
+
+    // The alignment every allocation is made with
+    static const size_t ALIGNMENT = Alignment > alignof(T) ? Alignment : alignof(T);
+
+    static_assert(ALIGNMENT <= UINT8_MAX, "Alignment must fit in the alignment argument of the memory managers.");
+
+    MemoryManager * m_memoryManager;
+
+public:
+
+    template <class U, class M, class V, size_t A> friend class StaticAllocator;
+    typedef T value_type;
+
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap            = std::true_type;
+    using is_always_equal                        = std::false_type;
+
+    // Rebound allocators keep the requested alignment as their lower bound
+    template <class U>
+    struct rebind
+    {
+        typedef StaticAllocator<U, MemoryManager, Validation, Alignment> other;
+    };
+
+    /// Allocator does not take ownership of memory manager, which must outlive every container using it
+    explicit StaticAllocator(MemoryManager * memoryManager)
+        :
+        m_memoryManager(memoryManager)
+    {
+    }
+
+    template <class U, size_t A>
+    StaticAllocator(const StaticAllocator<U, MemoryManager, Validation, A> & rhs)
+        :
+        m_memoryManager(rhs.m_memoryManager)
+    {
+    }
+
+    template <class U, size_t A>
+    bool operator == (const StaticAllocator<U, MemoryManager, Validation, A> & rhs) const
+    {
+        return m_memoryManager == rhs.m_memoryManager;
+    }
+
+    template <class U, size_t A>
+    bool operator != (const StaticAllocator<U, MemoryManager, Validation, A> & rhs) const
+    {
+        return m_memoryManager != rhs.m_memoryManager;
+    }
+
+    MemoryManager * getMemoryManager() const
+    {
+        return m_memoryManager;
+    }
+
+    T * allocate(size_t n)
+    {
+        if (n > static_cast<size_t>(-1) / sizeof(T))
+        {
+            throw std::bad_array_new_length();
+        }
+
+        const size_t numBytes = n * sizeof(T);
+
+        try
+        {
+            return static_cast<T *>(Validation::allocate(*m_memoryManager, numBytes ? numBytes : 1, static_cast<uint8_t>(ALIGNMENT)));
+        }
+        catch (const Common::Exception &)
+        {
+            throw std::bad_alloc();
+        }
+    }
+
+    void deallocate(T * p, size_t n)
+    {
+        const size_t numBytes = n * sizeof(T);
+        Validation::free(*m_memoryManager, p, numBytes ? numBytes : 1, static_cast<uint8_t>(ALIGNMENT));
+    }
+};
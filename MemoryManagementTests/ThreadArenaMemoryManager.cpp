@@ -0,0 +1,418 @@
+
+// Project Includes
+#include "ThreadArenaMemoryManager.h"
+
+// Common Libary
+#include "Exception.h"
+
+// Standard Includes
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+//------------------------------------------------------------------------------
+static std::atomic<uint64_t> g_nextManagerId(1);
+
+// Managers that have not been destroyed yet, so that a thread that exits after a manager never touches its arenas
+static std::mutex                   g_liveManagersMutex;
+static std::unordered_set<uint64_t> g_liveManagers;
+
+// The calling thread's arenas, keyed by manager id, which are given up for adoption when the thread exits
+// Ids are never reused, so entries left behind by a destroyed manager are never found again
+struct ThreadArenas
+{
+    struct Entry
+    {
+        void *              m_arena;
+        std::atomic<bool> * m_owned;
+    };
+
+    std::unordered_map<uint64_t, Entry> m_arenas;
+
+    ~ThreadArenas();
+};
+
+static thread_local ThreadArenas t_threadArenas;
+static thread_local bool         t_threadArenasReleased = false;
+static thread_local uint64_t     t_lastManagerId        = 0;
+static thread_local void *       t_lastArena            = nullptr;
+
+//------------------------------------------------------------------------------
+ThreadArenas::~ThreadArenas()
+{
+    // Frees made later in this thread's exit are pushed onto the remote free lists like any other thread's
+    t_threadArenasReleased = true;
+    t_lastManagerId        = 0;
+    t_lastArena            = nullptr;
+
+    std::lock_guard<std::mutex> lock(g_liveManagersMutex);
+
+    for( const auto & arena : m_arenas )
+    {
+        if( g_liveManagers.count(arena.first) )
+        {
+            // Release, so that the adopting thread sees everything this thread did to the arena
+            arena.second.m_owned->store(false, std::memory_order_release);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// Only the owning thread writes to its counters, so a plain load and store is enough
+static void increment(std::atomic<size_t> & counter, size_t amount)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+ThreadArenaMemoryManager::Arena::Arena(size_t size, BackingStore::Policy backingStorePolicy)
+    :
+    m_memoryManager(size, FreeListMemoryManager::AllocationPolicy::SegregatedFit, backingStorePolicy)
+  , m_owned(true)
+  , m_numRemoteFrees(0)
+  , m_remoteFrees(nullptr)
+{
+}
+
+//------------------------------------------------------------------------------
+ThreadArenaMemoryManager::ThreadArenaMemoryManager(size_t arenaSize, BackingStore::Policy backingStorePolicy)
+    :
+    m_arenaSize(arenaSize)
+  , m_backingStorePolicy(backingStorePolicy)
+  , m_id(g_nextManagerId++)
+{
+    if( m_arenaSize <= sizeof(AllocationHeader) )
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid size requested. Size must be large enough to hold at least one block.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    std::lock_guard<std::mutex> lock(g_liveManagersMutex);
+    g_liveManagers.insert(m_id);
+}
+
+//------------------------------------------------------------------------------
+ThreadArenaMemoryManager::~ThreadArenaMemoryManager()
+{
+    {
+        std::lock_guard<std::mutex> lock(g_liveManagersMutex);
+        g_liveManagers.erase(m_id);
+    }
+
+    // Blocks still on the remote free lists go with their arenas
+    for( Arena * arena : m_arenas )
+    {
+        delete arena;
+    }
+}
+
+//------------------------------------------------------------------------------
+ThreadArenaMemoryManager::Arena * ThreadArenaMemoryManager::findArena() const
+{
+    if( t_lastManagerId == m_id )
+    {
+        return static_cast<Arena *>(t_lastArena);
+    }
+
+    if( t_threadArenasReleased )
+    {
+        return nullptr;
+    }
+
+    const auto found = t_threadArenas.m_arenas.find(m_id);
+
+    if( found == t_threadArenas.m_arenas.end() )
+    {
+        return nullptr;
+    }
+
+    t_lastManagerId = m_id;
+    t_lastArena     = found->second.m_arena;
+
+    return static_cast<Arena *>(t_lastArena);
+}
+
+//------------------------------------------------------------------------------
+ThreadArenaMemoryManager::Arena * ThreadArenaMemoryManager::getArena()
+{
+    if( Arena * arena = findArena() )
+    {
+        return arena;
+    }
+
+    if( t_threadArenasReleased )
+    {
+        // Error - An arena taken now could never be given up again
+        const std::string msg("Cannot allocate on a thread whose arenas have already been given up at thread exit.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    Arena * arena = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Adopt the arena of a thread that has exited, if there is one
+        for( Arena * candidate : m_arenas )
+        {
+            bool owned = false;
+
+            if( candidate->m_owned.compare_exchange_strong(owned, true, std::memory_order_acquire) )
+            {
+                arena = candidate;
+                break;
+            }
+        }
+
+        if( !arena )
+        {
+            m_arenas.reserve(m_arenas.size() + 1);
+            arena = new Arena(m_arenaSize, m_backingStorePolicy);
+            m_arenas.push_back(arena);
+        }
+    }
+
+    t_threadArenas.m_arenas[m_id] = { arena, &arena->m_owned };
+    t_lastManagerId = m_id;
+    t_lastArena     = arena;
+
+    return arena;
+}
+
+//------------------------------------------------------------------------------
+void ThreadArenaMemoryManager::drainRemoteFrees(Arena & arena)
+{
+    // Taking the whole list at once means no block is ever taken off it while another thread pushes, so there is no ABA.
+    // Acquire, so that the links written by the pushing threads are visible.
+    void * block = arena.m_remoteFrees.exchange(nullptr, std::memory_order_acquire);
+
+    void * batch[DRAIN_BATCH_SIZE];
+    size_t count      = 0;
+    size_t numDrained = 0;
+
+    while( block )
+    {
+        void * next = *static_cast<void **>(block);
+        batch[count++] = block;
+
+        if( count == DRAIN_BATCH_SIZE )
+        {
+            arena.m_memoryManager.freeBatch(batch, count);
+            numDrained += count;
+            count = 0;
+        }
+
+        block = next;
+    }
+
+    if( count )
+    {
+        arena.m_memoryManager.freeBatch(batch, count);
+        numDrained += count;
+    }
+
+    increment(arena.m_numRemoteFrees, numDrained);
+}
+
+//------------------------------------------------------------------------------
+void * ThreadArenaMemoryManager::allocate(size_t size, uint8_t alignment)
+{
+    if( size <= 0 )
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid size requested. Size must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( !alignment )
+    {
+        // Error - Invalid alignment
+        const std::string msg("Invalid alignment. Alignment must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    Arena * arena = getArena();
+
+    // A relaxed look first, so that an empty list costs no more than a load
+    if( arena->m_remoteFrees.load(std::memory_order_relaxed) )
+    {
+        drainRemoteFrees(*arena);
+    }
+
+    // Offset the block far enough to hold our header while keeping the requested alignment
+    const size_t offset = alignment > sizeof(AllocationHeader) ? alignment : sizeof(AllocationHeader);
+    uint8_t * block = static_cast<uint8_t *>(arena->m_memoryManager.allocate(size + offset, static_cast<uint8_t>(offset)));
+
+    AllocationHeader * header = reinterpret_cast<AllocationHeader *>(block + offset - sizeof(AllocationHeader));
+    header->m_arena  = arena;
+    header->m_offset = offset;
+
+    return block + offset;
+}
+
+//------------------------------------------------------------------------------
+void ThreadArenaMemoryManager::free(void * p)
+{
+    if( !p )
+    {
+        // Error - p is nullptr
+        const std::string msg("p is nullptr");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    const AllocationHeader * header = reinterpret_cast<AllocationHeader *>(static_cast<uint8_t *>(p) - sizeof(AllocationHeader));
+    Arena * arena = header->m_arena;
+    void *  block = static_cast<uint8_t *>(p) - header->m_offset;
+
+    if( arena == findArena() )
+    {
+        arena->m_memoryManager.free(block);
+        return;
+    }
+
+    // Another thread's arena. The link overwrites the start of the block, which may be the header, so it is read first.
+    // Release, so that the owner sees the link, and everything this thread wrote to the block, when it drains.
+    void * head = arena->m_remoteFrees.load(std::memory_order_relaxed);
+
+    do
+    {
+        *static_cast<void **>(block) = head;
+    }
+    while( !arena->m_remoteFrees.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed) );
+}
+
+//------------------------------------------------------------------------------
+void * ThreadArenaMemoryManager::reallocate(void * p, size_t newSize, uint8_t alignment)
+{
+    if( !p )
+    {
+        return allocate(newSize, alignment);
+    }
+
+    if( !alignment )
+    {
+        // Error - Invalid alignment
+        const std::string msg("Invalid alignment. Alignment must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( reinterpret_cast<uintptr_t>(p) % alignment == 0 && tryExpandInPlace(p, newSize) )
+    {
+        return p;
+    }
+
+    // Move it, into the calling thread's arena
+    const size_t oldSize = getAllocationSize(p);
+    void * newP = allocate(newSize, alignment);
+
+    std::memcpy(newP, p, std::min(oldSize, newSize));
+    free(p);
+
+    return newP;
+}
+
+//------------------------------------------------------------------------------
+bool ThreadArenaMemoryManager::tryExpandInPlace(void * p, size_t newSize)
+{
+    if( !p )
+    {
+        // Error - p is nullptr
+        const std::string msg("p is nullptr");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    const AllocationHeader * header = reinterpret_cast<AllocationHeader *>(static_cast<uint8_t *>(p) - sizeof(AllocationHeader));
+
+    // Another thread's arena can only be changed by that thread
+    if( header->m_arena != findArena() )
+    {
+        return false;
+    }
+
+    return header->m_arena->m_memoryManager.tryExpandInPlace(static_cast<uint8_t *>(p) - header->m_offset, newSize + header->m_offset);
+}
+
+//------------------------------------------------------------------------------
+size_t ThreadArenaMemoryManager::getAllocationSize(const void * p) const
+{
+    // Only reads the headers of p, so it is safe from any thread
+    const AllocationHeader * header = reinterpret_cast<const AllocationHeader *>(static_cast<const uint8_t *>(p) - sizeof(AllocationHeader));
+    return header->m_arena->m_memoryManager.getAllocationSize(static_cast<const uint8_t *>(p) - header->m_offset) - header->m_offset;
+}
+
+//------------------------------------------------------------------------------
+size_t ThreadArenaMemoryManager::getRemoteFreeCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    size_t numRemoteFrees = 0;
+
+    for( const Arena * arena : m_arenas )
+    {
+        numRemoteFrees += arena->m_numRemoteFrees.load(std::memory_order_relaxed);
+    }
+
+    return numRemoteFrees;
+}
+
+//------------------------------------------------------------------------------
+MemoryStatistics ThreadArenaMemoryManager::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    MemoryStatistics statistics;
+    size_t freeBytes = 0;
+
+    for( const Arena * arena : m_arenas )
+    {
+        const MemoryStatistics arenaStatistics = arena->m_memoryManager.getStatistics();
+
+        statistics.m_capacity          += arenaStatistics.m_capacity;
+        statistics.m_usedMemory        += arenaStatistics.m_usedMemory;
+        statistics.m_peakUsedMemory    += arenaStatistics.m_peakUsedMemory;
+        statistics.m_numAllocations    += arenaStatistics.m_numAllocations;
+        statistics.m_totalAllocations  += arenaStatistics.m_totalAllocations;
+        statistics.m_totalFrees        += arenaStatistics.m_totalFrees;
+        statistics.m_failedAllocations += arenaStatistics.m_failedAllocations;
+        statistics.m_requestedBytes    += arenaStatistics.m_requestedBytes;
+        statistics.m_paddingBytes      += arenaStatistics.m_paddingBytes;
+        statistics.m_overheadBytes     += arenaStatistics.m_overheadBytes;
+        statistics.m_numFreeBlocks     += arenaStatistics.m_numFreeBlocks;
+        statistics.m_largestFreeBlock   = std::max(statistics.m_largestFreeBlock, arenaStatistics.m_largestFreeBlock);
+        statistics.m_reservedBytes     += arenaStatistics.m_reservedBytes;
+        statistics.m_purgedBytes       += arenaStatistics.m_purgedBytes;
+
+        for( size_t sizeClass = 0; sizeClass < MemoryStatistics::NUM_SIZE_CLASSES; ++sizeClass )
+        {
+            statistics.m_sizeClassHistogram[sizeClass] += arenaStatistics.m_sizeClassHistogram[sizeClass];
+        }
+
+        freeBytes += arenaStatistics.m_capacity - arenaStatistics.m_usedMemory;
+    }
+
+    // The peak is the sum of each arena's peak, which may not all have happened at once
+    // Requested bytes include the header in front of every block, which the arenas cannot tell apart
+    statistics.setFreeBlocks(statistics.m_numFreeBlocks, freeBytes, statistics.m_largestFreeBlock);
+
+    return statistics;
+}
+
+//------------------------------------------------------------------------------
+size_t ThreadArenaMemoryManager::getResidentBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    size_t residentBytes = 0;
+
+    for( const Arena * arena : m_arenas )
+    {
+        residentBytes += arena->m_memoryManager.getResidentBytes();
+    }
+
+    return residentBytes;
+}
+
+//------------------------------------------------------------------------------
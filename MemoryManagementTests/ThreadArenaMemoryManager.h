@@ -0,0 +1,94 @@
+#pragma once
+
+// Project Includes
+#include "BackingStore.h"
+#include "FreeListMemoryManager.h"
+#include "IMemoryManager.h"
+
+// Standard Includes
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// A thread safe memory manager made of one segregated fit FreeListMemoryManager arena per thread,
+// for objects that are often freed on a different thread than the one that allocated them
+//
+// Each thread allocates from its own arena, and frees blocks back to it, without taking a lock.
+// A block freed on any other thread is pushed onto its arena's remote free list, a lock free stack that any number of
+// threads may push onto while only the owning thread takes from it. The owner takes the whole list with one exchange
+// at the start of its next allocate(), and gives the blocks back to its arena in batches.
+//
+// When a thread exits, its arena is adopted by the next thread that needs one, along with any blocks freed into it since.
+// Blocks waiting on a remote free list count as used.
+class ThreadArenaMemoryManager : public IMemoryManager
+{
+protected:
+
+    static const size_t CACHE_LINE_SIZE  = 64;
+    static const size_t DRAIN_BATCH_SIZE = 64;
+
+    struct Arena
+    {
+        FreeListMemoryManager m_memoryManager;
+        std::atomic<bool>     m_owned;            // Cleared when the owning thread exits, set again by the thread that adopts it
+        std::atomic<size_t>   m_numRemoteFrees;   // Blocks drained from the remote free list, only written by the owning thread
+
+        // Pushed onto by other threads, so it has a cache line of its own
+        alignas(CACHE_LINE_SIZE) std::atomic<void *> m_remoteFrees;   // Blocks freed by other threads, linked through their first word
+
+        Arena(size_t size, BackingStore::Policy backingStorePolicy);
+    };
+
+    // Written before every block handed out, so that free() knows which arena it came from
+    struct AllocationHeader
+    {
+        Arena * m_arena;
+        size_t  m_offset;     // Distance from the start of the block given by the arena
+    };
+
+    size_t               m_arenaSize;
+    BackingStore::Policy m_backingStorePolicy;
+    mutable std::mutex   m_mutex;     // Guards m_arenas
+    std::vector<Arena *> m_arenas;    // Every arena created for this manager
+    uint64_t             m_id;        // Unique for the life of the process, used to find this manager's arena for each thread
+
+    // The calling thread's arena, adopting or creating one if it has none
+    Arena * getArena();
+
+    // The calling thread's arena, or nullptr if it has none
+    Arena * findArena() const;
+
+    void drainRemoteFrees(Arena & arena);
+
+public:
+
+    // Every arena is arenaSize bytes, taken from the backing store when a thread first allocates
+    ThreadArenaMemoryManager(size_t arenaSize, BackingStore::Policy backingStorePolicy = BackingStore::Policy::Malloc);
+    ThreadArenaMemoryManager(const ThreadArenaMemoryManager &) = delete;
+    ThreadArenaMemoryManager & operator = (const ThreadArenaMemoryManager &) = delete;
+    ~ThreadArenaMemoryManager();
+
+    void * allocate(size_t size, uint8_t alignment);
+    using IMemoryManager::free;
+    void free(void * p);
+    void * reallocate(void * p, size_t newSize, uint8_t alignment);
+
+    // Only blocks from the calling thread's own arena can be resized in place
+    bool tryExpandInPlace(void * p, size_t newSize);
+
+    // Number of bytes the caller may use at p, which may be more than was requested
+    size_t getAllocationSize(const void * p) const;
+
+    // Blocks that were freed on a thread other than their arena's owner, counted as the owner drains them
+    size_t getRemoteFreeCount() const;
+
+    // Sums every arena, so it may only be called while no other thread is using the memory manager
+    MemoryStatistics getStatistics() const;
+
+    // Sums every arena's resident bytes, asks the OS about every page
+    size_t getResidentBytes() const;
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,566 @@
+
+// Project Includes
+#include "ThreadCachingMemoryManager.h"
+
+// Common Libary
+#include "Exception.h"
+
+// Standard Includes
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+//------------------------------------------------------------------------------
+static std::atomic<uint64_t> g_nextManagerId(1);
+
+// Managers that have not been destroyed yet, so that a thread that exits after a manager never touches its caches
+static std::mutex g_liveManagersMutex;
+
+//------------------------------------------------------------------------------
+// Created on first use and never destroyed, as the global memory manager creates a manager during static
+// initialization, and threads may exit after static destruction
+static std::unordered_map<uint64_t, ThreadCachingMemoryManager *> & getLiveManagers()
+{
+    static std::unordered_map<uint64_t, ThreadCachingMemoryManager *> * liveManagers = new std::unordered_map<uint64_t, ThreadCachingMemoryManager *>();
+    return *liveManagers;
+}
+
+// The calling thread's caches, keyed by manager id, which are given back when the thread exits
+// Ids are never reused, so entries left behind by a destroyed manager are never found again
+struct ThreadCaches
+{
+    std::unordered_map<uint64_t, void *> m_threadCaches;
+
+    ~ThreadCaches();
+};
+
+static thread_local ThreadCaches t_threadCaches;
+static thread_local bool         t_threadCachesReleased = false;
+static thread_local uint64_t     t_lastManagerId        = 0;
+static thread_local void *       t_lastThreadCache      = nullptr;
+
+//------------------------------------------------------------------------------
+ThreadCaches::~ThreadCaches()
+{
+    // Calls made later in this thread's exit go to the shared free lists
+    t_threadCachesReleased = true;
+    t_lastManagerId        = 0;
+    t_lastThreadCache      = nullptr;
+
+    std::lock_guard<std::mutex> lock(g_liveManagersMutex);
+
+    for( const auto & threadCache : m_threadCaches )
+    {
+        const auto manager = getLiveManagers().find(threadCache.first);
+
+        if( manager != getLiveManagers().end() )
+        {
+            manager->second->releaseThreadCache(static_cast<ThreadCachingMemoryManager::ThreadCache *>(threadCache.second));
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+ThreadCachingMemoryManager::ThreadCachingMemoryManager(FreeListMemoryManager & memoryManager)
+    :
+    m_memoryManager(memoryManager)
+  , m_sizeClasses()
+  , m_start(static_cast<const uint8_t *>(memoryManager.getStart()))
+  , m_exitedThreads()
+  , m_id(g_nextManagerId++)
+{
+    if( memoryManager.getHeaderPolicy() != FreeListMemoryManager::HeaderPolicy::Headers )
+    {
+        // Error - Uncached blocks are freed without their size
+        const std::string msg("The shared memory manager must keep allocation headers.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    const size_t rangeSize = static_cast<size_t>(static_cast<const uint8_t *>(memoryManager.getEnd()) - m_start);
+    m_pageClasses.resize((rangeSize + PAGE_SIZE - 1) >> PAGE_SIZE_LOG2, 0);
+
+    std::lock_guard<std::mutex> lock(g_liveManagersMutex);
+    getLiveManagers()[m_id] = this;
+}
+
+//------------------------------------------------------------------------------
+ThreadCachingMemoryManager::~ThreadCachingMemoryManager()
+{
+    {
+        std::lock_guard<std::mutex> lock(g_liveManagersMutex);
+        getLiveManagers().erase(m_id);
+    }
+
+    // Blocks in magazines and shared free lists all lie in the slabs
+    for( ThreadCache * threadCache : m_threadCaches )
+    {
+        delete threadCache;
+    }
+
+    for( void * slab : m_slabs )
+    {
+        m_memoryManager.free(slab);
+    }
+}
+
+//------------------------------------------------------------------------------
+ThreadCachingMemoryManager::ThreadCache * ThreadCachingMemoryManager::getThreadCache()
+{
+    if( t_lastManagerId == m_id )
+    {
+        return static_cast<ThreadCache *>(t_lastThreadCache);
+    }
+
+    if( t_threadCachesReleased )
+    {
+        return nullptr;
+    }
+
+    void *& threadCache = t_threadCaches.m_threadCaches[m_id];
+
+    if( !threadCache )
+    {
+        ThreadCache * newThreadCache = new ThreadCache();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_threadCaches.push_back(newThreadCache);
+
+        threadCache = newThreadCache;
+    }
+
+    t_lastManagerId   = m_id;
+    t_lastThreadCache = threadCache;
+
+    return static_cast<ThreadCache *>(threadCache);
+}
+
+//------------------------------------------------------------------------------
+void ThreadCachingMemoryManager::releaseThreadCache(ThreadCache * threadCache)
+{
+    for( size_t sizeClass = 0; sizeClass < NUM_SIZE_CLASSES; ++sizeClass )
+    {
+        Magazine & magazine = threadCache->m_magazines[sizeClass];
+
+        if( magazine.m_count )
+        {
+            flush(magazine, sizeClass, magazine.m_count);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        addStatistics(m_exitedThreads, threadCache->m_statistics);
+        m_threadCaches.erase(std::find(m_threadCaches.begin(), m_threadCaches.end(), threadCache));
+    }
+
+    delete threadCache;
+}
+
+//------------------------------------------------------------------------------
+// Only the owning thread writes to its counters, so a plain load and store is enough
+static void increment(std::atomic<size_t> & counter, size_t amount)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+void ThreadCachingMemoryManager::recordAllocation(ThreadStatistics & statistics, size_t size, size_t padding, size_t overhead)
+{
+    increment(statistics.m_totalAllocations, 1);
+    increment(statistics.m_requestedBytes, size);
+    increment(statistics.m_paddingBytes, padding);
+    increment(statistics.m_overheadBytes, overhead);
+    increment(statistics.m_sizeClassHistogram[MemoryStatistics::getSizeClass(size)], 1);
+}
+
+//------------------------------------------------------------------------------
+void ThreadCachingMemoryManager::addStatistics(ThreadStatistics & total, const ThreadStatistics & statistics)
+{
+    increment(total.m_totalAllocations, statistics.m_totalAllocations.load(std::memory_order_relaxed));
+    increment(total.m_totalFrees, statistics.m_totalFrees.load(std::memory_order_relaxed));
+    increment(total.m_requestedBytes, statistics.m_requestedBytes.load(std::memory_order_relaxed));
+    increment(total.m_paddingBytes, statistics.m_paddingBytes.load(std::memory_order_relaxed));
+    increment(total.m_overheadBytes, statistics.m_overheadBytes.load(std::memory_order_relaxed));
+
+    for( size_t sizeClass = 0; sizeClass < MemoryStatistics::NUM_SIZE_CLASSES; ++sizeClass )
+    {
+        increment(total.m_sizeClassHistogram[sizeClass], statistics.m_sizeClassHistogram[sizeClass].load(std::memory_order_relaxed));
+    }
+}
+
+//------------------------------------------------------------------------------
+void ThreadCachingMemoryManager::addStatistics(MemoryStatistics & total, const ThreadStatistics & statistics)
+{
+    total.m_totalAllocations += statistics.m_totalAllocations.load(std::memory_order_relaxed);
+    total.m_totalFrees       += statistics.m_totalFrees.load(std::memory_order_relaxed);
+    total.m_requestedBytes   += statistics.m_requestedBytes.load(std::memory_order_relaxed);
+    total.m_paddingBytes     += statistics.m_paddingBytes.load(std::memory_order_relaxed);
+    total.m_overheadBytes    += statistics.m_overheadBytes.load(std::memory_order_relaxed);
+
+    for( size_t sizeClass = 0; sizeClass < MemoryStatistics::NUM_SIZE_CLASSES; ++sizeClass )
+    {
+        total.m_sizeClassHistogram[sizeClass] += statistics.m_sizeClassHistogram[sizeClass].load(std::memory_order_relaxed);
+    }
+}
+
+//------------------------------------------------------------------------------
+size_t ThreadCachingMemoryManager::getSizeClass(const void * p) const
+{
+    // Pages of a slab are marked before any of its blocks are handed out, and never change while the slab exists
+    const uint8_t pageClass = m_pageClasses[static_cast<size_t>(static_cast<const uint8_t *>(p) - m_start) >> PAGE_SIZE_LOG2];
+    return pageClass ? pageClass - 1u : UNCACHED;
+}
+
+//------------------------------------------------------------------------------
+void ThreadCachingMemoryManager::addSlab(size_t sizeClass)
+{
+    // Over allocate by a page, so that the slab covers whole pages of the page map
+    // and no page is shared with a block from outside the slab
+    uint8_t * block = static_cast<uint8_t *>(m_memoryManager.allocate(SLAB_SIZE + PAGE_SIZE, SIZE_CLASS_GRANULARITY));
+    m_slabs.push_back(block);
+
+    const size_t firstOffset = (static_cast<size_t>(block - m_start) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    const size_t firstPage   = firstOffset >> PAGE_SIZE_LOG2;
+
+    std::fill(m_pageClasses.begin() + firstPage, m_pageClasses.begin() + firstPage + SLAB_SIZE / PAGE_SIZE, static_cast<uint8_t>(sizeClass + 1));
+
+    m_sizeClasses[sizeClass].m_slabCursor = const_cast<uint8_t *>(m_start) + firstOffset;
+    m_sizeClasses[sizeClass].m_slabEnd    = m_sizeClasses[sizeClass].m_slabCursor + SLAB_SIZE;
+}
+
+//------------------------------------------------------------------------------
+void * ThreadCachingMemoryManager::takeBlock(size_t sizeClass)
+{
+    const size_t blockSize = (sizeClass + 1) * SIZE_CLASS_GRANULARITY;
+    SizeClass &  shared    = m_sizeClasses[sizeClass];
+
+    if( shared.m_freeBlocks )
+    {
+        void * block = shared.m_freeBlocks;
+        shared.m_freeBlocks = *static_cast<void **>(block);
+
+        return block;
+    }
+
+    if( static_cast<size_t>(shared.m_slabEnd - shared.m_slabCursor) < blockSize )
+    {
+        addSlab(sizeClass);
+    }
+
+    void * block = shared.m_slabCursor;
+    shared.m_slabCursor += blockSize;
+
+    return block;
+}
+
+//------------------------------------------------------------------------------
+void * ThreadCachingMemoryManager::allocateUncached(size_t size, size_t offset)
+{
+    uint8_t * block = static_cast<uint8_t *>(m_memoryManager.allocate(size + offset, static_cast<uint8_t>(offset)));
+
+    AllocationHeader * header = reinterpret_cast<AllocationHeader *>(block + offset - sizeof(AllocationHeader));
+    header->m_offset = offset;
+
+    return block + offset;
+}
+
+//------------------------------------------------------------------------------
+void ThreadCachingMemoryManager::refill(Magazine & magazine, size_t sizeClass)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for( size_t index = 0; index < BATCH_SIZE; ++index )
+    {
+        void * block;
+
+        try
+        {
+            block = takeBlock(sizeClass);
+        }
+        catch( const Common::Exception & )
+        {
+            // Settle for a partial batch, unless we could not get anything at all
+            if( magazine.m_count )
+            {
+                return;
+            }
+
+            throw;
+        }
+
+        magazine.m_blocks[magazine.m_count++] = block;
+    }
+}
+
+//------------------------------------------------------------------------------
+void ThreadCachingMemoryManager::flush(Magazine & magazine, size_t sizeClass, size_t count)
+{
+    SizeClass & shared = m_sizeClasses[sizeClass];
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for( size_t index = 0; index < count; ++index )
+    {
+        void * block = magazine.m_blocks[--magazine.m_count];
+        *static_cast<void **>(block) = shared.m_freeBlocks;
+        shared.m_freeBlocks = block;
+    }
+}
+
+//------------------------------------------------------------------------------
+void * ThreadCachingMemoryManager::allocateShared(size_t size, uint8_t alignment)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if( size <= MAX_CACHED_SIZE && SIZE_CLASS_GRANULARITY % alignment == 0 )
+    {
+        const size_t sizeClass = (size - 1) / SIZE_CLASS_GRANULARITY;
+        void * block = takeBlock(sizeClass);
+
+        recordAllocation(m_exitedThreads, size, (sizeClass + 1) * SIZE_CLASS_GRANULARITY - size, 0);
+
+        return block;
+    }
+
+    const size_t offset = alignment > SIZE_CLASS_GRANULARITY ? alignment : SIZE_CLASS_GRANULARITY;
+    void * p = allocateUncached(size, offset);
+
+    recordAllocation(m_exitedThreads, size, offset - sizeof(AllocationHeader), sizeof(AllocationHeader));
+
+    return p;
+}
+
+//------------------------------------------------------------------------------
+void ThreadCachingMemoryManager::freeShared(void * p, size_t sizeClass)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    increment(m_exitedThreads.m_totalFrees, 1);
+
+    if( sizeClass == UNCACHED )
+    {
+        const AllocationHeader * header = reinterpret_cast<AllocationHeader *>(static_cast<uint8_t *>(p) - sizeof(AllocationHeader));
+        m_memoryManager.free(static_cast<uint8_t *>(p) - header->m_offset);
+
+        return;
+    }
+
+    SizeClass & shared = m_sizeClasses[sizeClass];
+    *static_cast<void **>(p) = shared.m_freeBlocks;
+    shared.m_freeBlocks = p;
+}
+
+//------------------------------------------------------------------------------
+void * ThreadCachingMemoryManager::allocate(size_t size, uint8_t alignment)
+{
+    if( size <= 0 )
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid size requested. Size must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( !alignment )
+    {
+        // Error - Invalid alignment
+        const std::string msg("Invalid alignment. Alignment must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    ThreadCache * threadCache = getThreadCache();
+
+    if( !threadCache )
+    {
+        return allocateShared(size, alignment);
+    }
+
+    if( size <= MAX_CACHED_SIZE && SIZE_CLASS_GRANULARITY % alignment == 0 )
+    {
+        const size_t sizeClass = (size - 1) / SIZE_CLASS_GRANULARITY;
+        Magazine & magazine = threadCache->m_magazines[sizeClass];
+
+        if( !magazine.m_count )
+        {
+            refill(magazine, sizeClass);
+        }
+
+        recordAllocation(threadCache->m_statistics, size, (sizeClass + 1) * SIZE_CLASS_GRANULARITY - size, 0);
+
+        return magazine.m_blocks[--magazine.m_count];
+    }
+
+    // Too large or too strictly aligned to cache
+    // Offset the block far enough to hold our header while keeping the requested alignment
+    const size_t offset = alignment > SIZE_CLASS_GRANULARITY ? alignment : SIZE_CLASS_GRANULARITY;
+    void * p;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        p = allocateUncached(size, offset);
+    }
+
+    recordAllocation(threadCache->m_statistics, size, offset - sizeof(AllocationHeader), sizeof(AllocationHeader));
+
+    return p;
+}
+
+//------------------------------------------------------------------------------
+void ThreadCachingMemoryManager::free(void * p)
+{
+    if( !p )
+    {
+        // Error - p is nullptr
+        const std::string msg("p is nullptr");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    const size_t  sizeClass   = getSizeClass(p);
+    ThreadCache * threadCache = getThreadCache();
+
+    if( !threadCache )
+    {
+        freeShared(p, sizeClass);
+        return;
+    }
+
+    increment(threadCache->m_statistics.m_totalFrees, 1);
+
+    if( sizeClass == UNCACHED )
+    {
+        const AllocationHeader * header = reinterpret_cast<AllocationHeader *>(static_cast<uint8_t *>(p) - sizeof(AllocationHeader));
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_memoryManager.free(static_cast<uint8_t *>(p) - header->m_offset);
+
+        return;
+    }
+
+    Magazine & magazine = threadCache->m_magazines[sizeClass];
+
+    if( magazine.m_count == MAGAZINE_SIZE )
+    {
+        flush(magazine, sizeClass, BATCH_SIZE);
+    }
+
+    magazine.m_blocks[magazine.m_count++] = p;
+}
+
+//------------------------------------------------------------------------------
+void * ThreadCachingMemoryManager::reallocate(void * p, size_t newSize, uint8_t alignment)
+{
+    if( !p )
+    {
+        return allocate(newSize, alignment);
+    }
+
+    if( !alignment )
+    {
+        // Error - Invalid alignment
+        const std::string msg("Invalid alignment. Alignment must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( reinterpret_cast<uintptr_t>(p) % alignment == 0 && tryExpandInPlace(p, newSize) )
+    {
+        return p;
+    }
+
+    // Move it
+    const size_t oldSize = getAllocationSize(p);
+    void * newP = allocate(newSize, alignment);
+
+    std::memcpy(newP, p, oldSize < newSize ? oldSize : newSize);
+    free(p);
+
+    return newP;
+}
+
+//------------------------------------------------------------------------------
+bool ThreadCachingMemoryManager::tryExpandInPlace(void * p, size_t newSize)
+{
+    if( !p )
+    {
+        // Error - p is nullptr
+        const std::string msg("p is nullptr");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    if( newSize <= 0 )
+    {
+        // Error - Invalid size
+        const std::string msg("Invalid size requested. Size must be greater than zero.");
+        throw Common::Exception(__FILE__, __LINE__, msg);
+    }
+
+    const size_t sizeClass = getSizeClass(p);
+
+    if( sizeClass == UNCACHED )
+    {
+        // Let the shared memory manager grow or shrink the whole block, header included
+        const AllocationHeader * header = reinterpret_cast<AllocationHeader *>(static_cast<uint8_t *>(p) - sizeof(AllocationHeader));
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_memoryManager.tryExpandInPlace(static_cast<uint8_t *>(p) - header->m_offset, newSize + header->m_offset);
+    }
+
+    // Cached blocks stay in their size class, so they can only change within it
+    return newSize <= (sizeClass + 1) * SIZE_CLASS_GRANULARITY;
+}
+
+//------------------------------------------------------------------------------
+size_t ThreadCachingMemoryManager::getAllocationSize(const void * p) const
+{
+    const size_t sizeClass = getSizeClass(p);
+
+    if( sizeClass == UNCACHED )
+    {
+        const AllocationHeader * header = reinterpret_cast<const AllocationHeader *>(static_cast<const uint8_t *>(p) - sizeof(AllocationHeader));
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_memoryManager.getAllocationSize(static_cast<const uint8_t *>(p) - header->m_offset) - header->m_offset;
+    }
+
+    return (sizeClass + 1) * SIZE_CLASS_GRANULARITY;
+}
+
+//------------------------------------------------------------------------------
+bool ThreadCachingMemoryManager::owns(const void * p) const
+{
+    // The shared memory manager's range never changes, so there is no need for the lock
+    return m_memoryManager.owns(p);
+}
+
+//------------------------------------------------------------------------------
+MemoryStatistics ThreadCachingMemoryManager::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    MemoryStatistics statistics = m_memoryManager.getStatistics();
+    statistics.m_totalAllocations = 0;
+    statistics.m_totalFrees       = 0;
+    statistics.m_requestedBytes   = 0;
+    statistics.m_paddingBytes     = 0;
+    statistics.m_overheadBytes    = 0;
+
+    for( size_t sizeClass = 0; sizeClass < MemoryStatistics::NUM_SIZE_CLASSES; ++sizeClass )
+    {
+        statistics.m_sizeClassHistogram[sizeClass] = 0;
+    }
+
+    for( const ThreadCache * threadCache : m_threadCaches )
+    {
+        addStatistics(statistics, threadCache->m_statistics);
+    }
+
+    addStatistics(statistics, m_exitedThreads);
+
+    // Blocks may be freed on a different thread than they were allocated on, so only the totals balance
+    statistics.m_numAllocations = statistics.m_totalAllocations - statistics.m_totalFrees;
+
+    return statistics;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,145 @@
+#pragma once
+
+// Project Includes
+#include "FreeListMemoryManager.h"
+#include "IMemoryManager.h"
+
+// Standard Includes
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// A thread safe front end to a shared FreeListMemoryManager
+//
+// Small requests are served from per-thread, per-size-class magazines of blocks, without taking a lock.
+// A magazine is refilled from, or flushed back to, the shared free list of its size class half a magazine at a time,
+// which is the only time the lock is taken. Large or over-aligned requests go straight to the shared memory manager.
+//
+// Cached blocks carry no header. They are carved from slabs taken from the shared memory manager, one size class per slab,
+// and a page map over the shared memory manager's range records the size class of every slab page, so free() finds
+// the size class from the address alone. Slabs stay with their size class until destruction.
+//
+// Blocks may be freed on any thread, they go into the freeing thread's magazine.
+// When a thread exits its magazines are flushed to the shared free lists and its cache is deleted. Any call it makes
+// later in its exit goes straight to the shared free lists, under the lock.
+// The shared memory manager must not be used directly while this manager is alive and must keep allocation headers.
+//
+// Allocation and free counts are kept per thread, without a lock, and summed by getStatistics().
+// The counts of threads that have exited are kept too.
+// Usage, capacity, failures and free blocks are those of the shared memory manager, so slabs count as used.
+class ThreadCachingMemoryManager : public IMemoryManager
+{
+    // Owns the calling thread's caches, and gives them back when the thread exits
+    friend struct ThreadCaches;
+
+protected:
+
+    static const size_t SIZE_CLASS_GRANULARITY = 16;
+    static const size_t NUM_SIZE_CLASSES       = 16;
+    static const size_t MAX_CACHED_SIZE        = SIZE_CLASS_GRANULARITY * NUM_SIZE_CLASSES;
+    static const size_t MAGAZINE_SIZE          = 64;
+    static const size_t BATCH_SIZE             = MAGAZINE_SIZE / 2;
+    static const size_t UNCACHED               = NUM_SIZE_CLASSES;
+    static const size_t SLAB_SIZE              = 16 * 1024;
+    static const size_t PAGE_SIZE_LOG2         = 10;     // Granularity of the page map, slabs cover whole pages
+    static const size_t PAGE_SIZE              = size_t(1) << PAGE_SIZE_LOG2;
+
+    // Written before every uncached block handed out, so that free() can find the block the shared memory manager gave
+    struct AllocationHeader
+    {
+        size_t m_offset;      // Distance from the start of the block given by the shared memory manager
+    };
+
+    struct Magazine
+    {
+        size_t m_count;
+        void * m_blocks[MAGAZINE_SIZE];
+    };
+
+    // Only ever written by the thread that owns it, atomic so that getStatistics() may read it from any thread
+    struct ThreadStatistics
+    {
+        std::atomic<size_t> m_totalAllocations;
+        std::atomic<size_t> m_totalFrees;
+        std::atomic<size_t> m_requestedBytes;
+        std::atomic<size_t> m_paddingBytes;
+        std::atomic<size_t> m_overheadBytes;
+        std::atomic<size_t> m_sizeClassHistogram[MemoryStatistics::NUM_SIZE_CLASSES];
+    };
+
+    struct ThreadCache
+    {
+        Magazine         m_magazines[NUM_SIZE_CLASSES];
+        ThreadStatistics m_statistics;
+    };
+
+    // Shared by every thread, guarded by m_mutex
+    struct SizeClass
+    {
+        void *    m_freeBlocks;   // Blocks flushed from magazines, linked through their first word
+        uint8_t * m_slabCursor;   // Next block not yet carved from the newest slab
+        uint8_t * m_slabEnd;
+    };
+
+    FreeListMemoryManager &    m_memoryManager;  // Shared memory manager that slabs and uncached blocks come from
+    mutable std::mutex         m_mutex;          // Guards m_memoryManager, m_sizeClasses, m_slabs and m_threadCaches
+    SizeClass                  m_sizeClasses[NUM_SIZE_CLASSES];
+    std::vector<void *>        m_slabs;          // Every slab, as given by the shared memory manager
+    const uint8_t *            m_start;          // First address of the shared memory manager's range
+    std::vector<uint8_t>       m_pageClasses;    // Per page of that range, size class + 1 if it lies in a slab, or 0
+    std::vector<ThreadCache *> m_threadCaches;   // Thread caches of the threads that have not exited yet
+    ThreadStatistics           m_exitedThreads;  // Counts of the threads that have exited, guarded by m_mutex
+    uint64_t                   m_id;             // Unique for the life of the process, used to find this manager's thread caches
+
+    // Returns nullptr once the calling thread has given back its caches on exit
+    ThreadCache * getThreadCache();
+
+    // Flushes the magazines of an exiting thread, keeps its counts and deletes its cache
+    void releaseThreadCache(ThreadCache * threadCache);
+
+    static void recordAllocation(ThreadStatistics & statistics, size_t size, size_t padding, size_t overhead);
+    static void addStatistics(ThreadStatistics & total, const ThreadStatistics & statistics);
+    static void addStatistics(MemoryStatistics & total, const ThreadStatistics & statistics);
+
+    // Size class of the block at p, or UNCACHED if it is not in a slab
+    size_t getSizeClass(const void * p) const;
+
+    // Takes a new slab for the size class from the shared memory manager, the lock must be held
+    void addSlab(size_t sizeClass);
+
+    // Takes a block from the shared free list of the size class, or carves one from its slab, the lock must be held
+    void * takeBlock(size_t sizeClass);
+
+    // Takes a block from the shared memory manager, offset to make room for the header, the lock must be held
+    void * allocateUncached(size_t size, size_t offset);
+
+    void refill(Magazine & magazine, size_t sizeClass);
+    void flush(Magazine & magazine, size_t sizeClass, size_t count);
+
+    // For threads that have given back their caches, every call takes the lock
+    void * allocateShared(size_t size, uint8_t alignment);
+    void freeShared(void * p, size_t sizeClass);
+
+public:
+
+    ThreadCachingMemoryManager(FreeListMemoryManager & memoryManager);
+    ThreadCachingMemoryManager(const ThreadCachingMemoryManager &) = delete;
+    ThreadCachingMemoryManager & operator = (const ThreadCachingMemoryManager &) = delete;
+    ~ThreadCachingMemoryManager();
+
+    void * allocate(size_t size, uint8_t alignment);
+    using IMemoryManager::free;
+    void free(void * p);
+    void * reallocate(void * p, size_t newSize, uint8_t alignment);
+    bool tryExpandInPlace(void * p, size_t newSize);
+
+    // Number of bytes the caller may use at p, which may be more than was requested
+    size_t getAllocationSize(const void * p) const;
+
+    // Whether p lies inside the memory of the shared memory manager
+    bool owns(const void * p) const;
+
+    MemoryStatistics getStatistics() const;
+};
@@ -0,0 +1,20 @@
+
+// Project Includes
+#include "ThreadIndex.h"
+
+// Standard Includes
+#include <atomic>
+
+//------------------------------------------------------------------------------
+static std::atomic<uint32_t> g_nextThreadIndex(0);
+
+//------------------------------------------------------------------------------
+uint32_t getThreadIndex()
+{
+    // Assigned on the calling thread's first call
+    static thread_local const uint32_t t_threadIndex = g_nextThreadIndex++;
+
+    return t_threadIndex;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,13 @@
+#pragma once
+
+// Standard Includes
+#include <cstdint>
+
+//------------------------------------------------------------------------------
+// Small, dense index of the calling thread, for picking a counter shard or labelling a trace event
+//
+// Threads are numbered in the order they first ask, starting from 0, and keep their index until they exit.
+// Indices are not reused, so every thread that ever asked has its own.
+uint32_t getThreadIndex();
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,161 @@
+
+// Project Includes
+#include "TracingMemoryManager.h"
+#include "ThreadIndex.h"
+
+//------------------------------------------------------------------------------
+TracingMemoryManager::TracingMemoryManager(IMemoryManager & memoryManager, std::ostream & stream)
+    :
+    m_memoryManager(memoryManager)
+  , m_stream(stream)
+  , m_nextObjectId(0)
+  , m_start(Clock::now())
+{
+    m_buffer.reserve(BUFFER_SIZE);
+    AllocationTrace::writeHeader(m_stream);
+}
+
+//------------------------------------------------------------------------------
+TracingMemoryManager::~TracingMemoryManager()
+{
+    flush();
+}
+
+//------------------------------------------------------------------------------
+void TracingMemoryManager::record(AllocationTrace::EventType type, const LiveObject & object)
+{
+    AllocationTrace::Event event;
+    event.m_timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_start).count();
+    event.m_objectId  = object.m_objectId;
+    event.m_size      = object.m_size;
+    event.m_thread    = getThreadIndex();
+    event.m_type      = type;
+    event.m_alignment = object.m_alignment;
+    event.m_reserved  = 0;
+
+    m_buffer.push_back(event);
+
+    if( m_buffer.size() == BUFFER_SIZE )
+    {
+        writeBuffer();
+    }
+}
+
+//------------------------------------------------------------------------------
+void TracingMemoryManager::writeBuffer()
+{
+    AllocationTrace::writeEvents(m_stream, m_buffer.data(), m_buffer.size());
+    m_buffer.clear();
+}
+
+//------------------------------------------------------------------------------
+void * TracingMemoryManager::allocate(size_t size, uint8_t alignment)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    void * p = m_memoryManager.allocate(size, alignment);
+
+    const LiveObject object = { m_nextObjectId++, size, alignment };
+    m_liveObjects[p] = object;
+    record(AllocationTrace::EventType::Allocate, object);
+
+    return p;
+}
+
+//------------------------------------------------------------------------------
+void TracingMemoryManager::free(void * p)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto liveObject = m_liveObjects.find(p);
+
+    if( liveObject != m_liveObjects.end() )
+    {
+        record(AllocationTrace::EventType::Free, liveObject->second);
+        m_liveObjects.erase(liveObject);
+    }
+
+    m_memoryManager.free(p);
+}
+
+//------------------------------------------------------------------------------
+void TracingMemoryManager::free(void * p, size_t size, uint8_t alignment)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto liveObject = m_liveObjects.find(p);
+
+    if( liveObject != m_liveObjects.end() )
+    {
+        record(AllocationTrace::EventType::Free, liveObject->second);
+        m_liveObjects.erase(liveObject);
+    }
+
+    m_memoryManager.free(p, size, alignment);
+}
+
+//------------------------------------------------------------------------------
+void * TracingMemoryManager::reallocate(void * p, size_t newSize, uint8_t alignment)
+{
+    if( !p )
+    {
+        return allocate(newSize, alignment);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    void * newAddress = m_memoryManager.reallocate(p, newSize, alignment);
+
+    auto liveObject = m_liveObjects.find(p);
+
+    if( liveObject != m_liveObjects.end() )
+    {
+        LiveObject object  = liveObject->second;
+        object.m_size      = newSize;
+        object.m_alignment = alignment;
+
+        m_liveObjects.erase(liveObject);
+        m_liveObjects[newAddress] = object;
+        record(AllocationTrace::EventType::Reallocate, object);
+    }
+
+    return newAddress;
+}
+
+//------------------------------------------------------------------------------
+bool TracingMemoryManager::tryExpandInPlace(void * p, size_t newSize)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if( !m_memoryManager.tryExpandInPlace(p, newSize) )
+    {
+        return false;
+    }
+
+    // Recorded as a reallocation, which a replay may or may not manage in place
+    auto liveObject = m_liveObjects.find(p);
+
+    if( liveObject != m_liveObjects.end() )
+    {
+        liveObject->second.m_size = newSize;
+        record(AllocationTrace::EventType::Reallocate, liveObject->second);
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+MemoryStatistics TracingMemoryManager::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_memoryManager.getStatistics();
+}
+
+//------------------------------------------------------------------------------
+void TracingMemoryManager::flush()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    writeBuffer();
+    m_stream.flush();
+}
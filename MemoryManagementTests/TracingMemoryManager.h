@@ -0,0 +1,70 @@
+#pragma once
+
+// Project Includes
+#include "AllocationTrace.h"
+#include "IMemoryManager.h"
+
+// Standard Includes
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// Forwards every call to another memory manager and records it as an AllocationTrace
+//
+// Events are buffered and written to the stream in batches, and on flush() and destruction.
+// Every call takes a lock, so this is thread safe as long as the memory manager it wraps is, and the
+// recorded order is the order the calls reached the memory manager. The cost of recording is in every timestamp,
+// so replay a trace rather than timing the program that recorded it.
+//
+// Only allocations made through this manager are recorded, freeing anything else is forwarded without a record.
+class TracingMemoryManager : public IMemoryManager
+{
+protected:
+
+    static const size_t BUFFER_SIZE = 4096;    // Events buffered before they are written
+
+    // What is known about a live allocation, keyed by its address
+    struct LiveObject
+    {
+        uint64_t m_objectId;
+        uint64_t m_size;
+        uint8_t  m_alignment;
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    IMemoryManager &                         m_memoryManager;
+    std::ostream &                           m_stream;
+    mutable std::mutex                       m_mutex;         // Guards everything below, and calls to m_memoryManager
+    std::unordered_map<void *, LiveObject>   m_liveObjects;
+    std::vector<AllocationTrace::Event>      m_buffer;
+    uint64_t                                 m_nextObjectId;
+    Clock::time_point                        m_start;
+
+    void record(AllocationTrace::EventType type, const LiveObject & object);
+    void writeBuffer();
+
+public:
+
+    /// Does not take ownership of either argument, the stream must be opened in binary mode
+    TracingMemoryManager(IMemoryManager & memoryManager, std::ostream & stream);
+    TracingMemoryManager(const TracingMemoryManager &) = delete;
+    TracingMemoryManager & operator = (const TracingMemoryManager &) = delete;
+    ~TracingMemoryManager();
+
+    void * allocate(size_t size, uint8_t alignment);
+    void free(void * p);
+    void free(void * p, size_t size, uint8_t alignment);
+    void * reallocate(void * p, size_t newSize, uint8_t alignment);
+    bool tryExpandInPlace(void * p, size_t newSize);
+    MemoryStatistics getStatistics() const;
+
+    // Writes buffered events to the stream and flushes it
+    void flush();
+};
+
+//------------------------------------------------------------------------------
@@ -1,220 +1,2169 @@
 
 // Project Includes
+#include "BenchmarkHarness.h"
+#include "BuddyMemoryManager.h"
 #include "ComplexNumber.h"
+#include "ComplexNumberPool.h"
+#include "ConcurrentLinearMemoryManager.h"
 #include "CustomAllocator.hxx"
 #include "FreeListMemoryManager.h"
 #include "LinearMemoryManager.h"
+#include "MemoryResource.hxx"
+#include "OffsetPointer.hxx"
+#include "PersistentMemoryManager.h"
+#include "PoolMemoryManager.h"
+#include "RingBufferMemoryManager.h"
 #include "StackMemoryManager.h"
+#include "StaticAllocator.hxx"
+#include "ThreadArenaMemoryManager.h"
+#include "ThreadCachingMemoryManager.h"
+#include "TracingMemoryManager.h"
 
 // Common Library
+#include "Exception.h"
 #include "PerformanceTimer.h"
 
 // Standard Includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 //------------------------------------------------------------------------------
-const size_t g_numElements(1000);
-const size_t g_iterations(5000);
+// Targets adapt each memory manager to the calls made by BenchmarkHarness
 
-//------------------------------------------------------------------------------
-void RunNoMemoryManagement()
+// Global operator new and delete
+struct SystemTarget
 {
-    // Start timer
-    Common::PerformanceTimer timer;
-    timer.Start();
+    void * allocate(size_t size, uint8_t)
+    {
+        return ::operator new(size);
+    }
 
-    // Do the work
-    for (int i = 0; i < g_iterations; ++i)
+    void free(void * p, size_t, uint8_t)
     {
-        ComplexNumber * array[g_numElements];
+        ::operator delete(p);
+    }
 
-        for (int j = 0; j < g_numElements; ++j)
-        {
-            array[j] = new ComplexNumber(i, j);
-        }
+    void release()
+    {
+    }
+};
+
+// Any memory manager with a sized free
+template <class MemoryManager>
+struct MemoryManagerTarget
+{
+    MemoryManager & m_memoryManager;
+
+    void * allocate(size_t size, uint8_t alignment)
+    {
+        return m_memoryManager.allocate(size, alignment);
+    }
+
+    void free(void * p, size_t size, uint8_t alignment)
+    {
+        m_memoryManager.free(p, size, alignment);
+    }
+
+    void allocateBatch(size_t count, size_t size, uint8_t alignment, void ** out)
+    {
+        m_memoryManager.allocateBatch(count, size, alignment, out);
+    }
+
+    void freeBatch(void ** ptrs, size_t count, size_t size, uint8_t alignment)
+    {
+        m_memoryManager.freeBatch(ptrs, count, size, alignment);
+    }
+
+    void release()
+    {
+    }
+};
+
+// Memory is only given back all at once, when every object of an iteration is dead
+struct LinearTarget
+{
+    LinearMemoryManager & m_memoryManager;
+
+    void * allocate(size_t size, uint8_t alignment)
+    {
+        return m_memoryManager.allocate(size, alignment);
+    }
+
+    void free(void *, size_t, uint8_t)
+    {
+    }
+
+    void release()
+    {
+        m_memoryManager.clear();
+    }
+};
+
+// Makes a memory manager that is not thread safe shareable, by taking a lock around every call
+template <class MemoryManager>
+struct LockedTarget
+{
+    MemoryManager & m_memoryManager;
+    std::mutex      m_mutex;
+
+    LockedTarget(MemoryManager & memoryManager)
+        :
+        m_memoryManager(memoryManager)
+    {
+    }
+
+    void * allocate(size_t size, uint8_t alignment)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_memoryManager.allocate(size, alignment);
+    }
+
+    void free(void * p, size_t size, uint8_t alignment)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_memoryManager.free(p, size, alignment);
+    }
+
+    void release()
+    {
+    }
+};
+
+//------------------------------------------------------------------------------
+size_t RoundUp(size_t size, size_t alignment)
+{
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+//------------------------------------------------------------------------------
+// Benchmarks that construct ComplexNumbers in their objects make each one the object size, or a ComplexNumber if that is larger
+size_t GetElementSize(const BenchmarkParameters & parameters)
+{
+    return std::max(parameters.m_objectSize, sizeof(ComplexNumber));
+}
+
+//------------------------------------------------------------------------------
+uint8_t GetElementAlignment(const BenchmarkParameters & parameters)
+{
+    return static_cast<uint8_t>(std::max<size_t>(parameters.getAlignment(), alignof(ComplexNumber)));
+}
+
+//------------------------------------------------------------------------------
+// Benchmarks that hand their objects between threads make a tenth of the iterations
+size_t GetThreadedIterations(const BenchmarkParameters & parameters)
+{
+    return std::max<size_t>(1, parameters.m_iterations / 10);
+}
+
+//------------------------------------------------------------------------------
+void RunNoMemoryManagement(const BenchmarkHarness & harness)
+{
+    SystemTarget target;
+    std::cout << harness.run("no memory management", target).toString() << "\n";
+}
+
+//------------------------------------------------------------------------------
+void RunLinearMemoryManagement(const BenchmarkHarness & harness)
+{
+    const BenchmarkParameters & parameters = harness.getParameters();
+
+    LinearMemoryManager pool(RoundUp(parameters.m_objectSize, parameters.getAlignment()) * parameters.m_numElements + parameters.getAlignment());
+    LinearTarget target = { pool };
+
+    std::cout << harness.run("linear memory management", target).toString() << "\n";
+}
+
+//------------------------------------------------------------------------------
+void RunScopedLinearMemoryManagement(const BenchmarkHarness & harness)
+{
+    // Each request goes through several phases, whose temporaries are released when the phase ends,
+    // so the arena only ever needs to hold one phase worth of elements
+    const size_t numPhases = 3;
+
+    const BenchmarkParameters & parameters = harness.getParameters();
+    const size_t  elementSize      = GetElementSize(parameters);
+    const uint8_t elementAlignment = GetElementAlignment(parameters);
+    const size_t  elementsPerPhase = parameters.m_numElements / numPhases;
+
+    LinearMemoryManager pool(RoundUp(elementSize, elementAlignment) * elementsPerPhase + elementAlignment);
 
-        for (int j = 0; j < g_numElements; ++j)
+    const BenchmarkTiming timing = harness.time([&]()
+    {
+        for (size_t i = 0; i < parameters.m_iterations; ++i)
         {
-            delete array[j];
+            LinearMemoryManager::Scope request(pool);
+
+            for (size_t phase = 0; phase < numPhases; ++phase)
+            {
+                LinearMemoryManager::Scope phaseScope(pool);
+
+                // Allocate
+                for (size_t j = 0; j < elementsPerPhase; ++j)
+                {
+                    void * address = pool.allocate(elementSize, elementAlignment);
+                    new(address) ComplexNumber(i, j);
+                }
+            }
         }
-    }
+    });
 
-    // Stop the timer
-    double secondsElapsed = timer.Stop();
-    std::cout << "Test with no memory management took " << secondsElapsed << " seconds.\n";
+    std::cout << "Test with scoped linear memory management took " << timing.toString() << ".\n";
 }
 
 //------------------------------------------------------------------------------
-void RunLinearMemoryManagement()
+void RunBackingStoreMemoryManagement(const BenchmarkHarness & harness, BackingStore::Policy policy)
 {
-    // Start timer
-    Common::PerformanceTimer timer;
-    timer.Start();
+    const char * policyNames[] = { "malloc", "prefaulted", "huge page", "mapped" };
+
+    const BenchmarkParameters & parameters = harness.getParameters();
+    const size_t  elementSize      = RoundUp(GetElementSize(parameters), GetElementAlignment(parameters));
+    const uint8_t elementAlignment = GetElementAlignment(parameters);
 
-    // Do the work
+    // Large enough that page faults and TLB misses show up, whatever the number of elements
+    const size_t numElements = 256 * 1024 * 1024 / elementSize;
+
+    BackingStore::Policy usedPolicy = policy;
+
+    // Every run starts from a new backing store, so that each first pass takes the page faults again
+    const std::vector<BenchmarkTiming> timings = harness.timePhases([&]()
     {
-        for (int i = 0; i < g_iterations; ++i)
+        Common::PerformanceTimer timer;
+        timer.Start();
+
+        LinearMemoryManager pool(elementSize * numElements, policy);
+
+        // Construction, then the first pass, which takes any page faults the backing store did not take up front,
+        // timed separately from the second
+        std::vector<double> secondsElapsed(1, timer.Stop());
+
+        for (int pass = 0; pass < 2; ++pass)
         {
-            LinearMemoryManager pool(sizeof(ComplexNumber) * g_numElements);
-            ComplexNumber * array[g_numElements];
+            timer.Start();
 
-            // Allocate
-            for (int j = 0; j < g_numElements; ++j)
+            for (size_t j = 0; j < numElements; ++j)
             {
-                void * address = pool.allocate(sizeof(ComplexNumber), alignof(ComplexNumber));
-                array[j] = new(address) ComplexNumber(i, j);
+                void * address = pool.allocate(elementSize, elementAlignment);
+                new(address) ComplexNumber(pass, j);
             }
 
             // Must release all at once
             pool.clear();
+
+            secondsElapsed.push_back(timer.Stop());
         }
-    }
 
-    // Stop the timer
-    double secondsElapsed = timer.Stop();
-    std::cout << "Test with linear memory management took " << secondsElapsed << " seconds.\n";
+        usedPolicy = pool.getBackingStorePolicy();
+        return secondsElapsed;
+    });
+
+    // The backing store falls back to another policy when the requested one is not available, name the one that was used
+    const std::string policyName = usedPolicy == policy ? std::string(policyNames[static_cast<int>(usedPolicy)])
+                                 : std::string(policyNames[static_cast<int>(usedPolicy)]) + " (in place of " + policyNames[static_cast<int>(policy)] + ")";
+
+    std::cout << "Test with " << policyName << " backing store took " << timings[0].toString()
+              << " to construct, " << timings[1].toString() << " for the first pass and "
+              << timings[2].toString() << " for the second pass.\n";
 }
 
 //------------------------------------------------------------------------------
-void RunStackMemoryManagement()
+void RunStackMemoryManagement(const BenchmarkHarness & harness)
 {
-    // Start timer
-    Common::PerformanceTimer timer;
-    timer.Start();
+    const BenchmarkParameters & parameters = harness.getParameters();
+
+    // We need to add, in the worst case, 2x the size of the header for each element
+    // (because we need to still allow for the alignment of our type)
+    StackMemoryManager pool((parameters.m_objectSize + 32) * parameters.m_numElements);
+    MemoryManagerTarget<StackMemoryManager> target = { pool };
 
-    // Do the work
+    std::cout << harness.run("stack memory management", target).toString() << "\n";
+}
+
+//------------------------------------------------------------------------------
+void RunDoubleEndedStackMemoryManagement(const BenchmarkHarness & harness)
+{
+    const BenchmarkParameters & parameters = harness.getParameters();
+    const size_t  elementSize      = GetElementSize(parameters);
+    const uint8_t elementAlignment = GetElementAlignment(parameters);
+
+    const BenchmarkTiming timing = harness.time([&]()
     {
-        for (int i = 0; i < g_iterations; ++i)
+        std::vector<ComplexNumber *> array(parameters.m_numElements);
+
+        for (size_t i = 0; i < parameters.m_iterations; ++i)
         {
+            // Long lived elements grow up from the bottom, while a short lived temporary per element grows down from the top
             // We need to add, in the worst case, 2x the size of the header for each element
             // (because we need to still allow for the alignment of our type)
-            StackMemoryManager pool((sizeof(ComplexNumber) + 32) * g_numElements);
-            ComplexNumber * array[g_numElements];
+            StackMemoryManager pool((elementSize + 2 * elementAlignment + 32) * (parameters.m_numElements + 1));
 
             // Allocate
-            for (int j = 0; j < g_numElements; ++j)
+            for (size_t j = 0; j < parameters.m_numElements; ++j)
             {
-                void * address = pool.allocate(sizeof(ComplexNumber), alignof(ComplexNumber));
-                array[j] = new(address) ComplexNumber(i, j);
+                void * temporaryAddress = pool.allocate(elementSize, elementAlignment, StackMemoryManager::StackEnd::Top);
+                ComplexNumber * temporary = new(temporaryAddress) ComplexNumber(i, j);
+
+                void * address = pool.allocate(elementSize, elementAlignment, StackMemoryManager::StackEnd::Bottom);
+                array[j] = new(address) ComplexNumber(*temporary);
+
+                // The temporary is released straight away, without breaking LIFO order for the long lived elements
+                pool.free(temporary);
             }
 
             // Must release in LIFO order
-            for (int j = g_numElements - 1; j >= 0; --j)
+            for (size_t j = parameters.m_numElements; j > 0; --j)
             {
-                pool.free(array[j]);
+                pool.free(array[j - 1]);
             }
         }
-    }
+    });
 
-    // Stop the timer
-    double secondsElapsed = timer.Stop();
-    std::cout << "Test with linear memory management took " << secondsElapsed << " seconds.\n";
+    std::cout << "Test with double ended stack memory management took " << timing.toString() << ".\n";
 }
 
 //------------------------------------------------------------------------------
-void RunFreeListMemoryManagement()
+const char * GetPolicyName(FreeListMemoryManager::AllocationPolicy policy)
 {
-    // Start timer
-    Common::PerformanceTimer timer;
-    timer.Start();
+    return policy == FreeListMemoryManager::AllocationPolicy::SegregatedFit ? "segregated fit" : "first fit";
+}
 
-    // Do the work
+//------------------------------------------------------------------------------
+void RunFreeListMemoryManagement(const BenchmarkHarness & harness, FreeListMemoryManager::AllocationPolicy policy)
+{
+    const BenchmarkParameters & parameters = harness.getParameters();
+
+    // We need to add, in the worst case, 2x the size of the header for each element
+    // (because we need to still allow for the alignment of our type), plus the boundary tag footer
+    FreeListMemoryManager pool((parameters.m_objectSize + 64) * parameters.m_numElements, policy);
+    MemoryManagerTarget<FreeListMemoryManager> target = { pool };
+
+    std::cout << harness.run(std::string(GetPolicyName(policy)) + " free list memory management", target).toString() << "\n";
+}
+
+//------------------------------------------------------------------------------
+void RunBatchFreeListMemoryManagement(const BenchmarkHarness & harness, FreeListMemoryManager::AllocationPolicy policy)
+{
+    const BenchmarkParameters & parameters = harness.getParameters();
+
+    // A burst of messages arrives at once, each iteration's elements are carved from one free block and given back together
+    FreeListMemoryManager pool((parameters.m_objectSize + 64) * parameters.m_numElements, policy);
+    MemoryManagerTarget<FreeListMemoryManager> target = { pool };
+
+    std::cout << harness.runBatch(std::string(GetPolicyName(policy)) + " free list memory management, in batches,", target).toString() << "\n";
+}
+
+//------------------------------------------------------------------------------
+void RunHeaderlessFreeListMemoryManagement(const BenchmarkHarness & harness, FreeListMemoryManager::HeaderPolicy headerPolicy)
+{
+    const BenchmarkParameters & parameters = harness.getParameters();
+
+    // Headers cost the header and the footer on top of the element, headerless blocks only the footer,
+    // but every block must still be large enough to become a free block again
+    const bool   headerless      = headerPolicy == FreeListMemoryManager::HeaderPolicy::Headerless;
+    const size_t elementSize     = RoundUp(parameters.m_objectSize, std::max<size_t>(parameters.getAlignment(), 8));
+    const size_t bytesPerElement = headerless ? std::max<size_t>(elementSize + 8, 32) : elementSize + 24;
+
+    // Over-aligned elements may need a gap in front of them
+    const size_t alignmentGap = parameters.getAlignment() > 8 ? parameters.getAlignment() : 0;
+
+    FreeListMemoryManager pool((bytesPerElement + alignmentGap) * parameters.m_numElements,
+                               FreeListMemoryManager::AllocationPolicy::FirstFit, BackingStore::Policy::Malloc, headerPolicy);
+    MemoryManagerTarget<FreeListMemoryManager> target = { pool };
+
+    std::cout << harness.run(std::string(headerless ? "headerless" : "headered") + " free list memory management, using "
+                             + std::to_string(bytesPerElement) + " bytes per element,", target).toString() << "\n";
+}
+
+//------------------------------------------------------------------------------
+void RunHeaderlessStackMemoryManagement(const BenchmarkHarness & harness, StackMemoryManager::HeaderPolicy headerPolicy)
+{
+    const BenchmarkParameters & parameters = harness.getParameters();
+
+    // Headers need room for the header and the worst case alignment, headerless allocations are only rounded to the granularity
+    const bool   headerless      = headerPolicy == StackMemoryManager::HeaderPolicy::Headerless;
+    const size_t bytesPerElement = headerless ? RoundUp(parameters.m_objectSize, StackMemoryManager::HEADERLESS_GRANULARITY)
+                                              : parameters.m_objectSize + 32;
+
+    StackMemoryManager pool(bytesPerElement * parameters.m_numElements, BackingStore::Policy::Malloc, headerPolicy);
+    MemoryManagerTarget<StackMemoryManager> target = { pool };
+
+    std::cout << harness.run(std::string(headerless ? "headerless" : "headered") + " stack memory management, using "
+                             + std::to_string(bytesPerElement) + " bytes per element,", target).toString() << "\n";
+}
+
+//------------------------------------------------------------------------------
+void RunFragmentedFreeListMemoryManagement(const BenchmarkHarness & harness, FreeListMemoryManager::AllocationPolicy policy)
+{
+    // Mixed sizes, where every other block is released and reallocated with a different size each round,
+    // so that the free list fills up with small holes that first fit has to walk past
+    const size_t sizes[] = { 16, 24, 48, 96, 200, 512 };
+    const size_t numSizes = sizeof(sizes) / sizeof(sizes[0]);
+
+    const BenchmarkParameters & parameters = harness.getParameters();
+
+    FreeListMemoryManager pool((512 + 64) * parameters.m_numElements * 2, policy);
+    std::vector<void *> array(parameters.m_numElements);
+
+    for( size_t j = 0; j < parameters.m_numElements; ++j )
     {
-        for( int i = 0; i < g_iterations; ++i )
-        {
-            // We need to add, in the worst case, 2x the size of the header for each element
-            // (because we need to still allow for the alignment of our type)
-            FreeListMemoryManager pool((sizeof(ComplexNumber) + 32) * g_numElements);
-            ComplexNumber * array[g_numElements];
+        array[j] = pool.allocate(sizes[j % numSizes], alignof(double));
+    }
 
-            // Allocate
-            for( int j = 0; j < g_numElements; ++j )
+    // Every run carries on from the holes the one before it left
+    const BenchmarkTiming timing = harness.time([&]()
+    {
+        for( size_t i = 0; i < parameters.m_iterations; ++i )
+        {
+            // Free
+            for( size_t j = i % 2; j < parameters.m_numElements; j += 2 )
             {
-                void * address = pool.allocate(sizeof(ComplexNumber), alignof(ComplexNumber));
-                array[j] = new(address) ComplexNumber(i, j);
+                pool.free(array[j]);
             }
 
-            // Free
-            for( int j = 0; j < g_numElements; ++j )
+            // Allocate
+            for( size_t j = i % 2; j < parameters.m_numElements; j += 2 )
             {
-                pool.free(array[j]);
+                array[j] = pool.allocate(sizes[(i + j) % numSizes], alignof(double));
             }
         }
-    }
+    });
 
-    // Stop the timer
-    double secondsElapsed = timer.Stop();
-    std::cout << "Test with linear memory management took " << secondsElapsed << " seconds.\n";
+    std::cout << "Test with " << GetPolicyName(policy) << " free list memory management on a fragmented workload took " << timing.toString() << ".\n";
+
+    for( void * address : array )
+    {
+        pool.free(address);
+    }
 }
 
 //------------------------------------------------------------------------------
-void RunDefaultAllocator()
+void RunRelocatableFreeListMemoryManagement(const BenchmarkHarness & harness, bool relocatable)
 {
-    // Start timer
-    Common::PerformanceTimer timer;
-    timer.Start();
+    // Objects of mixed sizes replaced at random, in a pool only a little larger than the bytes live at once,
+    // so that without compaction the free space ends up in holes too small for the larger objects
+    const size_t sizes[] = { 16, 24, 48, 96, 200, 512, 1024 };
+    const size_t numSizes      = sizeof(sizes) / sizeof(sizes[0]);
+    const BenchmarkParameters & parameters = harness.getParameters();
+    const size_t numOperations = parameters.m_iterations * 100;
 
-    // Do the Work
+    struct Object
     {
-        std::vector<ComplexNumber> myVector;
+        void *                        m_address;
+        FreeListMemoryManager::Handle m_handle;
+    };
+
+    size_t numFailures   = 0;
+    double fragmentation = 0.0;
 
-        for (int i = 0; i < g_iterations; i++)
+    // Every run starts from a new pool and the same random sequence, the failures and fragmentation are from the last
+    const BenchmarkTiming timing = harness.timePhases([&]()
+    {
+        FreeListMemoryManager pool(360 * parameters.m_numElements);
+        std::vector<Object> objects(parameters.m_numElements);
+        std::mt19937 random(12345);
+        numFailures = 0;
+
+        auto allocate = [&](Object & object, size_t size)
         {
-            for (int j = 0; j < g_numElements; j++)
+            try
             {
-                myVector.push_back(ComplexNumber(i, j));
+                if( relocatable )
+                {
+                    object.m_handle = pool.allocateRelocatable(size, alignof(double));
+                    std::memset(pool.resolve(object.m_handle), 0, size);
+                }
+                else
+                {
+                    object.m_address = pool.allocate(size, alignof(double));
+                    std::memset(object.m_address, 0, size);
+                }
+            }
+            catch( const Common::Exception & )
+            {
+                object.m_address = nullptr;
+                object.m_handle  = FreeListMemoryManager::Handle{ 0, 0 };
+                ++numFailures;
+            }
+        };
+
+        auto free = [&](Object & object)
+        {
+            if( relocatable && pool.isValid(object.m_handle) )
+            {
+                pool.freeRelocatable(object.m_handle);
+            }
+            else if( !relocatable && object.m_address )
+            {
+                pool.free(object.m_address);
             }
+        };
+
+        for( Object & object : objects )
+        {
+            allocate(object, sizes[random() % numSizes]);
         }
-    }
 
-    // Stop the timer
-    double secondsElapsed = timer.Stop();
-    std::cout << "Test with default allocator took " << secondsElapsed << " seconds.\n";
+        // Only the replacements are timed
+        Common::PerformanceTimer timer;
+        timer.Start();
+
+        for( size_t i = 0; i < numOperations; ++i )
+        {
+            Object & object = objects[random() % objects.size()];
+
+            free(object);
+            allocate(object, sizes[random() % numSizes]);
+        }
+
+        const std::vector<double> secondsElapsed(1, timer.Stop());
+        fragmentation = pool.getStatistics().m_fragmentation;
+
+        for( Object & object : objects )
+        {
+            free(object);
+        }
+
+        return secondsElapsed;
+    }).front();
+
+    std::cout << "Test with " << (relocatable ? "relocatable" : "fixed") << " allocations replaced at random in a nearly full free list took "
+              << timing.toString() << ", " << numFailures << " of " << numOperations << " allocations failed and fragmentation ended at "
+              << fragmentation << ".\n";
 }
 
 //------------------------------------------------------------------------------
-/*
-void RunCustomAllocator()
+void RunPurgeFreeListMemoryManagement(const BenchmarkHarness & harness, bool purge)
 {
-    // Start timer
-    Common::PerformanceTimer timer;
-    timer.Start();
+    // A burst of buffers fills most of a pool sized for it, they are all freed, then the program idles,
+    // calling decay() from its idle loop as a timer would. The next burst pays for faulting in what was purged.
+    const size_t poolSize  = 256 * 1024 * 1024;
+    const size_t burstSize = poolSize * 3 / 4;
+    const int    numTicks  = 10;    // Idle loop ticks per decay time
+    const std::chrono::milliseconds decayTime(100);
 
-    // Do the Work
-    IMemoryManager * memoryManager = new SimpleMemoryManager();
+    size_t burstResidentBytes = 0;
+    size_t idleResidentBytes  = 0;
+    size_t poolResidentBytes  = 0;
 
-    // We have to control the vector going out of scope before the memory manager goes out of scope
+    // Every run starts from a new pool and the same sizes, only the bursts are timed, the resident sizes are from the last
+    const std::vector<BenchmarkTiming> timings = harness.timePhases([&]()
     {
-        CustomAllocator<ComplexNumber> allocator(memoryManager);
-        std::vector<ComplexNumber, CustomAllocator<ComplexNumber> > myVector(allocator);
+        std::mt19937 random(42);
+        std::uniform_int_distribution<size_t> sizes(1024, 64 * 1024);
+
+        FreeListMemoryManager pool(poolSize, FreeListMemoryManager::AllocationPolicy::SegregatedFit);
+        pool.setDecay(decayTime);
 
-        for (int i = 0; i < g_iterations; i++)
+        auto runBurst = [&](int value)
         {
-            for (int j = 0; j < g_numElements; j++)
+            std::vector<void *> buffers;
+
+            Common::PerformanceTimer timer;
+            timer.Start();
+
+            for( size_t burstBytes = 0; burstBytes < burstSize; )
             {
-                myVector.push_back(ComplexNumber(i, j));
+                const size_t size = sizes(random);
+                buffers.push_back(pool.allocate(size, alignof(std::max_align_t)));
+                memset(buffers.back(), value, size);
+                burstBytes += size;
+
+                // The timer keeps firing during the burst, which must not purge the blocks in use
+                if( purge && buffers.size() % 1024 == 0 )
+                {
+                    pool.decay();
+                }
+            }
+
+            for( void * buffer : buffers )
+            {
+                pool.free(buffer);
+            }
+
+            return timer.Stop();
+        };
+
+        std::vector<double> secondsElapsed;
+        secondsElapsed.push_back(runBurst(1));
+        burstResidentBytes = BenchmarkHarness::getResidentSetSize();
+
+        // Idle for twice the decay time
+        for( int tick = 0; tick < 2 * numTicks; ++tick )
+        {
+            std::this_thread::sleep_for(decayTime / numTicks);
+
+            if( purge )
+            {
+                pool.decay();
             }
         }
-    }
 
-    delete memoryManager;
+        idleResidentBytes = BenchmarkHarness::getResidentSetSize();
+        poolResidentBytes = pool.getResidentBytes();
+        secondsElapsed.push_back(runBurst(2));
 
-    // Stop the timer
-    double secondsElapsed = timer.Stop();
-    std::cout << "Test with custom allocator using simple memory manager took " << secondsElapsed << " seconds.\n";
+        return secondsElapsed;
+    });
+
+    std::cout << "Test with a burst of " << burstSize / 1024 << " KiB of buffers, then idling, on free list memory management "
+              << (purge ? "with" : "without") << " decay took " << timings[0].toString() << " for the burst, RSS "
+              << burstResidentBytes / 1024 << " KiB after it and " << idleResidentBytes / 1024 << " KiB after idling, when "
+              << poolResidentBytes / 1024 << " of " << poolSize / 1024
+              << " KiB reserved were resident. The next burst took " << timings[1].toString() << ".\n";
 }
-*/
 
 //------------------------------------------------------------------------------
-int main(int argc, char * argv[])
+void RunRingBufferMemoryManagement(const BenchmarkHarness & harness)
+{
+    const BenchmarkParameters & parameters = harness.getParameters();
+
+    // Every block is the object rounded up to 16 bytes, plus a 16 byte header
+    RingBufferMemoryManager pool((RoundUp(parameters.m_objectSize, 16) + 16) * parameters.m_numElements);
+    MemoryManagerTarget<RingBufferMemoryManager> target = { pool };
+
+    std::cout << harness.run("ring buffer memory management", target).toString() << "\n";
+}
+
+//------------------------------------------------------------------------------
+void RunStreamingMemoryManagement(const BenchmarkHarness & harness, bool ringBuffer)
 {
-    RunNoMemoryManagement();
-//  RunLinearMemoryManagement();
-//  RunStackMemoryManagement();
-    RunFreeListMemoryManagement();
+    // Messages of mixed sizes arrive one at a time, and each is freed once the number of elements newer ones have arrived,
+    // give or take a few, as a pipeline with a little reordering between its stages would
+    const BenchmarkParameters & parameters = harness.getParameters();
+    const size_t numInFlight = parameters.m_numElements;
+    const size_t numMessages = numInFlight * parameters.m_iterations;
+    const size_t maxSize     = 1024;
+    const size_t reordering  = 4;
+
+    // Every run starts from a new pool and the same random sequence
+    const BenchmarkTiming timing = harness.timePhases([&]()
+    {
+        std::mt19937 random(42);
+        std::uniform_int_distribution<size_t> sizes(32, maxSize);
+
+        RingBufferMemoryManager ringPool((maxSize + 32) * (numInFlight + reordering));
+        FreeListMemoryManager freeListPool((maxSize + 64) * (numInFlight + reordering), FreeListMemoryManager::AllocationPolicy::SegregatedFit);
+        IMemoryManager & pool = ringBuffer ? static_cast<IMemoryManager &>(ringPool) : freeListPool;
+
+        std::deque<void *> messages;
+
+        // Start timer
+        Common::PerformanceTimer timer;
+        timer.Start();
+
+        // Do the work
+        for( size_t i = 0; i < numMessages; ++i )
+        {
+            messages.push_back(pool.allocate(sizes(random), alignof(std::max_align_t)));
+
+            if( messages.size() > numInFlight )
+            {
+                // Free one of the oldest few
+                const size_t index = random() % std::min(reordering, messages.size());
+                pool.free(messages[index]);
+                messages.erase(messages.begin() + index);
+            }
+        }
+
+        // Stop the timer
+        const std::vector<double> secondsElapsed(1, timer.Stop());
+
+        for( void * message : messages )
+        {
+            pool.free(message);
+        }
+
+        return secondsElapsed;
+    }).front();
+
+    std::cout << "Test with streaming messages freed in nearly FIFO order on " << (ringBuffer ? "ring buffer" : "segregated fit free list")
+              << " memory management took " << timing.toString() << ".\n";
+}
+
+//------------------------------------------------------------------------------
+void RunProducerConsumerMemoryManagement(const BenchmarkHarness & harness, bool lockFree)
+{
+    // One thread allocates messages and hands them to another, which frees them in order,
+    // with at most the number of elements messages in flight
+    const BenchmarkParameters & parameters = harness.getParameters();
+    const size_t numInFlight = parameters.m_numElements;
+    const size_t numMessages = numInFlight * GetThreadedIterations(parameters);
+    const size_t maxSize     = 1024;
+
+    // Every run starts from new pools and threads
+    const BenchmarkTiming timing = harness.timePhases([&]()
+    {
+        RingBufferMemoryManager ringPool((maxSize + 32) * numInFlight, RingBufferMemoryManager::ThreadingPolicy::SingleProducerSingleConsumer);
+        FreeListMemoryManager freeListPool((maxSize + 64) * numInFlight, FreeListMemoryManager::AllocationPolicy::SegregatedFit);
+        std::mutex mutex;
+
+        // Messages are handed over through this array, the counters say how far each side has got
+        std::vector<void *> messages(numMessages);
+        std::atomic<size_t> numProduced(0);
+        std::atomic<size_t> numConsumed(0);
+
+        auto produce = [&]()
+        {
+            std::mt19937 random(42);
+            std::uniform_int_distribution<size_t> sizes(32, maxSize);
+
+            for( size_t i = 0; i < numMessages; ++i )
+            {
+                const size_t size = sizes(random);
+                void * message = nullptr;
+
+                while( i - numConsumed.load(std::memory_order_acquire) >= numInFlight )
+                {
+                    std::this_thread::yield();
+                }
+
+                if( lockFree )
+                {
+                    // The ring can still be full of messages the consumer has not reached yet
+                    while( !(message = ringPool.tryAllocate(size, alignof(std::max_align_t))) )
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+                else
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    message = freeListPool.allocate(size, alignof(std::max_align_t));
+                }
+
+                memset(message, static_cast<int>(i), size);
+                messages[i] = message;
+                numProduced.store(i + 1, std::memory_order_release);
+            }
+        };
+
+        auto consume = [&]()
+        {
+            for( size_t i = 0; i < numMessages; ++i )
+            {
+                while( numProduced.load(std::memory_order_acquire) <= i )
+                {
+                    std::this_thread::yield();
+                }
+
+                if( lockFree )
+                {
+                    ringPool.free(messages[i]);
+                }
+                else
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    freeListPool.free(messages[i]);
+                }
+
+                numConsumed.store(i + 1, std::memory_order_release);
+            }
+        };
+
+        // Start timer
+        Common::PerformanceTimer timer;
+        timer.Start();
+
+        // Do the work
+        {
+            std::thread producer(produce);
+            std::thread consumer(consume);
+
+            producer.join();
+            consumer.join();
+        }
+
+        // Stop the timer
+        return std::vector<double>(1, timer.Stop());
+    }).front();
+
+    std::cout << "Test with a producer and a consumer thread on " << (lockFree ? "lock free ring buffer" : "mutex guarded free list")
+              << " memory management took " << timing.toString() << ".\n";
+}
+
+//------------------------------------------------------------------------------
+// Bounded queue handing messages from one thread to the next
+struct MessageQueue
+{
+    std::vector<void *> m_messages;
+    alignas(64) std::atomic<size_t> m_numPushed;   // Only written by the pushing thread
+    alignas(64) std::atomic<size_t> m_numPopped;   // Only written by the popping thread
+
+    MessageQueue(size_t capacity)
+        :
+        m_messages(capacity)
+      , m_numPushed(0)
+      , m_numPopped(0)
+    {
+    }
+
+    bool tryPush(void * message)
+    {
+        const size_t numPushed = m_numPushed.load(std::memory_order_relaxed);
+
+        if( numPushed - m_numPopped.load(std::memory_order_acquire) == m_messages.size() )
+        {
+            return false;
+        }
+
+        m_messages[numPushed % m_messages.size()] = message;
+        m_numPushed.store(numPushed + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    bool tryPop(void *& message)
+    {
+        const size_t numPopped = m_numPopped.load(std::memory_order_relaxed);
+
+        if( numPopped == m_numPushed.load(std::memory_order_acquire) )
+        {
+            return false;
+        }
+
+        message = m_messages[numPopped % m_messages.size()];
+        m_numPopped.store(numPopped + 1, std::memory_order_release);
+
+        return true;
+    }
+};
+
+//------------------------------------------------------------------------------
+// Every stage of the pipeline allocates messages and hands nine in ten of them to the next stage, which frees them,
+// so most frees happen on a different thread than the allocation. The last stage hands its messages to the first.
+template <class Target>
+void RunPipeline(const BenchmarkHarness & harness, Target & target, const std::string & name, size_t numStages)
+{
+    const BenchmarkParameters & parameters = harness.getParameters();
+    const size_t numMessages = std::max<size_t>(1, parameters.m_numElements * GetThreadedIterations(parameters) / numStages);
+    const size_t maxSize     = 256;
+
+    // Every run starts from new queues and threads, the memory manager is reused, as every run frees all it allocates
+    const BenchmarkTiming timing = harness.timePhases([&]()
+    {
+        std::vector<std::unique_ptr<MessageQueue>> queues;
+
+        for( size_t stage = 0; stage < numStages; ++stage )
+        {
+            queues.emplace_back(new MessageQueue(parameters.m_numElements));
+        }
+
+        auto run = [&](size_t stage)
+        {
+            MessageQueue & input  = *queues[(stage + numStages - 1) % numStages];
+            MessageQueue & output = *queues[stage];
+
+            std::mt19937 random(static_cast<unsigned int>(stage));
+            std::uniform_int_distribution<size_t> sizes(16, maxSize);
+
+            // Frees whatever the previous stage has handed over so far
+            auto consume = [&]()
+            {
+                void * message;
+
+                while( input.tryPop(message) )
+                {
+                    target.free(message, *static_cast<size_t *>(message), alignof(std::max_align_t));
+                }
+            };
+
+            for( size_t i = 0; i < numMessages; ++i )
+            {
+                const size_t size = sizes(random);
+                void * message = target.allocate(size, alignof(std::max_align_t));
+                memset(message, static_cast<int>(i), size);
+
+                // Messages start with their size, so that the stage freeing them can give it to the memory manager
+                *static_cast<size_t *>(message) = size;
+
+                if( i % 10 == 0 )
+                {
+                    target.free(message, size, alignof(std::max_align_t));
+                }
+                else
+                {
+                    // Keep freeing while the next stage catches up, so that stages never wait on each other in a circle
+                    while( !output.tryPush(message) )
+                    {
+                        consume();
+                        std::this_thread::yield();
+                    }
+                }
+
+                consume();
+            }
+
+            // The previous stage hands over all but one in ten of its messages
+            const size_t numExpected = numMessages - (numMessages + 9) / 10;
+
+            while( input.m_numPopped.load(std::memory_order_relaxed) < numExpected )
+            {
+                consume();
+                std::this_thread::yield();
+            }
+        };
+
+        // Start timer
+        Common::PerformanceTimer timer;
+        timer.Start();
+
+        // Do the work
+        {
+            std::vector<std::thread> threads;
+
+            for( size_t stage = 0; stage < numStages; ++stage )
+            {
+                threads.emplace_back(run, stage);
+            }
+
+            for( std::thread & thread : threads )
+            {
+                thread.join();
+            }
+        }
+
+        // Stop the timer
+        return std::vector<double>(1, timer.Stop());
+    }).front();
+
+    std::cout << "Test with a pipeline of " << numStages << " threads freeing each other's messages on " << name
+              << " took " << timing.toString() << ".\n";
+}
+
+//------------------------------------------------------------------------------
+void RunPipelineMemoryManagement(const BenchmarkHarness & harness, size_t numStages)
+{
+    // Room for every message in flight, plus whatever the thread caches are holding on to,
+    // which is at least a slab of 16 KiB for each of the 16 size classes the messages fall in, however few there are
+    const size_t poolSize = (256 + 64) * harness.getParameters().m_numElements * (numStages + 1) * 2 + 16 * (16 + 1) * 1024;
+
+    {
+        SystemTarget target;
+        RunPipeline(harness, target, "no memory management", numStages);
+    }
+
+    {
+        FreeListMemoryManager sharedPool(poolSize, FreeListMemoryManager::AllocationPolicy::SegregatedFit);
+        LockedTarget<FreeListMemoryManager> target(sharedPool);
+        RunPipeline(harness, target, "mutex guarded free list memory management", numStages);
+    }
+
+    {
+        FreeListMemoryManager sharedPool(poolSize, FreeListMemoryManager::AllocationPolicy::SegregatedFit);
+        ThreadCachingMemoryManager threadCachingPool(sharedPool);
+        MemoryManagerTarget<ThreadCachingMemoryManager> target = { threadCachingPool };
+        RunPipeline(harness, target, "thread caching memory management", numStages);
+    }
+
+    {
+        // Each arena holds its own stage's messages in flight, and those the next stage has not freed yet
+        ThreadArenaMemoryManager threadArenaPool(poolSize / numStages);
+        MemoryManagerTarget<ThreadArenaMemoryManager> target = { threadArenaPool };
+        RunPipeline(harness, target, "thread arena memory management with remote free lists", numStages);
+
+        std::cout << "    " << threadArenaPool.getRemoteFreeCount() << " of " << threadArenaPool.getStatistics().m_totalFrees
+                  << " frees over all runs were pushed onto another thread's remote free list.\n";
+    }
+}
+
+//------------------------------------------------------------------------------
+void RunFreeOrderMemoryManagement(const BenchmarkParameters & parameters, FreeOrder order, size_t numElements)
+{
+    const char * orderNames[] = { "FIFO", "LIFO", "random" };
+
+    // Keep the total amount of work the same, regardless of the number of elements
+    BenchmarkParameters orderParameters(parameters);
+    orderParameters.m_numElements = numElements;
+    orderParameters.m_iterations  = std::max<size_t>(1, parameters.m_iterations * parameters.m_numElements / numElements);
+    orderParameters.m_freeOrder   = order;
+
+    FreeListMemoryManager pool((parameters.m_objectSize + 64) * numElements);
+    MemoryManagerTarget<FreeListMemoryManager> target = { pool };
+
+    const std::string name = "free list memory management, freeing " + std::to_string(numElements) + " elements in "
+                           + orderNames[static_cast<int>(order)] + " order,";
+    std::cout << BenchmarkHarness(orderParameters).run(name, target).toString() << "\n";
+}
+
+//------------------------------------------------------------------------------
+void RunReallocateMemoryManagement(const BenchmarkHarness & harness, bool inPlace)
+{
+    // A message buffer that grows a chunk at a time, as it is filled
+    const size_t chunkSize = 64;
+    const size_t numChunks = 64;
+
+    FreeListMemoryManager pool((chunkSize * numChunks + 64) * 4);
+
+    const BenchmarkTiming timing = harness.time([&]()
+    {
+        for( size_t i = 0; i < harness.getParameters().m_iterations; ++i )
+        {
+            uint8_t * buffer = static_cast<uint8_t *>(pool.allocate(chunkSize, alignof(uint64_t)));
+            std::memset(buffer, static_cast<int>(i), chunkSize);
+
+            for( size_t size = chunkSize * 2; size <= chunkSize * numChunks; size += chunkSize )
+            {
+                if( inPlace )
+                {
+                    buffer = static_cast<uint8_t *>(pool.reallocate(buffer, size, alignof(uint64_t)));
+                }
+                else
+                {
+                    uint8_t * newBuffer = static_cast<uint8_t *>(pool.allocate(size, alignof(uint64_t)));
+                    std::memcpy(newBuffer, buffer, size - chunkSize);
+                    pool.free(buffer);
+
+                    buffer = newBuffer;
+                }
+
+                std::memset(buffer + size - chunkSize, static_cast<int>(i), chunkSize);
+            }
+
+            pool.free(buffer);
+        }
+    });
+
+    std::cout << "Test growing buffers with " << (inPlace ? "reallocate" : "allocate, copy and free")
+              << " on free list memory management took " << timing.toString() << ".\n";
+}
+
+//------------------------------------------------------------------------------
+// A hash index kept in a persistent heap, linked by offset so that it is valid wherever the heap is mapped
+struct PersistentIndexNode
+{
+    uint64_t                           m_key;
+    uint64_t                           m_value;
+    OffsetPointer<PersistentIndexNode> m_next;
+};
+
+struct PersistentIndex
+{
+    size_t                                             m_numBuckets;
+    size_t                                             m_numEntries;
+    OffsetPointer<OffsetPointer<PersistentIndexNode>>  m_buckets;
+};
+
+//------------------------------------------------------------------------------
+// Spreads consecutive numbers over the whole range, so that they make keys that hash well
+uint64_t MixKey(uint64_t value)
+{
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+
+//------------------------------------------------------------------------------
+const PersistentIndexNode * FindInPersistentIndex(const PersistentIndex & index, uint64_t key)
+{
+    const PersistentIndexNode * node = index.m_buckets.get()[key % index.m_numBuckets].get();
+
+    while( node && node->m_key != key )
+    {
+        node = node->m_next.get();
+    }
+
+    return node;
+}
+
+//------------------------------------------------------------------------------
+void RunPersistentMemoryManagement(const BenchmarkHarness & harness)
+{
+    // A service that needs a large index before it can answer anything, either built again at startup
+    // or mapped back from the heap the last run left behind
+    const size_t      numEntries = harness.getParameters().m_numElements * GetThreadedIterations(harness.getParameters());
+    const size_t      numLookups = harness.getParameters().m_numElements;
+    const size_t      heapSize   = numEntries * 64 + numEntries * sizeof(OffsetPointer<PersistentIndexNode>) + 1024 * 1024;
+    const std::string path       = (std::filesystem::temp_directory_path() / "MemoryManagementPersistentHeap.bin").string();
+
+    size_t numFound = 0;
+
+    // Every run creates the heap again, the lookups are from the last run
+    const std::vector<BenchmarkTiming> timings = harness.timePhases([&]()
+    {
+        std::vector<double> secondsElapsed;
+
+        // Start timer
+        Common::PerformanceTimer timer;
+        timer.Start();
+
+        // Do the work
+        {
+            PersistentMemoryManager heap(path, heapSize, PersistentMemoryManager::OpenMode::Create);
+
+            PersistentIndex * index = new (heap.allocate(sizeof(PersistentIndex), alignof(PersistentIndex))) PersistentIndex();
+            index->m_numBuckets = numEntries;
+            index->m_numEntries = numEntries;
+            index->m_buckets    = static_cast<OffsetPointer<PersistentIndexNode> *>(
+                heap.allocate(sizeof(OffsetPointer<PersistentIndexNode>) * numEntries, alignof(OffsetPointer<PersistentIndexNode>)));
+
+            for( size_t bucket = 0; bucket < numEntries; ++bucket )
+            {
+                new (&index->m_buckets.get()[bucket]) OffsetPointer<PersistentIndexNode>();
+            }
+
+            for( size_t entry = 0; entry < numEntries; ++entry )
+            {
+                PersistentIndexNode * node = new (heap.allocate(sizeof(PersistentIndexNode), alignof(PersistentIndexNode))) PersistentIndexNode();
+                node->m_key   = MixKey(entry);
+                node->m_value = entry;
+
+                OffsetPointer<PersistentIndexNode> & bucket = index->m_buckets.get()[node->m_key % numEntries];
+                node->m_next = bucket;
+                bucket       = node;
+            }
+
+            heap.setRoot(index);
+            secondsElapsed.push_back(timer.Stop());
+
+            timer.Start();
+            heap.flush();
+            secondsElapsed.push_back(timer.Stop());
+        }
+
+        // The restart, the index is ready once the file is mapped, only the pages the lookups touch are read
+        timer.Start();
+        numFound = 0;
+
+        {
+            PersistentMemoryManager heap(path, 0, PersistentMemoryManager::OpenMode::OpenExisting);
+            const PersistentIndex * index = static_cast<const PersistentIndex *>(heap.getRoot());
+
+            std::mt19937 random(12345);
+
+            for( size_t lookup = 0; lookup < numLookups; ++lookup )
+            {
+                const uint64_t              entry = random() % index->m_numEntries;
+                const PersistentIndexNode * node  = FindInPersistentIndex(*index, MixKey(entry));
+
+                if( node && node->m_value == entry )
+                {
+                    ++numFound;
+                }
+            }
+        }
+
+        // Stop the timer
+        secondsElapsed.push_back(timer.Stop());
+
+        return secondsElapsed;
+    });
+
+    std::cout << "Test with rebuilding an index of " << numEntries << " entries from scratch in a persistent heap took "
+              << timings[0].toString() << ".\n";
+    std::cout << "Test with flushing the persistent heap to its file took " << timings[1].toString() << ".\n";
+    std::cout << "Test with reopening the persistent heap and looking up " << numLookups << " entries took "
+              << timings[2].toString() << ", " << numFound << " were found.\n";
+
+    std::filesystem::remove(path);
+}
+
+//------------------------------------------------------------------------------
+void RunBuddyMemoryManagement(const BenchmarkHarness & harness)
+{
+    const BenchmarkParameters & parameters = harness.getParameters();
+
+    // Every object takes a whole block, rounding up to a power of two at most doubles its size
+    BuddyMemoryManager pool(2 * std::max<size_t>(parameters.m_objectSize, 16) * parameters.m_numElements, 16);
+    MemoryManagerTarget<BuddyMemoryManager> target = { pool };
+
+    std::cout << harness.run("buddy memory management", target).toString() << "\n";
+}
+
+//------------------------------------------------------------------------------
+void RunPoolMemoryManagement(const BenchmarkHarness & harness)
+{
+    const BenchmarkParameters & parameters = harness.getParameters();
+
+    // Every block is exactly one element, there is no per block header to pad for
+    PoolMemoryManager pool(parameters.m_objectSize, parameters.getAlignment(), parameters.m_numElements);
+    MemoryManagerTarget<PoolMemoryManager> target = { pool };
+
+    std::cout << harness.run("pool memory management", target).toString() << "\n";
+}
+
+//------------------------------------------------------------------------------
+void RunBatchPoolMemoryManagement(const BenchmarkHarness & harness)
+{
+    const BenchmarkParameters & parameters = harness.getParameters();
+
+    PoolMemoryManager pool(parameters.m_objectSize, parameters.getAlignment(), parameters.m_numElements);
+    MemoryManagerTarget<PoolMemoryManager> target = { pool };
+
+    std::cout << harness.runBatch("pool memory management, in batches,", target).toString() << "\n";
+}
+
+//------------------------------------------------------------------------------
+void RunThreadedMemoryManagement(const BenchmarkParameters & parameters, size_t numThreads, bool useThreadCache)
+{
+    // Each thread does the same amount of work, so perfect scaling keeps the time per operation constant
+    BenchmarkParameters threadedParameters(parameters);
+    threadedParameters.m_numThreads = numThreads;
+
+    // Room for every thread's elements, plus whatever the thread caches are holding on to,
+    // which is at least a magazine of 64 blocks and a slab of 16 KiB for each thread however few elements there are
+    const size_t cachedElements = std::max<size_t>(parameters.m_numElements, 64);
+    FreeListMemoryManager sharedPool((parameters.m_objectSize + 64) * cachedElements * (numThreads + 1) * 2 + (16 + 1) * 1024 * (numThreads + 1));
+    const std::string name = std::to_string(numThreads) + " threads and " + (useThreadCache ? "thread caching" : "mutex guarded free list")
+                           + " memory management";
+
+    if( useThreadCache )
+    {
+        ThreadCachingMemoryManager threadCachingPool(sharedPool);
+        MemoryManagerTarget<ThreadCachingMemoryManager> target = { threadCachingPool };
+
+        std::cout << BenchmarkHarness(threadedParameters).run(name, target).toString() << "\n";
+    }
+    else
+    {
+        LockedTarget<FreeListMemoryManager> target(sharedPool);
+        std::cout << BenchmarkHarness(threadedParameters).run(name, target).toString() << "\n";
+    }
+}
+
+//------------------------------------------------------------------------------
+void RunConcurrentLinearMemoryManagement(const BenchmarkHarness & harness, size_t numThreads, bool lockFree)
+{
+    // Every thread fills its share of the same arena
+    const BenchmarkParameters & parameters = harness.getParameters();
+    const size_t  elementSize       = RoundUp(GetElementSize(parameters), GetElementAlignment(parameters));
+    const uint8_t elementAlignment  = GetElementAlignment(parameters);
+    const size_t  elementsPerThread = std::max<size_t>(1, parameters.m_numElements * GetThreadedIterations(parameters) / 10);
+
+    ConcurrentLinearMemoryManager concurrentPool(elementSize * elementsPerThread * numThreads + elementAlignment);
+    LinearMemoryManager pool(elementSize * elementsPerThread * numThreads + elementAlignment);
+    std::mutex mutex;
+
+    auto work = [&]()
+    {
+        for( size_t j = 0; j < elementsPerThread; ++j )
+        {
+            void * address;
+
+            if( lockFree )
+            {
+                address = concurrentPool.allocate(elementSize, elementAlignment);
+            }
+            else
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                address = pool.allocate(elementSize, elementAlignment);
+            }
+
+            new(address) ComplexNumber(0, j);
+        }
+    };
+
+    const BenchmarkTiming timing = harness.time([&]()
+    {
+        std::vector<std::thread> threads;
+
+        for( size_t t = 0; t < numThreads; ++t )
+        {
+            threads.emplace_back(work);
+        }
+
+        for( std::thread & thread : threads )
+        {
+            thread.join();
+        }
+
+        // Must release all at once
+        concurrentPool.clear();
+        pool.clear();
+    });
+
+    std::cout << "Test with " << numThreads << " threads and " << (lockFree ? "lock free concurrent linear" : "mutex guarded linear")
+              << " memory management took " << timing.toString() << ".\n";
+}
+
+//------------------------------------------------------------------------------
+void RunMemoryResourceVector(const BenchmarkHarness & harness, std::pmr::memory_resource & resource, const std::function<void()> & release, const char * name)
+{
+    const BenchmarkParameters & parameters = harness.getParameters();
+
+    const BenchmarkTiming timing = harness.time([&]()
+    {
+        for (size_t i = 0; i < parameters.m_iterations; i++)
+        {
+            {
+                // Reserve up front, so that there is a single allocation, which any memory resource can handle
+                std::pmr::vector<ComplexNumber> myVector(&resource);
+                myVector.reserve(parameters.m_numElements);
+
+                for (size_t j = 0; j < parameters.m_numElements; j++)
+                {
+                    myVector.push_back(ComplexNumber(i, j));
+                }
+            }
+
+            release();
+        }
+    });
+
+    std::cout << "Test with std::pmr::vector using " << name << " took " << timing.toString() << ".\n";
+}
+
+//------------------------------------------------------------------------------
+void RunMemoryResourceUnorderedMap(const BenchmarkHarness & harness, std::pmr::memory_resource & resource, const std::function<void()> & release, const char * name)
+{
+    // Long enough to not fit in the small string buffer
+    const char * value = "a value that is too long for the small string optimization";
+
+    const BenchmarkParameters & parameters = harness.getParameters();
+
+    const BenchmarkTiming timing = harness.time([&]()
+    {
+        for (size_t i = 0; i < GetThreadedIterations(parameters); i++)
+        {
+            {
+                std::pmr::unordered_map<int, std::pmr::string> myMap(&resource);
+
+                for (int j = 0; j < static_cast<int>(parameters.m_numElements); j++)
+                {
+                    myMap.emplace(j, value);
+                }
+
+                for (int j = 0; j < static_cast<int>(parameters.m_numElements); j += 2)
+                {
+                    myMap.erase(j);
+                }
+            }
+
+            release();
+        }
+    });
+
+    std::cout << "Test with std::pmr::unordered_map of std::pmr::string using " << name << " took " << timing.toString() << ".\n";
+}
+
+//------------------------------------------------------------------------------
+void RunMemoryResources(const BenchmarkHarness & harness)
+{
+    const size_t poolSize = 1024 * 1024;
+    const std::function<void()> nothingToRelease = [](){};
+
+    FreeListMemoryManager freeListPool(poolSize);
+    LinearMemoryManager   linearPool(poolSize);
+    StackMemoryManager    stackPool(poolSize);
+
+    FreeListMemoryResource freeListResource(freeListPool);
+    LinearMemoryResource   linearResource(linearPool);
+    StackMemoryResource    stackResource(stackPool);
+
+    std::pmr::monotonic_buffer_resource     monotonicResource(poolSize);
+    std::pmr::unsynchronized_pool_resource poolResource;
+
+    const std::function<void()> clearLinear      = [&](){ linearPool.clear(); };
+    const std::function<void()> releaseMonotonic = [&](){ monotonicResource.release(); };
+
+    RunMemoryResourceVector(harness, freeListResource, nothingToRelease, "free list memory resource");
+    RunMemoryResourceVector(harness, linearResource, clearLinear, "linear memory resource");
+    RunMemoryResourceVector(harness, stackResource, nothingToRelease, "stack memory resource");
+    RunMemoryResourceVector(harness, monotonicResource, releaseMonotonic, "std::pmr::monotonic_buffer_resource");
+    RunMemoryResourceVector(harness, poolResource, nothingToRelease, "std::pmr::unsynchronized_pool_resource");
+
+    // Hash maps free their nodes in no particular order, which the stack memory resource cannot handle
+    RunMemoryResourceUnorderedMap(harness, freeListResource, nothingToRelease, "free list memory resource");
+    RunMemoryResourceUnorderedMap(harness, linearResource, clearLinear, "linear memory resource");
+    RunMemoryResourceUnorderedMap(harness, monotonicResource, releaseMonotonic, "std::pmr::monotonic_buffer_resource");
+    RunMemoryResourceUnorderedMap(harness, poolResource, nothingToRelease, "std::pmr::unsynchronized_pool_resource");
+}
+
+//------------------------------------------------------------------------------
+void RunDefaultAllocator(const BenchmarkHarness & harness)
+{
+    const BenchmarkParameters & parameters = harness.getParameters();
+
+    // Start timer
+    Common::PerformanceTimer timer;
+    timer.Start();
+
+    // Do the Work
+    {
+        std::vector<ComplexNumber> myVector;
+
+        for (size_t i = 0; i < parameters.m_iterations; i++)
+        {
+            for (size_t j = 0; j < parameters.m_numElements; j++)
+            {
+                myVector.push_back(ComplexNumber(i, j));
+            }
+        }
+    }
+
+    // Stop the timer
+    double secondsElapsed = timer.Stop();
+    std::cout << "Test with default allocator took " << secondsElapsed << " seconds.\n";
+}
+
+//------------------------------------------------------------------------------
+void RunCustomAllocator(const BenchmarkHarness & harness)
+{
+    const BenchmarkParameters & parameters = harness.getParameters();
+
+    const BenchmarkTiming timing = harness.time([&]()
+    {
+        // Room for the vector at its largest, plus the buffer it is growing out of
+        IMemoryManager * memoryManager = new FreeListMemoryManager(sizeof(ComplexNumber) * parameters.m_iterations * parameters.m_numElements * 4,
+                                                                   FreeListMemoryManager::AllocationPolicy::SegregatedFit);
+
+        // We have to control the vector going out of scope before the memory manager goes out of scope
+        {
+            CustomAllocator<ComplexNumber> allocator(memoryManager);
+            std::vector<ComplexNumber, CustomAllocator<ComplexNumber> > myVector(allocator);
+
+            for (size_t i = 0; i < parameters.m_iterations; i++)
+            {
+                for (size_t j = 0; j < parameters.m_numElements; j++)
+                {
+                    myVector.push_back(ComplexNumber(i, j));
+                }
+            }
+        }
+
+        delete memoryManager;
+    });
+
+    std::cout << "Test with custom allocator using free list memory manager took " << timing.toString() << ".\n";
+}
+
+//------------------------------------------------------------------------------
+// Times each phase of a node based container's life separately, over many containers
+struct ContainerTimings
+{
+    double m_insert   = 0;
+    double m_lookup   = 0;
+    double m_erase    = 0;
+    double m_teardown = 0;
+    double m_checksum = 0;   // Sum of what the lookups read, printed so that they cannot be optimised away
+};
+
+//------------------------------------------------------------------------------
+// Workload returns the ContainerTimings of one run, each phase is reported over the harness's timed runs
+template <class Workload>
+void RunContainer(const BenchmarkHarness & harness, const char * containerName, const char * allocatorName, Workload workload)
+{
+    double checksum = 0;
+
+    const std::vector<BenchmarkTiming> timings = harness.timePhases([&]()
+    {
+        const ContainerTimings run = workload();
+        checksum = run.m_checksum;
+
+        return std::vector<double>{ run.m_insert, run.m_lookup, run.m_erase, run.m_teardown };
+    });
+
+    std::cout << "Test with " << containerName << " using " << allocatorName << " took "
+              << timings[0].toString() << " to insert, " << timings[1].toString() << " to look up, "
+              << timings[2].toString() << " to erase and " << timings[3].toString() << " to tear down, checksum "
+              << checksum << ".\n";
+}
+
+//------------------------------------------------------------------------------
+template <class Container, class Allocator>
+ContainerTimings RunSequenceContainer(const BenchmarkParameters & parameters, const Allocator & allocator)
+{
+    ContainerTimings timings;
+    Common::PerformanceTimer timer;
+
+    for (size_t i = 0; i < GetThreadedIterations(parameters); ++i)
+    {
+        Container * container = new Container(allocator);
+
+        timer.Start();
+
+        for (size_t j = 0; j < parameters.m_numElements; ++j)
+        {
+            container->push_back(ComplexNumber(i, j));
+        }
+
+        timings.m_insert += timer.Stop();
+        timer.Start();
+
+        double checksum = 0;
+
+        for (const ComplexNumber & element : *container)
+        {
+            checksum += element.getRealPart() + element.getComplexPart();
+        }
+
+        timings.m_lookup   += timer.Stop();
+        timings.m_checksum += checksum;
+        timer.Start();
+
+        for (size_t j = 0; j < parameters.m_numElements / 2; ++j)
+        {
+            container->pop_front();
+        }
+
+        timings.m_erase += timer.Stop();
+        timer.Start();
+
+        delete container;
+
+        timings.m_teardown += timer.Stop();
+    }
+
+    return timings;
+}
+
+//------------------------------------------------------------------------------
+template <class Container, class Allocator>
+ContainerTimings RunAssociativeContainer(const BenchmarkParameters & parameters, const Allocator & allocator)
+{
+    const int numElements = static_cast<int>(parameters.m_numElements);
+
+    ContainerTimings timings;
+    Common::PerformanceTimer timer;
+
+    for (size_t i = 0; i < GetThreadedIterations(parameters); ++i)
+    {
+        Container * container = new Container(allocator);
+
+        timer.Start();
+
+        for (int j = 0; j < numElements; ++j)
+        {
+            container->emplace(j, ComplexNumber(i, j));
+        }
+
+        timings.m_insert += timer.Stop();
+        timer.Start();
+
+        size_t found = 0;
+
+        for (int j = 0; j < numElements; ++j)
+        {
+            found += container->count(j);
+        }
+
+        timings.m_lookup   += timer.Stop();
+        timings.m_checksum += found;
+        timer.Start();
+
+        for (int j = 0; j < numElements; j += 2)
+        {
+            container->erase(j);
+        }
+
+        timings.m_erase += timer.Stop();
+        timer.Start();
+
+        delete container;
+
+        timings.m_teardown += timer.Stop();
+    }
+
+    return timings;
+}
+
+//------------------------------------------------------------------------------
+// Allocator is any allocator of ComplexNumber, it is rebound for each container
+// Fixed size memory managers can only serve containers that allocate nothing but nodes
+template <class Allocator>
+void RunNodeContainers(const BenchmarkHarness & harness, const Allocator & allocator, const char * allocatorName, bool nodesOnly = false)
+{
+    typedef std::pair<const int, ComplexNumber> Pair;
+    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Pair> PairAllocator;
+
+    typedef std::list<ComplexNumber, Allocator>                                            List;
+    typedef std::map<int, ComplexNumber, std::less<int>, PairAllocator>                    Map;
+    typedef std::unordered_map<int, ComplexNumber, std::hash<int>, std::equal_to<int>, PairAllocator> UnorderedMap;
+    typedef std::deque<ComplexNumber, Allocator>                                           Deque;
+
+    const BenchmarkParameters & parameters = harness.getParameters();
+
+    RunContainer(harness, "std::list", allocatorName, [&]() { return RunSequenceContainer<List>(parameters, allocator); });
+    RunContainer(harness, "std::map", allocatorName, [&]() { return RunAssociativeContainer<Map>(parameters, PairAllocator(allocator)); });
+
+    if (!nodesOnly)
+    {
+        RunContainer(harness, "std::unordered_map", allocatorName, [&]() { return RunAssociativeContainer<UnorderedMap>(parameters, PairAllocator(allocator)); });
+        RunContainer(harness, "std::deque", allocatorName, [&]() { return RunSequenceContainer<Deque>(parameters, allocator); });
+    }
+}
+
+//------------------------------------------------------------------------------
+void RunCustomAllocatorNodeContainers(const BenchmarkHarness & harness)
+{
+    const size_t poolSize = 4 * 1024 * 1024;
+
+    FreeListMemoryManager firstFitPool(poolSize, FreeListMemoryManager::AllocationPolicy::FirstFit);
+    FreeListMemoryManager segregatedFitPool(poolSize, FreeListMemoryManager::AllocationPolicy::SegregatedFit);
+    FreeListMemoryManager sharedPool(poolSize);
+    ThreadCachingMemoryManager threadCachingPool(sharedPool);
+
+    // Large enough for a list or map node holding a ComplexNumber
+    PoolMemoryManager pool(64, alignof(std::max_align_t), harness.getParameters().m_numElements, true);
+
+    RunNodeContainers(harness, std::allocator<ComplexNumber>(), "std::allocator");
+    RunNodeContainers(harness, CustomAllocator<ComplexNumber>(&firstFitPool), "first fit free list memory manager");
+    RunNodeContainers(harness, CustomAllocator<ComplexNumber>(&segregatedFitPool), "segregated fit free list memory manager");
+    RunNodeContainers(harness, CustomAllocator<ComplexNumber>(&threadCachingPool), "thread caching memory manager");
+    RunNodeContainers(harness, CustomAllocator<ComplexNumber>(&pool), "pool memory manager", true);
+}
+
+//------------------------------------------------------------------------------
+// Allocates and frees one element at a time through the allocator, so that the cost of the call itself dominates
+template <class Allocator>
+void RunAllocatorDispatch(const BenchmarkHarness & harness, Allocator allocator, const std::function<void()> & release, const char * name)
+{
+    const BenchmarkParameters & parameters = harness.getParameters();
+
+    const BenchmarkTiming timing = harness.time([&]()
+    {
+        std::vector<ComplexNumber *> array(parameters.m_numElements);
+
+        for( size_t i = 0; i < parameters.m_iterations; ++i )
+        {
+            // Allocate
+            for( size_t j = 0; j < parameters.m_numElements; ++j )
+            {
+                array[j] = new(allocator.allocate(1)) ComplexNumber(i, j);
+            }
+
+            // Free
+            for( ComplexNumber * element : array )
+            {
+                allocator.deallocate(element, 1);
+            }
+
+            release();
+        }
+    });
+
+    std::cout << "Test with " << name << " took " << timing.toString() << ".\n";
+}
+
+//------------------------------------------------------------------------------
+// Compares calling through IMemoryManager with calling the concrete memory manager, with and without validation
+void RunStaticDispatch(const BenchmarkHarness & harness)
+{
+    const size_t numElements = harness.getParameters().m_numElements;
+
+    auto nothing = []() {};
+
+    {
+        PoolMemoryManager pool(sizeof(ComplexNumber), alignof(ComplexNumber), numElements);
+
+        RunAllocatorDispatch(harness, CustomAllocator<ComplexNumber>(&pool), nothing, "pool through IMemoryManager");
+        RunAllocatorDispatch(harness, StaticAllocator<ComplexNumber, PoolMemoryManager, CheckedValidation>(&pool), nothing, "pool with static dispatch, checked");
+        RunAllocatorDispatch(harness, StaticAllocator<ComplexNumber, PoolMemoryManager, UncheckedValidation>(&pool), nothing, "pool with static dispatch, unchecked");
+    }
+
+    {
+        FreeListMemoryManager pool((sizeof(ComplexNumber) + 64) * numElements, FreeListMemoryManager::AllocationPolicy::SegregatedFit);
+
+        RunAllocatorDispatch(harness, CustomAllocator<ComplexNumber>(&pool), nothing, "free list through IMemoryManager");
+        RunAllocatorDispatch(harness, StaticAllocator<ComplexNumber, FreeListMemoryManager, CheckedValidation>(&pool), nothing, "free list with static dispatch, checked");
+        RunAllocatorDispatch(harness, StaticAllocator<ComplexNumber, FreeListMemoryManager, UncheckedValidation>(&pool), nothing, "free list with static dispatch, unchecked");
+    }
+
+    {
+        // Linear memory is not an IMemoryManager, so there is only the checked call to compare with
+        LinearMemoryManager pool(sizeof(ComplexNumber) * numElements);
+        auto clear = [&pool]() { pool.clear(); };
+
+        RunAllocatorDispatch(harness, StaticAllocator<ComplexNumber, LinearMemoryManager, CheckedValidation>(&pool), clear, "linear with static dispatch, checked");
+        RunAllocatorDispatch(harness, StaticAllocator<ComplexNumber, LinearMemoryManager, UncheckedValidation>(&pool), clear, "linear with static dispatch, unchecked");
+    }
+}
+
+//------------------------------------------------------------------------------
+void RunArrayOfPointers(const BenchmarkHarness & harness)
+{
+    const BenchmarkParameters & parameters = harness.getParameters();
+
+    // Enough numbers to spill out of the caches, so that the passes are bound by memory
+    const size_t numElements = parameters.m_numElements * 100;
+    const size_t numPasses   = std::max<size_t>(1, parameters.m_iterations / 10);
+
+    const ComplexNumber multiplier(0.5, 0.5);
+    const ComplexNumber addend(1.0, -1.0);
+
+    PoolMemoryManager pool(sizeof(ComplexNumber), alignof(ComplexNumber), numElements);
+    std::vector<ComplexNumber *> numbers(numElements);
+
+    const std::vector<BenchmarkTiming> timings = harness.timePhases([&]()
+    {
+        Common::PerformanceTimer timer;
+        timer.Start();
+
+        for( size_t j = 0; j < numElements; ++j )
+        {
+            void * address = pool.allocate(sizeof(ComplexNumber), alignof(ComplexNumber));
+            numbers[j] = new(address) ComplexNumber(static_cast<double>(j), -static_cast<double>(j));
+        }
+
+        std::vector<double> secondsElapsed(1, timer.Stop());
+        timer.Start();
+
+        // Written in place, as the structure of arrays pool does
+        for( size_t pass = 0; pass < numPasses; ++pass )
+        {
+            for( ComplexNumber * number : numbers )
+            {
+                number->set(static_cast<double>(pass), 1.0);
+            }
+        }
+
+        secondsElapsed.push_back(timer.Stop());
+        timer.Start();
+
+        for( size_t pass = 0; pass < numPasses; ++pass )
+        {
+            for( ComplexNumber * number : numbers )
+            {
+                number->multiplyAdd(multiplier, addend);
+            }
+        }
+
+        secondsElapsed.push_back(timer.Stop());
+
+        for( ComplexNumber * number : numbers )
+        {
+            number->~ComplexNumber();
+            pool.free(number);
+        }
+
+        return secondsElapsed;
+    });
+
+    std::cout << "Test with " << numElements << " complex numbers behind pointers into a pool took " << timings[0].toString()
+              << " to construct, " << timings[1].toString() << " to fill " << numPasses << " times and "
+              << timings[2].toString() << " to multiply add " << numPasses << " times.\n";
+}
+
+//------------------------------------------------------------------------------
+void RunStructureOfArrays(const BenchmarkHarness & harness, ComplexNumberPool::Kernel kernel)
+{
+    if( !ComplexNumberPool::isSupported(kernel) )
+    {
+        std::cout << "Skipped the " << ComplexNumberPool::getKernelName(kernel) << " complex number pool, this processor does not support it.\n";
+        return;
+    }
+
+    const BenchmarkParameters & parameters = harness.getParameters();
+
+    // The same work as RunArrayOfPointers
+    const size_t numElements = parameters.m_numElements * 100;
+    const size_t numPasses   = std::max<size_t>(1, parameters.m_iterations / 10);
+
+    const ComplexNumber multiplier(0.5, 0.5);
+    const ComplexNumber addend(1.0, -1.0);
+
+    std::vector<double> realParts(numElements);
+    std::vector<double> complexParts(numElements);
+    std::vector<ComplexNumberPool::Handle> handles(numElements);
+
+    for( size_t j = 0; j < numElements; ++j )
+    {
+        realParts[j]    = static_cast<double>(j);
+        complexParts[j] = -static_cast<double>(j);
+    }
+
+    ComplexNumberPool pool(kernel);
+    pool.reserve(numElements);
+
+    const std::vector<BenchmarkTiming> timings = harness.timePhases([&]()
+    {
+        Common::PerformanceTimer timer;
+        timer.Start();
+
+        pool.constructBatch(numElements, realParts.data(), complexParts.data(), handles.data());
+
+        std::vector<double> secondsElapsed(1, timer.Stop());
+        timer.Start();
+
+        for( size_t pass = 0; pass < numPasses; ++pass )
+        {
+            pool.fill(static_cast<double>(pass), 1.0);
+        }
+
+        secondsElapsed.push_back(timer.Stop());
+        timer.Start();
+
+        for( size_t pass = 0; pass < numPasses; ++pass )
+        {
+            pool.multiplyAdd(multiplier, addend);
+        }
+
+        secondsElapsed.push_back(timer.Stop());
+
+        pool.clear();
+        return secondsElapsed;
+    });
+
+    std::cout << "Test with " << numElements << " complex numbers in a structure of arrays pool, using the "
+              << ComplexNumberPool::getKernelName(kernel) << " kernels, took " << timings[0].toString() << " to construct, "
+              << timings[1].toString() << " to fill " << numPasses << " times and " << timings[2].toString()
+              << " to multiply add " << numPasses << " times.\n";
+}
+
+//------------------------------------------------------------------------------
+// Prints the statistics of each kind of memory manager after a mixed workload, as they would be scraped by monitoring
+void RunStatistics(const BenchmarkParameters & parameters)
+{
+    const size_t  numElements      = parameters.m_numElements;
+    const size_t  elementSize      = GetElementSize(parameters);
+    const uint8_t elementAlignment = GetElementAlignment(parameters);
+
+    std::mt19937 random(42);
+    std::uniform_int_distribution<size_t> sizes(1, 512);
+    std::vector<void *> addresses;
+
+    {
+        // Free every other block, so that the free list is left fragmented
+        FreeListMemoryManager pool((512 + 64) * numElements, FreeListMemoryManager::AllocationPolicy::SegregatedFit);
+
+        for( size_t j = 0; j < numElements; ++j )
+        {
+            addresses.push_back(pool.allocate(sizes(random), 1 << (j % 5)));
+        }
+
+        for( size_t j = 0; j < addresses.size(); j += 2 )
+        {
+            pool.free(addresses[j]);
+        }
+
+        addresses.clear();
+        std::cout << "Free list statistics: " << pool.getStatistics().toJson() << "\n";
+    }
+
+    {
+        PoolMemoryManager pool(elementSize, elementAlignment, std::max<size_t>(1, numElements / 4), true);
+
+        for( size_t j = 0; j < numElements; ++j )
+        {
+            addresses.push_back(pool.allocate(elementSize, elementAlignment));
+        }
+
+        for( void * address : addresses )
+        {
+            pool.free(address);
+        }
+
+        addresses.clear();
+        std::cout << "Pool statistics: " << pool.getStatistics().toJson() << "\n";
+    }
+
+    {
+        // Keep the first half, and release the second half all at once by rewinding
+        StackMemoryManager pool((512 + 32) * numElements);
+        StackMemoryManager::Marker marker;
+
+        for( size_t j = 0; j < numElements; ++j )
+        {
+            if( j == numElements / 2 )
+            {
+                marker = pool.getMarker();
+            }
+
+            pool.allocate(sizes(random), 1 << (j % 5));
+        }
+
+        pool.rewindTo(marker);
+        std::cout << "Stack statistics: " << pool.getStatistics().toJson() << "\n";
+    }
+
+    {
+        LinearMemoryManager pool((512 + 16) * numElements);
+
+        for( size_t j = 0; j < numElements; ++j )
+        {
+            pool.allocate(sizes(random), 1 << (j % 5));
+        }
+
+        pool.clear();
+        std::cout << "Linear statistics: " << pool.getStatistics().toJson() << "\n";
+    }
+}
+
+//------------------------------------------------------------------------------
+// Records the allocations made by a mix of node and array containers, as a stand in for a real program
+void RecordTrace(std::ostream & stream, const BenchmarkParameters & parameters)
+{
+    const int numElements = static_cast<int>(parameters.m_numElements);
+
+    typedef std::pair<const int, ComplexNumber>                                                  Pair;
+    typedef std::map<int, ComplexNumber, std::less<int>, CustomAllocator<Pair>>                  Map;
+    typedef std::list<ComplexNumber, CustomAllocator<ComplexNumber>>                             List;
+    typedef std::vector<ComplexNumber, CustomAllocator<ComplexNumber>>                           Vector;
+
+    FreeListMemoryManager pool(16 * 1024 * 1024, FreeListMemoryManager::AllocationPolicy::FirstFit);
+    TracingMemoryManager tracer(pool, stream);
+
+    for( int i = 0; i < 10; ++i )
+    {
+        Map map((CustomAllocator<Pair>(&tracer)));
+        List list((CustomAllocator<ComplexNumber>(&tracer)));
+        Vector vector((CustomAllocator<ComplexNumber>(&tracer)));
+
+        for( int j = 0; j < numElements; ++j )
+        {
+            map.emplace(j, ComplexNumber(i, j));
+            list.emplace_back(i, j);
+            vector.emplace_back(i, j);
+        }
+
+        // Erase every other map entry and the front half of the list, so that frees are not in allocation order
+        for( int j = 0; j < numElements; j += 2 )
+        {
+            map.erase(j);
+        }
+
+        for( int j = 0; j < numElements / 2; ++j )
+        {
+            list.pop_front();
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// Records buffers of 1 KiB to 64 KiB that live for a random while, as a stand in for a program juggling I/O buffers.
+// A quarter of them are still live at the end, so that replays can be compared on how their free memory is left.
+void RecordBufferTrace(std::ostream & stream, const BenchmarkParameters & parameters)
+{
+    std::mt19937 random(42);
+    std::uniform_int_distribution<size_t> sizes(1024, 64 * 1024);
+
+    FreeListMemoryManager pool(256 * 1024 * 1024, FreeListMemoryManager::AllocationPolicy::FirstFit);
+    TracingMemoryManager tracer(pool, stream);
+    std::vector<void *> buffers;
+
+    for( size_t i = 0; i < parameters.m_iterations * 10; ++i )
+    {
+        // Grow to about a quarter of the number of elements live buffers, then replace them at random
+        if( buffers.size() <= parameters.m_numElements / 4 || random() % 2 )
+        {
+            buffers.push_back(tracer.allocate(sizes(random), alignof(std::max_align_t)));
+            continue;
+        }
+
+        const size_t index = random() % buffers.size();
+        tracer.free(buffers[index]);
+        buffers[index] = buffers.back();
+        buffers.pop_back();
+    }
+
+    // Leave a quarter of them live
+    for( size_t j = 0; j < buffers.size(); ++j )
+    {
+        if( j % 4 )
+        {
+            tracer.free(buffers[j]);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// Runs a replay over the harness's warm up and timed runs, the time is the median of the timed runs,
+// the latencies, footprint and fragmentation are those of the last one
+template <class Replay>
+AllocationTrace::ReplayResult RunReplay(const BenchmarkHarness & harness, Replay replay)
+{
+    AllocationTrace::ReplayResult result;
+
+    const BenchmarkTiming timing = harness.timePhases([&]()
+    {
+        result = replay();
+        return std::vector<double>(1, result.m_secondsElapsed);
+    }).front();
+
+    result.m_secondsElapsed  = timing.m_seconds;
+    result.m_eventsPerSecond = timing.m_seconds > 0.0 ? result.m_numEvents / timing.m_seconds : 0.0;
+
+    return result;
+}
+
+//------------------------------------------------------------------------------
+void RunTraceReplay(const BenchmarkHarness & harness, const AllocationTrace & trace)
+{
+    std::cout << "Replaying a trace of " << trace.getEvents().size() << " events on " << trace.getNumObjects()
+              << " objects, at most " << trace.getPeakLiveObjects() << " objects and " << trace.getPeakRequestedBytes()
+              << " requested bytes live at once.\n";
+
+    // Enough for the live data, alignment and headers, with room left over for fragmentation
+    const size_t poolSize = trace.getPeakRequestedBytes() * 4 + trace.getPeakLiveObjects() * 64 + 4096;
+
+    std::cout << RunReplay(harness, [&]() { return trace.replaySystemAllocator(); }).toString() << "\n";
+
+    {
+        FreeListMemoryManager pool(poolSize, FreeListMemoryManager::AllocationPolicy::FirstFit);
+        std::cout << RunReplay(harness, [&]() { return trace.replay(pool, "first fit free list memory manager"); }).toString() << "\n";
+    }
+
+    {
+        FreeListMemoryManager pool(poolSize, FreeListMemoryManager::AllocationPolicy::SegregatedFit);
+        std::cout << RunReplay(harness, [&]() { return trace.replay(pool, "segregated fit free list memory manager"); }).toString() << "\n";
+    }
+
+    {
+        BuddyMemoryManager pool(poolSize);
+        std::cout << RunReplay(harness, [&]() { return trace.replay(pool, "buddy memory manager"); }).toString() << "\n";
+    }
+
+    {
+        FreeListMemoryManager pool(poolSize, FreeListMemoryManager::AllocationPolicy::SegregatedFit);
+        ThreadCachingMemoryManager threadCachingPool(pool);
+        std::cout << RunReplay(harness, [&]() { return trace.replay(threadCachingPool, "thread caching memory manager"); }).toString() << "\n";
+    }
+
+    {
+        StackMemoryManager pool(poolSize);
+        std::cout << RunReplay(harness, [&]() { return trace.replay(pool, "stack memory manager"); }).toString() << "\n";
+    }
+}
+
+//------------------------------------------------------------------------------
+void RunRecordedTraceReplay(const BenchmarkHarness & harness)
+{
+    std::stringstream stream(std::ios::in | std::ios::out | std::ios::binary);
+    RecordTrace(stream, harness.getParameters());
+
+    RunTraceReplay(harness, AllocationTrace::load(stream));
+}
+
+//------------------------------------------------------------------------------
+void RunRecordedBufferTraceReplay(const BenchmarkHarness & harness)
+{
+    std::stringstream stream(std::ios::in | std::ios::out | std::ios::binary);
+    RecordBufferTrace(stream, harness.getParameters());
+
+    RunTraceReplay(harness, AllocationTrace::load(stream));
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char * argv[])
+{
+    // "record <file>" writes the trace of RecordTrace() to a file, "replay <file>" replays a trace from a file
+    if( argc == 3 && std::string(argv[1]) == "record" )
+    {
+        std::ofstream file(argv[2], std::ios::binary);
+        RecordTrace(file, BenchmarkParameters());
+        return 0;
+    }
+
+    if( argc == 3 && std::string(argv[1]) == "replay" )
+    {
+        RunTraceReplay(BenchmarkHarness(BenchmarkParameters()), AllocationTrace::load(std::string(argv[2])));
+        return 0;
+    }
+
+    // Anything else is taken as benchmark options, threaded benchmarks double the thread count up to --threads
+    BenchmarkParameters defaults;
+    defaults.m_objectSize = sizeof(ComplexNumber);
+    defaults.m_numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    BenchmarkParameters parameters;
+
+    try
+    {
+        parameters = BenchmarkParameters::parse(argc, argv, defaults);
+    }
+    catch( const std::exception & e )
+    {
+        std::cerr << e.what() << "\n"
+                  << "Usage: " << argv[0] << " [--elements n] [--size bytes] [--iterations n] [--threads n]"
+                  << " [--free-order fifo|lifo|random] [--warmup n] [--repeats n]\n"
+                  << "       " << argv[0] << " record|replay <trace file>\n";
+        return 1;
+    }
+
+    // Memory managers that are not thread safe always run on one thread, stacks always free in LIFO order
+    BenchmarkParameters singleThreadedParameters(parameters);
+    singleThreadedParameters.m_numThreads = 1;
+
+    BenchmarkParameters lifoParameters(singleThreadedParameters);
+    lifoParameters.m_freeOrder = FreeOrder::Lifo;
+
+    const BenchmarkHarness harness(singleThreadedParameters);
+    const BenchmarkHarness lifoHarness(lifoParameters);
+
+    std::cout << "Benchmarks with " << singleThreadedParameters.toString() << ".\n";
+
+    RunNoMemoryManagement(harness);
+    RunLinearMemoryManagement(harness);
+    RunScopedLinearMemoryManagement(harness);
+    RunBackingStoreMemoryManagement(harness, BackingStore::Policy::Malloc);
+    RunBackingStoreMemoryManagement(harness, BackingStore::Policy::Prefaulted);
+    RunBackingStoreMemoryManagement(harness, BackingStore::Policy::HugePages);
+    RunStackMemoryManagement(lifoHarness);
+    RunDoubleEndedStackMemoryManagement(harness);
+    RunRingBufferMemoryManagement(harness);
+    RunStreamingMemoryManagement(harness, false);
+    RunStreamingMemoryManagement(harness, true);
+    RunProducerConsumerMemoryManagement(harness, false);
+    RunProducerConsumerMemoryManagement(harness, true);
+    RunFreeListMemoryManagement(harness, FreeListMemoryManager::AllocationPolicy::FirstFit);
+    RunFreeListMemoryManagement(harness, FreeListMemoryManager::AllocationPolicy::SegregatedFit);
+    RunBatchFreeListMemoryManagement(harness, FreeListMemoryManager::AllocationPolicy::FirstFit);
+    RunBatchFreeListMemoryManagement(harness, FreeListMemoryManager::AllocationPolicy::SegregatedFit);
+    RunFragmentedFreeListMemoryManagement(harness, FreeListMemoryManager::AllocationPolicy::FirstFit);
+    RunFragmentedFreeListMemoryManagement(harness, FreeListMemoryManager::AllocationPolicy::SegregatedFit);
+    RunRelocatableFreeListMemoryManagement(harness, false);
+    RunRelocatableFreeListMemoryManagement(harness, true);
+    RunPurgeFreeListMemoryManagement(harness, false);
+    RunPurgeFreeListMemoryManagement(harness, true);
+    RunHeaderlessFreeListMemoryManagement(harness, FreeListMemoryManager::HeaderPolicy::Headers);
+    RunHeaderlessFreeListMemoryManagement(harness, FreeListMemoryManager::HeaderPolicy::Headerless);
+    RunHeaderlessStackMemoryManagement(lifoHarness, StackMemoryManager::HeaderPolicy::Headers);
+    RunHeaderlessStackMemoryManagement(lifoHarness, StackMemoryManager::HeaderPolicy::Headerless);
+    RunPoolMemoryManagement(harness);
+    RunBatchPoolMemoryManagement(harness);
+    RunBuddyMemoryManagement(harness);
+    RunReallocateMemoryManagement(harness, false);
+    RunReallocateMemoryManagement(harness, true);
+    RunPersistentMemoryManagement(harness);
+
+    for( size_t numElements : { parameters.m_numElements, parameters.m_numElements * 10, parameters.m_numElements * 100 } )
+    {
+        RunFreeOrderMemoryManagement(singleThreadedParameters, FreeOrder::Fifo, numElements);
+        RunFreeOrderMemoryManagement(singleThreadedParameters, FreeOrder::Lifo, numElements);
+        RunFreeOrderMemoryManagement(singleThreadedParameters, FreeOrder::Random, numElements);
+    }
+
+    for( size_t numThreads = 1; numThreads <= parameters.m_numThreads; numThreads *= 2 )
+    {
+        RunThreadedMemoryManagement(parameters, numThreads, false);
+        RunThreadedMemoryManagement(parameters, numThreads, true);
+        RunConcurrentLinearMemoryManagement(harness, numThreads, false);
+        RunConcurrentLinearMemoryManagement(harness, numThreads, true);
+    }
+
+    RunPipelineMemoryManagement(harness, std::max<size_t>(2, parameters.m_numThreads));
+
+    RunMemoryResources(harness);
 
-//  RunCustomAllocator();
+    RunCustomAllocator(harness);
+    RunCustomAllocatorNodeContainers(harness);
+    RunStaticDispatch(harness);
+    RunArrayOfPointers(harness);
+    RunStructureOfArrays(harness, ComplexNumberPool::Kernel::Scalar);
+    RunStructureOfArrays(harness, ComplexNumberPool::Kernel::Sse2);
+    RunStructureOfArrays(harness, ComplexNumberPool::Kernel::Avx2);
+    RunStatistics(singleThreadedParameters);
+    RunRecordedTraceReplay(harness);
+    RunRecordedBufferTraceReplay(harness);
 
     return 0;
 }
\ No newline at end of file